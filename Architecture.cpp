@@ -0,0 +1,46 @@
+#include "Architecture.h"
+
+#include <stdexcept>
+#include <string>
+
+// The lookups are constant expressions
+static_assert(findCellType<ArchTraits<Architecture::ICE40>>("SB_DFFNESR") == Cell::Type::DFF);
+static_assert(findCellType<ArchTraits<Architecture::ICE40>>("SB_RAM40_4KNRNW") == Cell::Type::RAM);
+static_assert(! findCellType<ArchTraits<Architecture::ICE40>>("SB_IO"));
+static_assert(findCellType<ArchTraits<Architecture::ECP5>>("CCU2C") == Cell::Type::Carry);
+static_assert(findCellType<ArchTraits<Architecture::Generic>>("$_SDFFCE_PN0P_") == Cell::Type::DFF);
+
+Cell::Type resolveCellType(std::string_view typeName, Architecture& arch)
+{
+    if (arch != Architecture::Auto)
+    {
+        return withArchitecture(arch, [&](auto traits) { return findCellType<decltype(traits)>(typeName).value_or(Cell::Type::Unknown); });
+    }
+
+    for (Architecture candidate : { Architecture::ICE40, Architecture::ECP5, Architecture::Generic })
+    {
+        std::optional<Cell::Type> type = withArchitecture(candidate, [&](auto traits) { return findCellType<decltype(traits)>(typeName); });
+        if (type)
+        {
+            arch = candidate;
+            return *type;
+        }
+    }
+    return Cell::Type::Unknown;
+}
+
+std::string_view architectureName(Architecture arch)
+{
+    if (arch == Architecture::Auto) return "unknown";
+    return withArchitecture(arch, [](auto traits) { return decltype(traits)::name; });
+}
+
+Architecture parseArchitecture(std::string_view name)
+{
+    if (name == "auto") return Architecture::Auto;
+    for (Architecture arch : { Architecture::ICE40, Architecture::ECP5, Architecture::Generic })
+    {
+        if (architectureName(arch) == name) return arch;
+    }
+    throw std::invalid_argument("Unknown architecture: " + std::string(name));
+}
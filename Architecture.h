@@ -0,0 +1,241 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+#include "Cell.h"
+
+// FPGA families whose primitives are recognized. Everything that depends on the family, the cell type names
+// and the ports of the sequential cells, is resolved when a cell is loaded: the analyses only see Cell::Type.
+enum class Architecture
+{
+    // Detected from the cell types of each module, the first recognized one decides
+    Auto,
+    ICE40,
+    ECP5,
+    // Yosys internal cells, as written before technology mapping
+    Generic
+};
+
+struct CellTypeName
+{
+    std::string_view name;
+    Cell::Type type;
+};
+
+constexpr uint32_t hashTypeName(std::string_view name, uint32_t seed)
+{
+    uint32_t hash = 2166136261u ^ seed;
+    for (char c : name)
+    {
+        hash ^= static_cast<uint8_t>(c);
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+// Perfect hash of a fixed set of type names: the seed is searched at compile time until no two names share a
+// slot, so a lookup is one hash and at most one string comparison
+template <size_t N>
+class CellTypeTable
+{
+public:
+    consteval CellTypeTable(const std::array<CellTypeName, N>& names) : names(names)
+    {
+        while (! tryFill()) ++seed;
+    }
+
+    constexpr std::optional<Cell::Type> find(std::string_view name) const
+    {
+        uint8_t slot = slots[hashTypeName(name, seed) & (SLOT_CNT - 1)];
+        if (slot == 0 || names[slot - 1].name != name) return std::nullopt;
+        return names[slot - 1].type;
+    }
+
+private:
+    // A quarter full, a few seeds are enough
+    static constexpr size_t SLOT_CNT = std::bit_ceil(N * 4);
+    static_assert(N < 255);
+
+    constexpr bool tryFill()
+    {
+        slots.fill(0);
+        for (size_t idx = 0; idx < N; ++idx)
+        {
+            uint8_t& slot = slots[hashTypeName(names[idx].name, seed) & (SLOT_CNT - 1)];
+            if (slot != 0) return false;
+            slot = static_cast<uint8_t>(idx + 1);
+        }
+        return true;
+    }
+
+    std::array<CellTypeName, N> names;
+    // Index + 1 into names, 0 for empty slots
+    std::array<uint8_t, SLOT_CNT> slots {};
+    uint32_t seed = 0;
+};
+
+// Control inputs of a sequential cell, empty port names where it has none
+struct ControlPorts
+{
+    std::string_view captureClock;
+    std::string_view launchClock;
+    bool captureNegEdge = false;
+    bool launchNegEdge = false;
+    std::string_view enable;
+    // Set and reset inputs, the first connected one counts
+    std::array<std::string_view, 2> resets;
+};
+
+// Per family: name, a perfect hash of the primitive names, prefixes of primitive families not listed one by
+// one, and the control ports of the sequential primitives
+template <Architecture A>
+struct ArchTraits;
+
+template <>
+struct ArchTraits<Architecture::ICE40>
+{
+    static constexpr std::string_view name = "ice40";
+
+    static constexpr CellTypeTable types { std::array {
+        CellTypeName { "SB_LUT4", Cell::Type::LUT },
+        CellTypeName { "SB_CARRY", Cell::Type::Carry },
+        CellTypeName { "SB_DFF", Cell::Type::DFF }, CellTypeName { "SB_DFFE", Cell::Type::DFF },
+        CellTypeName { "SB_DFFSR", Cell::Type::DFF }, CellTypeName { "SB_DFFR", Cell::Type::DFF },
+        CellTypeName { "SB_DFFSS", Cell::Type::DFF }, CellTypeName { "SB_DFFS", Cell::Type::DFF },
+        CellTypeName { "SB_DFFESR", Cell::Type::DFF }, CellTypeName { "SB_DFFER", Cell::Type::DFF },
+        CellTypeName { "SB_DFFESS", Cell::Type::DFF }, CellTypeName { "SB_DFFES", Cell::Type::DFF },
+        CellTypeName { "SB_DFFN", Cell::Type::DFF }, CellTypeName { "SB_DFFNE", Cell::Type::DFF },
+        CellTypeName { "SB_DFFNSR", Cell::Type::DFF }, CellTypeName { "SB_DFFNR", Cell::Type::DFF },
+        CellTypeName { "SB_DFFNSS", Cell::Type::DFF }, CellTypeName { "SB_DFFNS", Cell::Type::DFF },
+        CellTypeName { "SB_DFFNESR", Cell::Type::DFF }, CellTypeName { "SB_DFFNER", Cell::Type::DFF },
+        CellTypeName { "SB_DFFNESS", Cell::Type::DFF }, CellTypeName { "SB_DFFNES", Cell::Type::DFF },
+        CellTypeName { "SB_RAM40_4K", Cell::Type::RAM }, CellTypeName { "SB_RAM40_4KNR", Cell::Type::RAM },
+        CellTypeName { "SB_RAM40_4KNW", Cell::Type::RAM }, CellTypeName { "SB_RAM40_4KNRNW", Cell::Type::RAM },
+        CellTypeName { "SB_SPRAM256KA", Cell::Type::RAM } } };
+
+    static constexpr std::array prefixes { CellTypeName { "SB_DFF", Cell::Type::DFF }, CellTypeName { "SB_RAM", Cell::Type::RAM } };
+
+    static constexpr ControlPorts controlPorts(Cell::Type type, std::string_view typeName)
+    {
+        if (type == Cell::Type::DFF)
+        {
+            bool negEdge = typeName.starts_with("SB_DFFN");
+            return { "C", "C", negEdge, negEdge, "E", { "R", "S" } };
+        }
+        if (typeName == "SB_SPRAM256KA") return { "CLOCK", "CLOCK", false, false, "", {} };
+
+        // SB_RAM40_4K[NR][NW]: NR reads on the falling edge of RCLKN, NW writes on the one of WCLKN
+        bool readNegEdge = typeName.find("NR") != std::string_view::npos;
+        bool writeNegEdge = typeName.find("NW") != std::string_view::npos;
+        return { writeNegEdge ? "WCLKN" : "WCLK", readNegEdge ? "RCLKN" : "RCLK", writeNegEdge, readNegEdge, "WCLKE", {} };
+    }
+};
+
+template <>
+struct ArchTraits<Architecture::ECP5>
+{
+    static constexpr std::string_view name = "ecp5";
+
+    // Packed TRELLIS_SLICEs count as one level of logic, their flip-flops are not seen
+    static constexpr CellTypeTable types { std::array {
+        CellTypeName { "LUT4", Cell::Type::LUT },
+        CellTypeName { "PFUMX", Cell::Type::LUT },
+        CellTypeName { "L6MUX21", Cell::Type::LUT },
+        CellTypeName { "TRELLIS_SLICE", Cell::Type::LUT },
+        CellTypeName { "CCU2C", Cell::Type::Carry },
+        CellTypeName { "TRELLIS_FF", Cell::Type::DFF },
+        CellTypeName { "DP16KD", Cell::Type::RAM },
+        CellTypeName { "PDPW16KD", Cell::Type::RAM },
+        CellTypeName { "TRELLIS_DPR16X4", Cell::Type::RAM } } };
+
+    // Flip-flops of the vendor library: FD1S3AX, FD1P3DX, ...
+    static constexpr std::array prefixes { CellTypeName { "FD1S3", Cell::Type::DFF }, CellTypeName { "FD1P3", Cell::Type::DFF } };
+
+    // The clock polarity of TRELLIS_FF is a parameter, which is not loaded
+    static constexpr ControlPorts controlPorts(Cell::Type type, std::string_view typeName)
+    {
+        if (typeName == "TRELLIS_FF") return { "CLK", "CLK", false, false, "CE", { "LSR", "" } };
+        if (type == Cell::Type::DFF) return { "CK", "CK", false, false, "SP", { "CD", "PD" } };
+        if (typeName == "PDPW16KD") return { "CLKW", "CLKR", false, false, "CEW", {} };
+        // The distributed RAM reads asynchronously, its data belongs to the write clock
+        if (typeName == "TRELLIS_DPR16X4") return { "WCK", "WCK", false, false, "WRE", {} };
+        return { "CLKA", "CLKB", false, false, "CEA", { "RSTA", "" } };
+    }
+};
+
+template <>
+struct ArchTraits<Architecture::Generic>
+{
+    static constexpr std::string_view name = "generic";
+
+    static constexpr CellTypeTable types { std::array {
+        CellTypeName { "$lut", Cell::Type::LUT },
+        CellTypeName { "$_BUF_", Cell::Type::LUT }, CellTypeName { "$_NOT_", Cell::Type::LUT },
+        CellTypeName { "$_AND_", Cell::Type::LUT }, CellTypeName { "$_NAND_", Cell::Type::LUT },
+        CellTypeName { "$_OR_", Cell::Type::LUT }, CellTypeName { "$_NOR_", Cell::Type::LUT },
+        CellTypeName { "$_XOR_", Cell::Type::LUT }, CellTypeName { "$_XNOR_", Cell::Type::LUT },
+        CellTypeName { "$_ANDNOT_", Cell::Type::LUT }, CellTypeName { "$_ORNOT_", Cell::Type::LUT },
+        CellTypeName { "$_MUX_", Cell::Type::LUT }, CellTypeName { "$_NMUX_", Cell::Type::LUT },
+        CellTypeName { "$_AOI3_", Cell::Type::LUT }, CellTypeName { "$_OAI3_", Cell::Type::LUT },
+        CellTypeName { "$_AOI4_", Cell::Type::LUT }, CellTypeName { "$_OAI4_", Cell::Type::LUT },
+        CellTypeName { "$dff", Cell::Type::DFF }, CellTypeName { "$dffe", Cell::Type::DFF },
+        CellTypeName { "$adff", Cell::Type::DFF }, CellTypeName { "$adffe", Cell::Type::DFF },
+        CellTypeName { "$sdff", Cell::Type::DFF }, CellTypeName { "$sdffe", Cell::Type::DFF },
+        CellTypeName { "$sdffce", Cell::Type::DFF }, CellTypeName { "$dffsr", Cell::Type::DFF },
+        CellTypeName { "$dffsre", Cell::Type::DFF }, CellTypeName { "$aldff", Cell::Type::DFF },
+        CellTypeName { "$aldffe", Cell::Type::DFF },
+        CellTypeName { "$mem", Cell::Type::RAM }, CellTypeName { "$mem_v2", Cell::Type::RAM } } };
+
+    // The single bit flip-flops, named after their polarities: $_DFF_P_, $_DFFE_NP_, $_SDFF_PN0_, ...
+    static constexpr std::array prefixes {
+        CellTypeName { "$_DFF", Cell::Type::DFF }, CellTypeName { "$_SDFF", Cell::Type::DFF }, CellTypeName { "$_ALDFF", Cell::Type::DFF } };
+
+    // The clock polarity of the coarse cells is a parameter, which is not loaded
+    static constexpr ControlPorts controlPorts(Cell::Type type, std::string_view typeName)
+    {
+        if (type == Cell::Type::RAM) return { "WR_CLK", "RD_CLK", false, false, "WR_EN", {} };
+        if (typeName.starts_with("$_"))
+        {
+            size_t polarity = typeName.find('_', 2) + 1;
+            bool negEdge = polarity < typeName.size() && typeName[polarity] == 'N';
+            return { "C", "C", negEdge, negEdge, "E", { "R", "S" } };
+        }
+        if (typeName == "$dffsr" || typeName == "$dffsre") return { "CLK", "CLK", false, false, "EN", { "CLR", "SET" } };
+        return { "CLK", "CLK", false, false, "EN", { "ARST", "SRST" } };
+    }
+};
+
+// Calls func(ArchTraits<arch>()), Auto gets the iCE40 traits
+template <typename Func>
+decltype(auto) withArchitecture(Architecture arch, Func func)
+{
+    switch (arch)
+    {
+        case Architecture::ECP5: return func(ArchTraits<Architecture::ECP5>());
+        case Architecture::Generic: return func(ArchTraits<Architecture::Generic>());
+        default: return func(ArchTraits<Architecture::ICE40>());
+    }
+}
+
+template <typename Traits>
+constexpr std::optional<Cell::Type> findCellType(std::string_view typeName)
+{
+    if (auto type = Traits::types.find(typeName)) return type;
+    for (const CellTypeName& prefix : Traits::prefixes)
+    {
+        if (typeName.starts_with(prefix.name)) return prefix.type;
+    }
+    return std::nullopt;
+}
+
+// Type of a cell of the architecture, Cell::Type::Unknown for other primitives. With Auto, all families are
+// tried and arch is set to the first one that knows the name.
+Cell::Type resolveCellType(std::string_view typeName, Architecture& arch);
+
+std::string_view architectureName(Architecture arch);
+// Throws std::invalid_argument for unknown names
+Architecture parseArchitecture(std::string_view name);
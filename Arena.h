@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+#include <memory_resource>
+
+// Owns the cells, ports and links of a netlist. Memory is taken from the heap in growing blocks and only released
+// as a whole together with the arena, deallocations of the containers using it are no-ops.
+class Arena
+{
+public:
+    Arena() : blocks(INITIAL_BLOCK_SIZE, &upstream) {}
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    std::pmr::memory_resource* resource() { return &blocks; }
+
+    // Bytes taken from the heap so far
+    size_t reservedBytes() const { return upstream.allocatedBytes; }
+
+private:
+    static constexpr size_t INITIAL_BLOCK_SIZE = 64 * 1024;
+
+    class CountingResource : public std::pmr::memory_resource
+    {
+    public:
+        size_t allocatedBytes = 0;
+
+    private:
+        void* do_allocate(size_t bytes, size_t alignment) override
+        {
+            allocatedBytes += bytes;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* ptr, size_t bytes, size_t alignment) override
+        {
+            std::pmr::new_delete_resource()->deallocate(ptr, bytes, alignment);
+        }
+
+        bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+    };
+
+    CountingResource upstream;
+    std::pmr::monotonic_buffer_resource blocks;
+};
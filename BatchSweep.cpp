@@ -0,0 +1,368 @@
+#include "BatchSweep.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+
+#include "CompressedInput.h"
+#include "DelayModel.h"
+#include "Design.h"
+#include "HierarchyAnalysis.h"
+#include "NetlistCache.h"
+#include "NetlistGraph.h"
+#include "NetlistLoader.h"
+#include "Profiler.h"
+#include "SysUtils.h"
+#include "TimingAnalysis.h"
+
+namespace
+{
+    // Loaded netlists take about 2.5 times the size of their JSON text, the analysis adds a little to that
+    constexpr size_t BYTES_PER_JSON_BYTE = 3;
+    // Yosys JSON compresses 10 to 30 times with gzip or zstd
+    constexpr size_t BYTES_PER_COMPRESSED_BYTE = 30 * BYTES_PER_JSON_BYTE;
+
+    // Admission of the netlists: blocks until the estimate fits into the limit next to the netlists in
+    // progress. A netlist larger than the limit is still admitted when it is the only one.
+    class MemoryBudget
+    {
+    public:
+        explicit MemoryBudget(size_t limit) : limit(limit) {}
+
+        void acquire(size_t bytes)
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            released.wait(lock, [&]() { return inProgress == 0 || inUse + bytes <= limit; });
+            inUse += bytes;
+            ++inProgress;
+        }
+
+        void release(size_t bytes)
+        {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                inUse -= bytes;
+                --inProgress;
+            }
+            released.notify_all();
+        }
+
+    private:
+        std::mutex mutex;
+        std::condition_variable released;
+        size_t limit;
+        size_t inUse = 0;
+        size_t inProgress = 0;
+    };
+
+    bool matchesWildcard(std::string_view name, std::string_view pattern)
+    {
+        // Backtracks to the last '*' only, which is enough for '*' and '?'
+        size_t nameIdx = 0, patternIdx = 0;
+        size_t starIdx = std::string_view::npos, starNameIdx = 0;
+        while (nameIdx < name.size())
+        {
+            if (patternIdx < pattern.size() && (pattern[patternIdx] == '?' || pattern[patternIdx] == name[nameIdx]))
+            {
+                ++nameIdx;
+                ++patternIdx;
+            }
+            else if (patternIdx < pattern.size() && pattern[patternIdx] == '*')
+            {
+                starIdx = patternIdx++;
+                starNameIdx = nameIdx;
+            }
+            else if (starIdx != std::string_view::npos)
+            {
+                patternIdx = starIdx + 1;
+                nameIdx = ++starNameIdx;
+            }
+            else
+            {
+                return false;
+            }
+        }
+        while (patternIdx < pattern.size() && pattern[patternIdx] == '*') ++patternIdx;
+        return patternIdx == pattern.size();
+    }
+
+    void expandPattern(const std::string& pattern, std::vector<std::string>& files)
+    {
+        std::filesystem::path path(pattern);
+        std::string namePattern = path.filename().string();
+        if (namePattern.find_first_of("*?") == std::string::npos)
+        {
+            files.push_back(pattern);
+            return;
+        }
+
+        std::filesystem::path dir = path.parent_path();
+        std::vector<std::string> matches;
+        std::error_code error;
+        for (const auto& entry : std::filesystem::directory_iterator(dir.empty() ? std::filesystem::path(".") : dir, error))
+        {
+            if (entry.is_regular_file() && matchesWildcard(entry.path().filename().string(), namePattern))
+                matches.push_back((dir / entry.path().filename()).string());
+        }
+        if (matches.empty()) throw std::invalid_argument("No netlists match " + pattern);
+
+        std::sort(matches.begin(), matches.end());
+        files.insert(files.end(), matches.begin(), matches.end());
+    }
+
+    void analyzeNetlist(const std::string& fileName, const Options& options, const DelayModel* delayModel, size_t topCnt, BatchResult& result)
+    {
+        PROFILE_SCOPE("batch netlist");
+        SysUtils::Stopwatch timer;
+        Design design;
+        design.architecture = options.architecture;
+        if (! (options.useCache && NetlistCache::load(fileName, design)))
+        {
+            loadDesign(fileName, design, options.loader);
+            if (options.useCache)
+            {
+                try
+                {
+                    NetlistCache::save(fileName, design);
+                }
+                catch (std::exception&)
+                {
+                    // The cache only saves time on the next run
+                }
+            }
+        }
+        result.loadMs = timer.elapsedMs();
+        timer.restart();
+
+        const Netlist& netlist = design.topModule();
+        result.cellCnt = netlist.cells.size();
+        for (const auto& [name, typeCnt] : netlist.cellTypes)
+        {
+            result.cellTypeCnts.emplace_back(name, typeCnt.cnt);
+            result.cellCntByType[static_cast<size_t>(typeCnt.type)] += typeCnt.cnt;
+        }
+        result.architecture = architectureName(netlist.architecture);
+        result.hierarchical = design.isHierarchical();
+
+        if (result.hierarchical)
+        {
+            HierarchyAnalysis hierarchy(design);
+            std::vector<HierarchyAnalysis::EndpointResult> endpoints = hierarchy.analyzeTop();
+            for (const auto& endpoint : endpoints)
+            {
+                if (endpoint.depth > 0) result.endpointDepths.push_back(endpoint.depth);
+            }
+            for (size_t i = 0; i < std::min(topCnt, endpoints.size()) && endpoints[i].depth > 0; ++i)
+            {
+                const auto& endpoint = endpoints[i];
+                result.topPaths.push_back({ endpoint.depth, endpoint.name, std::string(endpoint.verilogSrc),
+                    endpoint.path.empty() ? std::string() : std::string(endpoint.path.back()->name) });
+            }
+        }
+        else
+        {
+            NetlistGraph graph = NetlistGraph::build(netlist);
+            PathAnalysis analysis = analyzeLongestPaths(graph);
+            for (cellId_t endpoint : analysis.endpoints)
+            {
+                if (analysis.depth[endpoint] > 0) result.endpointDepths.push_back(analysis.depth[endpoint]);
+            }
+            for (cellId_t endpoint : analysis.topEndpoints(topCnt))
+            {
+                if (analysis.depth[endpoint] == 0) break;
+                const Cell& cell = *graph.cells[endpoint];
+                result.topPaths.push_back({ analysis.depth[endpoint], std::string(cell.name), std::string(cell.verilogSrc),
+                    std::string(graph.cells[analysis.pathTo(endpoint).back()]->name) });
+            }
+
+            if (delayModel)
+            {
+                TimingAnalysis timing(graph, *delayModel);
+                timing.run();
+                result.fmaxMHz = timing.fmaxMHz();
+            }
+        }
+        std::sort(result.endpointDepths.begin(), result.endpointDepths.end());
+        result.analysisMs = timer.elapsedMs();
+    }
+}
+
+depth_t BatchResult::depthPercentile(unsigned percent) const
+{
+    if (endpointDepths.empty()) return 0;
+    size_t rank = (endpointDepths.size() * percent + 99) / 100;
+    return endpointDepths[std::max<size_t>(rank, 1) - 1];
+}
+
+std::vector<std::string> expandNetlistPatterns(const std::vector<std::string>& patterns)
+{
+    std::vector<std::string> files;
+    for (const std::string& pattern : patterns)
+    {
+        if (! pattern.starts_with('@'))
+        {
+            expandPattern(pattern, files);
+            continue;
+        }
+
+        std::ifstream listFile(pattern.substr(1));
+        if (! listFile) throw std::invalid_argument("Could not open list file: " + pattern.substr(1));
+        std::string line;
+        while (std::getline(listFile, line))
+        {
+            line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (! line.empty() && line[0] != '#') expandPattern(line, files);
+        }
+    }
+    return files;
+}
+
+std::vector<BatchResult> runBatch(const std::vector<std::string>& files, const Options& options, ThreadPool& pool, size_t memoryBudget)
+{
+    PROFILE_SCOPE("batch");
+    std::vector<BatchResult> results(files.size());
+
+    // Loaded once for all netlists, a broken model fails every one of them
+    std::optional<DelayModel> delayModel;
+    std::string delayModelError;
+    if (! options.delayModelFile.empty())
+    {
+        try
+        {
+            delayModel = options.delayModelFile == "ice40" ? DelayModel::ice40() : DelayModel::load(options.delayModelFile);
+        }
+        catch (std::exception& ex)
+        {
+            delayModelError = ex.what();
+        }
+    }
+
+    MemoryBudget budget(memoryBudget);
+    std::mutex progressMutex;
+    size_t doneCnt = 0;
+    pool.parallelFor(files.size(), 1, [&](size_t begin, size_t end, size_t) {
+        for (size_t fileIdx = begin; fileIdx < end; ++fileIdx)
+        {
+            BatchResult& result = results[fileIdx];
+            result.fileName = files[fileIdx];
+            std::error_code error;
+            size_t fileSize = std::filesystem::file_size(result.fileName, error);
+            bool compressed = detectCompression(result.fileName) != Compression::None;
+            result.estimatedBytes = error ? 0 : fileSize * (compressed ? BYTES_PER_COMPRESSED_BYTE : BYTES_PER_JSON_BYTE);
+
+            budget.acquire(result.estimatedBytes);
+            try
+            {
+                if (! delayModelError.empty()) throw std::runtime_error(delayModelError);
+                analyzeNetlist(result.fileName, options, delayModel ? &*delayModel : nullptr, options.topCnt, result);
+            }
+            catch (std::out_of_range& ex)
+            {
+                result.error = std::string("Unexpected JSON schema: ") + ex.what();
+            }
+            catch (std::exception& ex)
+            {
+                result.error = ex.what();
+            }
+            budget.release(result.estimatedBytes);
+
+            std::lock_guard<std::mutex> lock(progressMutex);
+            std::cout << "[" << ++doneCnt << "/" << files.size() << "] " << result.fileName << ": ";
+            if (result.error.empty()) std::cout << result.cellCnt << " cells, max depth " << result.maxDepth() << '\n';
+            else std::cout << "FAILED\n";
+            std::cout.flush();
+        }
+    });
+    return results;
+}
+
+void printBatchReport(ReportWriter& out, const std::vector<BatchResult>& results, size_t topCnt, bool withTiming)
+{
+    PROFILE_SCOPE("batch report");
+    out << "\nNetlists:\n\n";
+    out << "   #    cells     LUT     DFF   Carry     RAM   other  depth   p50   p90   p99" << (withTiming ? "  fmax MHz" : "")
+        << "  load ms  analysis ms  netlist\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BatchResult& result = results[i];
+        out.padded(i + 1, 4);
+        if (! result.error.empty())
+        {
+            out << "  FAILED: " << result.error << "  " << result.fileName << '\n';
+            continue;
+        }
+
+        const auto& byType = result.cellCntByType;
+        out.padded(result.cellCnt, 9);
+        for (Cell::Type type : { Cell::Type::LUT, Cell::Type::DFF, Cell::Type::Carry, Cell::Type::RAM })
+        {
+            out.padded(byType[static_cast<size_t>(type)], 8);
+        }
+        out.padded(byType[static_cast<size_t>(Cell::Type::Unknown)] + byType[static_cast<size_t>(Cell::Type::Instance)], 8);
+        out.padded(result.maxDepth(), 7);
+        for (unsigned percent : { 50u, 90u, 99u })
+        {
+            out.padded(result.depthPercentile(percent), 6);
+        }
+        if (withTiming)
+        {
+            if (result.hierarchical) out.padded("-", 10);
+            else out.fixed(result.fmaxMHz, 2, 10);
+        }
+        out.fixed(result.loadMs, 1, 9);
+        out.fixed(result.analysisMs, 1, 13) << "  " << result.fileName << (result.hierarchical ? " (hierarchical)" : "") << '\n';
+    }
+
+    // Union of the type names, in name order like Netlist::cellTypes
+    std::vector<std::string> typeNames;
+    for (const BatchResult& result : results)
+    {
+        for (const auto& typeCnt : result.cellTypeCnts) typeNames.push_back(typeCnt.first);
+    }
+    std::sort(typeNames.begin(), typeNames.end());
+    typeNames.erase(std::unique(typeNames.begin(), typeNames.end()), typeNames.end());
+    size_t nameWidth = 4;
+    for (const std::string& name : typeNames) nameWidth = std::max(nameWidth, name.size());
+
+    out << "\nCell types:\n\n";
+    out.padded("type", nameWidth, ReportWriter::Align::Left);
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        out.padded("#" + std::to_string(i + 1), 9);
+    }
+    out << '\n';
+    for (const std::string& name : typeNames)
+    {
+        out.padded(name, nameWidth, ReportWriter::Align::Left);
+        for (const BatchResult& result : results)
+        {
+            auto it = std::lower_bound(result.cellTypeCnts.begin(), result.cellTypeCnts.end(), name,
+                [](const auto& typeCnt, const std::string& typeName) { return typeCnt.first < typeName; });
+            if (it == result.cellTypeCnts.end() || it->first != name) out.padded("-", 9);
+            else out.padded(it->second, 9);
+        }
+        out << '\n';
+    }
+
+    if (topCnt == 0) return;
+    out << "\nLongest paths:\n";
+    for (size_t i = 0; i < results.size(); ++i)
+    {
+        const BatchResult& result = results[i];
+        if (! result.error.empty()) continue;
+        out << "\n#" << (i + 1) << " " << result.fileName << " (" << result.architecture << ")\n";
+        if (result.topPaths.empty()) out << "\tFound no routes\n";
+        for (const BatchResult::TopPath& path : result.topPaths)
+        {
+            out << "\tlen: ";
+            out.padded(path.depth, 3) << ", name: ";
+            out.padded(path.endpoint, 50) << ", from: " << (path.start.empty() ? "-" : path.start) << ", src: " << path.endpointSrc << '\n';
+        }
+    }
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "Cell.h"
+#include "Options.h"
+#include "PathAnalysis.h"
+#include "ReportWriter.h"
+#include "ThreadPool.h"
+
+// Results of one netlist of a batch, only what the comparative report needs, so that the netlist itself can be
+// released as soon as it is analyzed
+struct BatchResult
+{
+    std::string fileName;
+    // Empty if the netlist was loaded and analyzed
+    std::string error;
+
+    size_t cellCnt = 0;
+    // Indexed by Cell::Type
+    std::array<size_t, 6> cellCntByType {};
+    // Cell type names as in Netlist::cellTypes
+    std::vector<std::pair<std::string, size_t>> cellTypeCnts;
+    std::string architecture;
+    bool hierarchical = false;
+
+    // Depths of the endpoints that have a path, ascending
+    std::vector<depth_t> endpointDepths;
+    // Longest paths first
+    struct TopPath
+    {
+        depth_t depth;
+        std::string endpoint;
+        std::string endpointSrc;
+        // Launching cell, empty for endpoints inside instances of a hierarchical design
+        std::string start;
+    };
+    std::vector<TopPath> topPaths;
+    // Only with a delay model
+    double fmaxMHz = 0.0;
+
+    size_t estimatedBytes = 0;
+    double loadMs = 0.0;
+    double analysisMs = 0.0;
+
+    depth_t maxDepth() const { return endpointDepths.empty() ? 0 : endpointDepths.back(); }
+    // Nearest rank percentile of endpointDepths, 0 without paths
+    depth_t depthPercentile(unsigned percent) const;
+};
+
+// Expands the batch arguments: "@FILE" reads netlist paths from FILE, one per line, and '*' / '?' in the file
+// name part of a path match the files of its directory, sorted by name. Other arguments are taken as they are.
+// Throws std::invalid_argument for list files that cannot be read and for patterns that match nothing.
+std::vector<std::string> expandNetlistPatterns(const std::vector<std::string>& patterns);
+
+// Loads and analyzes the netlists concurrently, one netlist per pool worker, each of them single threaded. A
+// netlist is only loaded when its estimated memory fits into memoryBudget together with the ones in progress,
+// or when no other one is in progress. Results are in the order of files, failures are recorded in them.
+std::vector<BatchResult> runBatch(const std::vector<std::string>& files, const Options& options, ThreadPool& pool, size_t memoryBudget);
+
+// One row per netlist with cell counts, depth percentiles and times, the cell type names by netlist and the
+// longest paths of each netlist
+void printBatchReport(ReportWriter& out, const std::vector<BatchResult>& results, size_t topCnt, bool withTiming);
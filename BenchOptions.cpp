@@ -0,0 +1,117 @@
+#include "BenchOptions.h"
+
+#include <algorithm>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+/*static*/ BenchOptions BenchOptions::parse(int argc, char* argv[])
+{
+    BenchOptions options;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto nextValue = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "--cells")
+        {
+            options.cellCnts.clear();
+            std::istringstream list(nextValue());
+            std::string item;
+            while (std::getline(list, item, ','))
+            {
+                options.cellCnts.push_back(std::stoul(item));
+            }
+            if (options.cellCnts.empty()) throw std::invalid_argument("No cell counts given");
+            // peak RSS only grows, the small cases have to run first to be measured at all
+            std::sort(options.cellCnts.begin(), options.cellCnts.end());
+        }
+        else if (arg == "--depth")
+        {
+            options.generator.depth = std::stoul(nextValue());
+        }
+        else if (arg == "--fanout-skew")
+        {
+            options.generator.fanoutSkew = std::stod(nextValue());
+            if (options.generator.fanoutSkew <= 0.0) throw std::invalid_argument("Fanout skew has to be positive");
+        }
+        else if (arg == "--carry-chains")
+        {
+            options.generator.carryChainCnt = std::stoul(nextValue());
+        }
+        else if (arg == "--carry-length")
+        {
+            options.generator.carryChainLength = std::stoul(nextValue());
+        }
+        else if (arg == "--rams")
+        {
+            options.generator.ramCnt = std::stoul(nextValue());
+        }
+        else if (arg == "--dff-ratio")
+        {
+            options.generator.dffRatio = std::stod(nextValue());
+            if (options.generator.dffRatio <= 0.0 || options.generator.dffRatio >= 1.0) throw std::invalid_argument("DFF ratio has to be between 0 and 1");
+        }
+        else if (arg == "--seed")
+        {
+            options.generator.seed = std::stoull(nextValue());
+        }
+        else if (arg == "--repeat")
+        {
+            options.repeatCnt = std::max(1ul, std::stoul(nextValue()));
+        }
+        else if (arg == "--threads")
+        {
+            options.threadCnt = std::stoul(nextValue());
+            if (options.threadCnt == 0) options.threadCnt = std::max(1u, std::thread::hardware_concurrency());
+        }
+        else if (arg == "--work-dir")
+        {
+            options.workDir = nextValue();
+        }
+        else if (arg == "--keep")
+        {
+            options.keepNetlists = true;
+        }
+        else if (arg == "--output")
+        {
+            options.outputFile = nextValue();
+        }
+        else if (arg == "--help")
+        {
+            options.showHelp = true;
+        }
+        else
+        {
+            throw std::invalid_argument("Unknown argument: " + arg);
+        }
+    }
+
+    return options;
+}
+
+/*static*/ void BenchOptions::printUsage(std::ostream& os, const char* programName)
+{
+    GeneratorParams defaults;
+    os << "Usage: " << programName << " [options]\n"
+        << "Generates synthetic netlists, runs the analysis phases on them and prints one JSON line per run.\n"
+        << "Options:\n"
+        << "  --cells N[,N...]    Cell counts of the generated netlists (default: 10000,100000)\n"
+        << "  --depth N           LUT levels, the length of the longest path (default: " << defaults.depth << ")\n"
+        << "  --fanout-skew X     1 spreads the fanout evenly, higher values create high fanout nets (default: " << defaults.fanoutSkew << ")\n"
+        << "  --carry-chains N    Number of carry chains (default: " << defaults.carryChainCnt << ")\n"
+        << "  --carry-length N    Carry cells per chain (default: " << defaults.carryChainLength << ")\n"
+        << "  --rams N            Number of RAM blocks (default: " << defaults.ramCnt << ")\n"
+        << "  --dff-ratio X       Share of DFF cells (default: " << defaults.dffRatio << ")\n"
+        << "  --seed N            Random seed of the generator (default: " << defaults.seed << ")\n"
+        << "  --repeat N          Runs per cell count (default: 1)\n"
+        << "  --threads N         Worker threads for loading and the path analysis, 0 for all cores (default: 1)\n"
+        << "  --work-dir DIR      Where to write the generated netlists (default: temp directory)\n"
+        << "  --keep              Keep the generated netlists\n"
+        << "  --output FILE       Append the results to FILE instead of printing them\n"
+        << "  --help              Print this help\n";
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "NetlistGenerator.h"
+
+struct BenchOptions
+{
+    // One benchmark case per cell count, the other generator parameters are shared
+    std::vector<size_t> cellCnts { 10000, 100000 };
+    GeneratorParams generator;
+    size_t repeatCnt = 1;
+    size_t threadCnt = 1;
+    // Directory for the generated netlists, the system's temp directory if empty
+    std::string workDir;
+    bool keepNetlists = false;
+    // JSON Lines are appended to this file, written to stdout if empty
+    std::string outputFile;
+    bool showHelp = false;
+
+    // Throws std::invalid_argument on unknown or malformed arguments
+    static BenchOptions parse(int argc, char* argv[]);
+    static void printUsage(std::ostream& os, const char* programName);
+};
@@ -1,36 +1,27 @@
 #include "Cell.h"
 
+#include "Architecture.h"
 #include "Port.h"
 #include "StringUtils.h"
 
 #include <iostream>
 #include <iomanip>
 
-void Cell::assignPort(std::string portName, Link& link, Port::Type type)
+void Cell::assignPort(std::string_view portName, Link& link, Port::Type type)
 {
-    if (type == Port::Type::INPUT)
-    {
-        Port& port = inputs.emplace(std::piecewise_construct, std::forward_as_tuple(portName), std::forward_as_tuple(portName, *this, link, type)).first->second;
-        port.links.push_back(link);
-        link.outputs.push_back(port);
-    }
-    else if (type == Port::Type::OUTPUT)
-    {
-        Port& port = outputs.try_emplace(portName, portName, *this, link, type).first->second;
-        port.links.push_back(link);
-        if (link.input == nullptr)
-        {
-            link.input = &port;
-        }
-        else
-        {
-            std::cerr << "WARNING: link#" << link.id << " already has a connected input port: " << link.input->name << ", cannot add port " << portName << " as input" << std::endl;
-        }
-    }
-    else
-    {
+    link.attach(attachPort(portName, link, type));
+}
+
+Port& Cell::attachPort(std::string_view portName, Link& link, Port::Type type)
+{
+    std::pmr::memory_resource* resource = inputs.get_allocator().resource();
+    if (type != Port::Type::INPUT && type != Port::Type::OUTPUT)
         throw std::runtime_error("Invalid port type");
-    }
+
+    auto& ports = type == Port::Type::INPUT ? inputs : outputs;
+    Port& port = ports.try_emplace(portName, portName, *this, type, resource).first->second;
+    port.links.push_back(link);
+    return port;
 }
 
 bool Cell::hasLinkTo(const cellId_t cellId)
@@ -49,59 +40,72 @@ bool Cell::hasLinkTo(const Cell& otherCell)
     return hasLinkTo(otherCell.id);
 }
 
-/*static*/ void Cell::crawlForward(const Cell& from, const bool stopOnCircular /* = true */, const size_t maxCellCnt /* = 0 */)
+namespace
 {
-    std::set<cellId_t> visitedCells;
-    doCrawlForward(from, stopOnCircular, maxCellCnt, visitedCells);
+    // A cell reached by the crawl and the connection it was reached through, none for the start cell
+    struct CrawlStep
+    {
+        const Cell* cell;
+        const Port* fromPort = nullptr;
+        const Link* link = nullptr;
+        const Port* toPort = nullptr;
+    };
 }
 
-/*static*/ void Cell::doCrawlForward(const Cell& from, const bool stopOnCircular, const size_t maxCellCnt, std::set<cellId_t>& visitedCells)
+/*static*/ void Cell::crawlForward(const Cell& from, const bool stopOnCircular /* = true */, const size_t maxCellCnt /* = 0 */)
 {
-    std::cout << " Cell #" << std::setw(2) << from.id << " (" << from.type << ")";
-    
-    if (visitedCells.contains(from.id))
-    {
-        std::cerr << "\nCircular network! Found node #" << from.id << " again!\n";
-        if (stopOnCircular)
-            throw std::runtime_error("Circular network");
-        else
-            return;
-    }
+    VisitMarks visitedCells;
+    size_t visitedCnt = 0;
+    std::vector<CrawlStep> stack;
+    depthFirst(stack, CrawlStep { &from }, [&](const CrawlStep& step) {
+        const Cell& cell = *step.cell;
+        if (step.fromPort != nullptr)
+        {
+            const Cell& prevCell = step.fromPort->cell;
+            std::cout << "\n Cell #" << std::setw(2) << prevCell.id << " (" << prevCell.type << ") " << std::setw(2) << step.fromPort->name << " -> " << std::setw(2) << step.link->id << " -> " << std::setw(2) << step.toPort->name << " ->";
+        }
+        std::cout << " Cell #" << std::setw(2) << cell.id << " (" << cell.type << ")";
 
-    visitedCells.insert(from.id);
-    if (maxCellCnt > 0 && visitedCells.size() >= maxCellCnt)
-    {
-        std::cout << "\nMax cell count reached, terminating crawl\n";
-        throw std::runtime_error("Max cell count reached");
-    }
+        if (! visitedCells.visit(cell.id))
+        {
+            std::cerr << "\nCircular network! Found node #" << cell.id << " again!\n";
+            if (stopOnCircular)
+                throw std::runtime_error("Circular network");
+            else
+                return false;
+        }
 
-    bool hasNoConnectedOutputs = true;
-    for (auto& output : from.outputs)
-    {
-        for (const Link& link : output.second.links)
+        if (maxCellCnt > 0 && ++visitedCnt >= maxCellCnt)
         {
-            for (auto inputPort : link.outputs)
+            std::cout << "\nMax cell count reached, terminating crawl\n";
+            throw std::runtime_error("Max cell count reached");
+        }
+        return true;
+    }, [](const CrawlStep& step, auto push) {
+        const Cell& cell = *step.cell;
+        bool hasNoConnectedOutputs = true;
+        for (auto& output : cell.outputs)
+        {
+            for (const Link& link : output.second.links)
             {
-                hasNoConnectedOutputs = false;
-                std::cout << "\n Cell #" << std::setw(2) << from.id << " (" << from.type << ") " << std::setw(2) << output.second.name << " -> " << std::setw(2) << link.id << " -> " << std::setw(2) << inputPort.get().name << " ->";
-                doCrawlForward(inputPort.get().cell, stopOnCircular, maxCellCnt, visitedCells);
+                for (const Port& inputPort : link.outputs)
+                {
+                    hasNoConnectedOutputs = false;
+                    push({ &inputPort.cell, &output.second, &link, &inputPort });
+                }
             }
         }
-    }
-    if (hasNoConnectedOutputs)
-    {
-        std::cout << "\nDead-end: #" << from.id << " (" << from.type << ") (" << from.name << ")" << std::endl;
-    }
+        if (hasNoConnectedOutputs)
+        {
+            std::cout << "\nDead-end: #" << cell.id << " (" << cell.type << ") (" << cell.name << ")" << std::endl;
+        }
+    });
 }
 
-/*static*/ Cell::Type Cell::parseType(const std::string& str)
+/*static*/ Cell::Type Cell::parseType(std::string_view str)
 {
-    if (str == "SB_LUT4") return Cell::Type::LUT;
-    else if (str.starts_with("SB_DFF")) return Cell::Type::DFF;
-    else if (str == "SB_CARRY") return Cell::Type::Carry;
-    else if (str.starts_with("SB_RAM")) return Cell::Type::RAM;
-
-    return Cell::Type::Unknown;
+    Architecture arch = Architecture::Auto;
+    return resolveCellType(str, arch);
 }
 
 std::ostream& operator<<(std::ostream& os, const Cell& lc)
@@ -2,23 +2,27 @@
 
 #include <ostream>
 #include <string>
+#include <string_view>
 #include <iostream>
 #include <map>
 #include <set>
 #include <list>
 #include <functional>
+#include <memory_resource>
+#include <vector>
 
+#include "GraphTraversal.h"
 #include "Port.h"
 
 typedef int cellId_t;
 
-class LogicCell;
-
 struct Cell
 {
     enum class Type
     {
-        Unknown, LUT, DFF, Carry, RAM
+        Unknown, LUT, DFF, Carry, RAM,
+        // Instance of another module of the design
+        Instance
     };
 
     static std::string typeToStr(Type type)
@@ -29,6 +33,7 @@ struct Cell
             case Cell::Type::DFF: return "DFF";
             case Cell::Type::Carry: return "Carry";
             case Cell::Type::RAM: return "RAM";
+            case Cell::Type::Instance: return "Instance";
         }
         return "???";
     }
@@ -36,22 +41,26 @@ struct Cell
     static constexpr cellId_t INVALID_ID = -1; 
 
     cellId_t id = INVALID_ID;
-    std::string name;
-    std::string verilogSrc;
+    // Owned by the netlist, either in its string store or in a mapped file
+    std::string_view name;
+    std::string_view verilogSrc;
+    std::string_view typeName;
     Type type;
-    std::map<std::string, Port> inputs;
-    std::map<std::string, Port> outputs;
-    std::map<cellId_t, std::reference_wrapper<Cell>> outputsByCellId;
+    // Keyed by the interned port names, nodes are allocated from the netlist's arena
+    std::pmr::map<std::string_view, Port> inputs;
+    std::pmr::map<std::string_view, Port> outputs;
+    std::pmr::map<cellId_t, std::reference_wrapper<Cell>> outputsByCellId;
     bool cellIdIndexBuilt = false;
-    LogicCell* parentLC;
 
-    void assignPort(std::string portName, Link& link, Port::Type type);
+    // portName has to outlive the cell
+    void assignPort(std::string_view portName, Link& link, Port::Type type);
+    // The cell side of assignPort, the link is left to Link::attach
+    Port& attachPort(std::string_view portName, Link& link, Port::Type type);
     bool hasLinkTo(const cellId_t cellId);
     bool hasLinkTo(const Cell& otherCell);
 
     static void crawlForward(const Cell& from, const bool stopOnCircular = true, const size_t maxCellCnt = 0);
-    static void doCrawlForward(const Cell& from, const bool stopOnCircular, const size_t maxCellCnt, std::set<cellId_t>& visitedCells);
-    static Type parseType(const std::string& str);
+    static Type parseType(std::string_view str);
     
     template <typename Func>
     void doForAllInputCells(Func func) const
@@ -81,30 +90,29 @@ struct Cell
         }
     }
 
+    // Walks every path forward from this cell, up to maxDepth cells deep, until continuePredicate returns false.
+    // Cells reachable on several paths are passed to callback once per path.
     template <typename Predicate, typename Callback>
     void crawlForwardUntil(Predicate continuePredicate, Callback callback, const size_t maxDepth)
     {
-        if (maxDepth == 0) return;
-        if (! continuePredicate(*this)) return;
-        callback(*this);
-        // TODO better to reuse, but this fails to link :(
-        //auto f1 = std::bind(&Cell::crawlForwardUntil<Predicate, Callback, const size_t>, this, continuePredicate, callback, maxDepth - 1);
-        
-        for (auto& output : outputs)
-        {
-            for (auto& link : output.second.links)
-            {
-                for (auto& port : link.get().outputs)
-                {
-                    port.get().cell.crawlForwardUntil(continuePredicate, callback, maxDepth - 1);
-                }
-            }
-        }
+        std::vector<std::pair<Cell*, size_t>> stack;
+        depthFirst(stack, std::pair<Cell*, size_t>(this, maxDepth), [&](const std::pair<Cell*, size_t>& item) {
+            if (item.second == 0 || ! continuePredicate(*item.first)) return false;
+            callback(*item.first);
+            return true;
+        }, [](const std::pair<Cell*, size_t>& item, auto push) {
+            item.first->doForAllOutputCells([&](Cell& nextCell) {
+                push({ &nextCell, item.second - 1 });
+                return true;
+            });
+        });
     }
 
     Cell() = delete;
-    Cell(cellId_t id, std::string name, Type type) : id(id), name(name), type(type), parentLC(nullptr) {}
-    Cell(cellId_t id, std::string name, std::string typeStr) : Cell(id, name, parseType(typeStr)) {}
+    Cell(cellId_t id, std::string_view name, Type type, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : id(id), name(name), type(type), inputs(resource), outputs(resource), outputsByCellId(resource) {}
+    Cell(cellId_t id, std::string_view name, std::string_view typeStr, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+        : id(id), name(name), typeName(typeStr), type(parseType(typeStr)), inputs(resource), outputs(resource), outputsByCellId(resource) {}
 };
 
 std::ostream& operator<<(std::ostream& os, const Cell& lc);
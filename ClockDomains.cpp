@@ -0,0 +1,421 @@
+#include "ClockDomains.h"
+
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <map>
+#include <unordered_map>
+
+#include "Architecture.h"
+#include "GraphTraversal.h"
+#include "Profiler.h"
+#include "TopK.h"
+
+namespace
+{
+
+// First bit of the input port, Port::INVALID_ID if the cell has no such port or it is constant
+portId_t netOf(const Cell& cell, std::string_view portName)
+{
+    auto it = cell.inputs.find(portName);
+    if (it == cell.inputs.end() || it->second.links.empty()) return Port::INVALID_ID;
+    return it->second.links.front().get().id;
+}
+
+std::string nameOfNet(const Netlist& netlist, const std::unordered_map<portId_t, std::string>& portBitNames, portId_t net)
+{
+    if (net == Port::INVALID_ID) return "(no clock)";
+
+    auto portIt = portBitNames.find(net);
+    if (portIt != portBitNames.end()) return portIt->second;
+
+    if (static_cast<size_t>(net) < netlist.links.size() && netlist.links[net].input != nullptr)
+    {
+        const Port& driver = *netlist.links[net].input;
+        return std::string(driver.cell.name) + "." + std::string(driver.name);
+    }
+    return "net " + std::to_string(net);
+}
+
+// Scratch space of one worker, reused for all domains it analyzes. Everything but localIdxOf is sized to the
+// cone of the domain at hand.
+struct PartitionScratch
+{
+    enum State : uint8_t { Unvisited, Unreached, Reached };
+
+    VisitMarks inCone;
+    std::vector<cellId_t> cone;
+    std::vector<cellId_t> order;
+    std::vector<uint32_t> localIdxOf;
+    std::vector<State> states;
+    std::vector<double> values;
+    std::vector<cellId_t> predecessors;
+    // Domains of the foreign registers behind each cell, wordCnt words per cell
+    std::vector<uint64_t> foreignDomains;
+    size_t wordCnt = 0;
+
+    uint64_t* foreignOf(cellId_t cellId) { return foreignDomains.data() + localIdxOf[cellId] * wordCnt; }
+};
+
+// Longest paths into the capture cells of one domain, through its cone only. The semantics provide which
+// cells delimit the paths, the order to visit the combinational cells in and the value of a path:
+//     bool isStop(cellId), uint64_t orderKey(cellId), span globalOrder of all combinational cells by (orderKey, id),
+//     span loopCellsOf(cellId),
+//     double cellValue(cellId), double endValue(endpoint), double edgeValue(prev, cell),
+//     double startValue(stop, cell) for the value of a path starting at stop, NaN if the stop is no predecessor
+// Stops of the domain and stops without a domain start paths, the other ones mark cells as crossing.
+template <typename Semantics>
+void propagate(const NetlistGraph& graph, const ClockDomains& domains, uint32_t domainIdx, const Semantics& semantics,
+    bool trackCrossings, PartitionScratch& scratch)
+{
+    const std::vector<cellId_t>& endpoints = domains.domains[domainIdx].captureCells;
+    breadthFirst(scratch.inCone, scratch.cone, std::span<const cellId_t>(endpoints), [&](cellId_t cellId) { return graph.faninOf(cellId); },
+        [&](cellId_t cellId, size_t level) { return level == 0 || ! semantics.isStop(cellId); });
+
+    const size_t coneSize = scratch.cone.size();
+    if (scratch.localIdxOf.size() < graph.cellCnt()) scratch.localIdxOf.resize(graph.cellCnt());
+    scratch.order.clear();
+    for (uint32_t localIdx = 0; localIdx < coneSize; ++localIdx)
+    {
+        cellId_t cellId = scratch.cone[localIdx];
+        scratch.localIdxOf[cellId] = localIdx;
+        if (! semantics.isStop(cellId)) scratch.order.push_back(cellId);
+    }
+
+    // Small cones are sorted, large ones picked from the global order in linear time
+    std::span<const cellId_t> globalOrder = semantics.globalOrder;
+    if (scratch.order.size() * 16 < globalOrder.size())
+    {
+        std::sort(scratch.order.begin(), scratch.order.end(), [&](cellId_t a, cellId_t b) {
+            uint64_t keyA = semantics.orderKey(a), keyB = semantics.orderKey(b);
+            return keyA != keyB ? keyA < keyB : a < b;
+        });
+    }
+    else
+    {
+        scratch.order.clear();
+        for (cellId_t cellId : globalOrder)
+        {
+            if (scratch.inCone.isVisited(cellId)) scratch.order.push_back(cellId);
+        }
+    }
+
+    scratch.states.assign(coneSize, PartitionScratch::Unvisited);
+    scratch.values.assign(coneSize, 0.0);
+    scratch.predecessors.assign(coneSize, Cell::INVALID_ID);
+    scratch.wordCnt = trackCrossings ? (domains.domains.size() + 63) / 64 : 0;
+    scratch.foreignDomains.assign(coneSize * scratch.wordCnt, 0);
+
+    // A loop is visited as one unit like in resolveLoops, cells without fanin start paths of every domain
+    auto visitUnit = [&](std::span<const cellId_t> unit, bool isEndpoint) {
+        bool reached = false;
+        bool hasFanin = false;
+        double maxValue = 0.0;
+        cellId_t longestPred = Cell::INVALID_ID;
+        uint64_t* foreign = scratch.foreignOf(unit[0]);
+        auto offer = [&](double value, cellId_t prevCell) {
+            if (longestPred == Cell::INVALID_ID || value > maxValue)
+            {
+                maxValue = value;
+                longestPred = prevCell;
+            }
+        };
+
+        for (cellId_t cellId : unit)
+        {
+            for (cellId_t prevCell : graph.faninOf(cellId))
+            {
+                if (unit.size() > 1 && std::binary_search(unit.begin(), unit.end(), prevCell)) continue;
+                if (prevCell == cellId && ! isEndpoint) continue;
+                hasFanin = true;
+
+                if (semantics.isStop(prevCell))
+                {
+                    uint32_t launchDomain = domains.launchDomainOf[prevCell];
+                    if (launchDomain == ClockDomains::NO_DOMAIN || launchDomain == domainIdx)
+                    {
+                        reached = true;
+                        double value = semantics.startValue(prevCell, cellId);
+                        if (value == value) offer(value, prevCell);
+                    }
+                    else if (trackCrossings)
+                    {
+                        foreign[launchDomain / 64] |= uint64_t(1) << (launchDomain % 64);
+                    }
+                    continue;
+                }
+
+                uint32_t prevIdx = scratch.localIdxOf[prevCell];
+                if (trackCrossings)
+                {
+                    const uint64_t* prevForeign = scratch.foreignOf(prevCell);
+                    for (size_t word = 0; word < scratch.wordCnt; ++word) foreign[word] |= prevForeign[word];
+                }
+                if (scratch.states[prevIdx] != PartitionScratch::Reached) continue;
+                reached = true;
+                offer(scratch.values[prevIdx] + semantics.edgeValue(prevCell, cellId), prevCell);
+            }
+        }
+        if (! hasFanin && ! isEndpoint) reached = true;
+
+        for (cellId_t cellId : unit)
+        {
+            uint32_t localIdx = scratch.localIdxOf[cellId];
+            scratch.states[localIdx] = reached ? PartitionScratch::Reached : PartitionScratch::Unreached;
+            scratch.values[localIdx] = reached ? maxValue + (isEndpoint ? semantics.endValue(cellId) : semantics.cellValue(cellId)) : 0.0;
+            scratch.predecessors[localIdx] = longestPred;
+            if (cellId != unit[0] && trackCrossings) std::copy_n(foreign, scratch.wordCnt, scratch.foreignOf(cellId));
+        }
+    };
+
+    for (const cellId_t& cellId : scratch.order)
+    {
+        if (scratch.states[scratch.localIdxOf[cellId]] == PartitionScratch::Unvisited) visitUnit(semantics.loopCellsOf(cellId), false);
+    }
+    for (const cellId_t& endpoint : endpoints)
+    {
+        visitUnit(std::span<const cellId_t>(&endpoint, 1), true);
+    }
+}
+
+// Walks back from the endpoint through cells behind registers of the source domain to one of them
+std::vector<cellId_t> crossingPath(const NetlistGraph& graph, const PathAnalysis& analysis, const ClockDomains& domains,
+    PartitionScratch& scratch, cellId_t endpoint, uint32_t fromDomain)
+{
+    auto isBehind = [&](cellId_t cellId) {
+        return (scratch.foreignOf(cellId)[fromDomain / 64] >> (fromDomain % 64)) & 1;
+    };
+    std::vector<cellId_t> path { endpoint };
+    for (cellId_t cellId = endpoint; ; )
+    {
+        bool onLoop = ! PathAnalysis::isEndpoint(graph.types[cellId]) && ! analysis.loopOf.empty() && analysis.loopOf[cellId] != PathAnalysis::NO_LOOP;
+        std::span<const cellId_t> unit = onLoop ? std::span<const cellId_t>(analysis.loops[analysis.loopOf[cellId]]) : std::span<const cellId_t>(&cellId, 1);
+        cellId_t next = Cell::INVALID_ID;
+        for (cellId_t unitCell : unit)
+        {
+            for (cellId_t prevCell : graph.faninOf(unitCell))
+            {
+                if (PathAnalysis::isBoundary(graph.types[prevCell]))
+                {
+                    if (domains.launchDomainOf[prevCell] != fromDomain) continue;
+                    path.push_back(prevCell);
+                    return path;
+                }
+                if (next == Cell::INVALID_ID && (! onLoop || analysis.loopOf[prevCell] != analysis.loopOf[cellId]) && isBehind(prevCell)) next = prevCell;
+            }
+        }
+        if (next == Cell::INVALID_ID) return path;
+        path.push_back(next);
+        cellId = next;
+    }
+}
+
+}
+
+/*static*/ ClockDomains ClockDomains::extract(const Netlist& netlist, const NetlistGraph& graph)
+{
+    PROFILE_SCOPE("clock domains");
+    const size_t cellCnt = graph.cellCnt();
+    ClockDomains result;
+    result.captureDomainOf.assign(cellCnt, NO_DOMAIN);
+    result.launchDomainOf.assign(cellCnt, NO_DOMAIN);
+    result.enableNet.assign(cellCnt, Port::INVALID_ID);
+    result.resetNet.assign(cellCnt, Port::INVALID_ID);
+
+    std::unordered_map<portId_t, std::string> portBitNames;
+    for (const ModulePort& port : netlist.ports)
+    {
+        for (size_t bit = 0; bit < port.bits.size(); ++bit)
+        {
+            if (port.bits[bit] == Port::INVALID_ID) continue;
+            portBitNames.try_emplace(port.bits[bit], port.bits.size() == 1 ? port.name : port.name + "[" + std::to_string(bit) + "]");
+        }
+    }
+
+    std::map<std::pair<portId_t, bool>, uint32_t> domainIdxOf;
+    auto domainOf = [&](std::pair<portId_t, bool> clock) {
+        auto it = domainIdxOf.try_emplace(clock, static_cast<uint32_t>(result.domains.size())).first;
+        if (it->second == result.domains.size())
+        {
+            ClockDomain& domain = result.domains.emplace_back();
+            domain.clockNet = clock.first;
+            domain.negEdge = clock.second;
+            domain.name = nameOfNet(netlist, portBitNames, clock.first);
+        }
+        return it->second;
+    };
+
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+    {
+        if (! TimingAnalysis::isSequential(graph.types[cellId])) continue;
+
+        const Cell& cell = *graph.cells[cellId];
+        ControlPorts ports = withArchitecture(netlist.architecture, [&](auto traits) { return decltype(traits)::controlPorts(graph.types[cellId], cell.typeName); });
+        std::pair<portId_t, bool> captureClock { netOf(cell, ports.captureClock), ports.captureNegEdge };
+        std::pair<portId_t, bool> launchClock { netOf(cell, ports.launchClock), ports.launchNegEdge };
+        result.enableNet[cellId] = netOf(cell, ports.enable);
+        for (std::string_view resetPort : ports.resets)
+        {
+            if (result.resetNet[cellId] == Port::INVALID_ID) result.resetNet[cellId] = netOf(cell, resetPort);
+        }
+
+        uint32_t captureDomain = domainOf(captureClock);
+        uint32_t launchDomain = domainOf(launchClock);
+        result.captureDomainOf[cellId] = captureDomain;
+        result.launchDomainOf[cellId] = launchDomain;
+
+        ClockDomain& domain = result.domains[captureDomain];
+        domain.captureCells.push_back(cellId);
+        if (result.enableNet[cellId] != Port::INVALID_ID) ++domain.enableCnt;
+        if (result.resetNet[cellId] != Port::INVALID_ID) ++domain.resetCnt;
+        result.domains[launchDomain].launchCells.push_back(cellId);
+    }
+    return result;
+}
+
+std::vector<DomainAnalysis> analyzeClockDomains(const NetlistGraph& graph, const PathAnalysis& analysis, const ClockDomains& domains,
+    ThreadPool& pool, size_t pathCnt, const TimingAnalysis* timing /* = nullptr */)
+{
+    PROFILE_SCOPE("clock domain partitions");
+    const size_t domainCnt = domains.domains.size();
+    std::vector<DomainAnalysis> results(domainCnt);
+    std::vector<PartitionScratch> workerScratch(pool.threadCnt());
+
+    // Hop counts like analyzeLongestPaths: carry cells are unclocked path starts, paths start behind them
+    struct DepthSemantics
+    {
+        const NetlistGraph& graph;
+        const PathAnalysis& analysis;
+        std::span<const cellId_t> globalOrder;
+
+        bool isStop(cellId_t cellId) const { return PathAnalysis::isBoundary(graph.types[cellId]); }
+        uint64_t orderKey(cellId_t cellId) const { return analysis.depth[cellId]; }
+        std::span<const cellId_t> loopCellsOf(const cellId_t& cellId) const
+        {
+            return analysis.loopOf.empty() || analysis.loopOf[cellId] == PathAnalysis::NO_LOOP
+                ? std::span<const cellId_t>(&cellId, 1) : std::span<const cellId_t>(analysis.loops[analysis.loopOf[cellId]]);
+        }
+        double cellValue(cellId_t) const { return 1.0; }
+        double endValue(cellId_t) const { return 0.0; }
+        double edgeValue(cellId_t, cellId_t) const { return 0.0; }
+        double startValue(cellId_t, cellId_t) const { return std::numeric_limits<double>::quiet_NaN(); }
+    };
+
+    // Arrival times like TimingAnalysis: carry cells are part of the network, paths start at the registers
+    struct DelaySemantics
+    {
+        const NetlistGraph& graph;
+        const TimingAnalysis& timing;
+        std::span<const cellId_t> globalOrder;
+
+        bool isStop(cellId_t cellId) const { return TimingAnalysis::isSequential(graph.types[cellId]); }
+        uint64_t orderKey(cellId_t cellId) const { return timing.topologicalIndex(cellId); }
+        std::span<const cellId_t> loopCellsOf(const cellId_t& cellId) const { return timing.loopCellsOf(cellId); }
+        double cellValue(cellId_t cellId) const { return timing.delayModel().cellDelay(graph.types[cellId]); }
+        double endValue(cellId_t endpoint) const { return timing.delayModel().setupTime(graph.types[endpoint]); }
+        double edgeValue(cellId_t prevCell, cellId_t cellId) const { return timing.netDelay(prevCell, cellId); }
+        double startValue(cellId_t stop, cellId_t cellId) const
+        {
+            return timing.delayModel().clockToOutDelay(graph.types[stop]) + timing.netDelay(stop, cellId);
+        }
+    };
+
+    // Combinational cells by depth, then id
+    std::vector<cellId_t> depthOrder;
+    {
+        depth_t maxDepth = 0;
+        for (depth_t depth : analysis.depth) maxDepth = std::max(maxDepth, depth);
+        std::vector<uint32_t> depthOffsets(static_cast<size_t>(maxDepth) + 2, 0);
+        for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(graph.cellCnt()); ++cellId)
+        {
+            if (! PathAnalysis::isBoundary(graph.types[cellId])) ++depthOffsets[analysis.depth[cellId] + 1];
+        }
+        for (size_t depth = 1; depth < depthOffsets.size(); ++depth) depthOffsets[depth] += depthOffsets[depth - 1];
+        depthOrder.resize(depthOffsets.back());
+        for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(graph.cellCnt()); ++cellId)
+        {
+            if (! PathAnalysis::isBoundary(graph.types[cellId])) depthOrder[depthOffsets[analysis.depth[cellId]]++] = cellId;
+        }
+    }
+
+    // The topological order is a permutation of the combinational cells
+    std::vector<cellId_t> timingOrder;
+    if (timing)
+    {
+        for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(graph.cellCnt()); ++cellId)
+        {
+            if (TimingAnalysis::isSequential(graph.types[cellId])) continue;
+            uint32_t topoIdx = timing->topologicalIndex(cellId);
+            if (topoIdx >= timingOrder.size()) timingOrder.resize(topoIdx + 1, Cell::INVALID_ID);
+            timingOrder[topoIdx] = cellId;
+        }
+    }
+
+    pool.parallelFor(domainCnt, 1, [&](size_t begin, size_t end, size_t workerIdx) {
+        PartitionScratch& scratch = workerScratch[workerIdx];
+        for (uint32_t domainIdx = begin; domainIdx < end; ++domainIdx)
+        {
+            const ClockDomain& domain = domains.domains[domainIdx];
+            DomainAnalysis& result = results[domainIdx];
+
+            if (timing)
+            {
+                propagate(graph, domains, domainIdx, DelaySemantics { graph, *timing, timingOrder }, false, scratch);
+                for (cellId_t endpoint : domain.captureCells)
+                {
+                    result.criticalDelay = std::max(result.criticalDelay, scratch.values[scratch.localIdxOf[endpoint]]);
+                }
+            }
+
+            propagate(graph, domains, domainIdx, DepthSemantics { graph, analysis, depthOrder }, true, scratch);
+            result.coneCellCnt = scratch.cone.size();
+            PROFILE_COUNT("cells visited", scratch.cone.size());
+
+            std::vector<uint32_t> endpointIdxs(domain.captureCells.size());
+            result.endpointDepths.resize(domain.captureCells.size());
+            for (uint32_t endpointIdx = 0; endpointIdx < domain.captureCells.size(); ++endpointIdx)
+            {
+                endpointIdxs[endpointIdx] = endpointIdx;
+                result.endpointDepths[endpointIdx] = static_cast<depth_t>(scratch.values[scratch.localIdxOf[domain.captureCells[endpointIdx]]]);
+            }
+
+            endpointIdxs = selectTop(endpointIdxs, pathCnt, [&](uint32_t a, uint32_t b) {
+                return result.endpointDepths[a] != result.endpointDepths[b] ? result.endpointDepths[a] > result.endpointDepths[b]
+                    : domain.captureCells[a] < domain.captureCells[b];
+            });
+            for (uint32_t endpointIdx : endpointIdxs)
+            {
+                if (result.endpointDepths[endpointIdx] == 0) break;
+                std::vector<cellId_t>& path = result.criticalPaths.emplace_back();
+                cellId_t endpoint = domain.captureCells[endpointIdx];
+                path.push_back(endpoint);
+                for (cellId_t cellId = scratch.predecessors[scratch.localIdxOf[endpoint]]; cellId != Cell::INVALID_ID;
+                    cellId = scratch.predecessors[scratch.localIdxOf[cellId]])
+                {
+                    path.push_back(cellId);
+                }
+            }
+
+            // Capture cells are visited in ascending id order, so the first one seen of every crossing has the lowest id
+            std::vector<uint32_t> crossingIdxOf(domainCnt, ClockDomains::NO_DOMAIN);
+            for (cellId_t endpoint : domain.captureCells)
+            {
+                const uint64_t* foreign = scratch.foreignOf(endpoint);
+                for (size_t word = 0; word < scratch.wordCnt; ++word)
+                {
+                    for (uint64_t bits = foreign[word]; bits != 0; bits &= bits - 1)
+                    {
+                        uint32_t fromDomain = static_cast<uint32_t>(word * 64 + std::countr_zero(bits));
+                        if (crossingIdxOf[fromDomain] == ClockDomains::NO_DOMAIN)
+                        {
+                            crossingIdxOf[fromDomain] = static_cast<uint32_t>(result.crossings.size());
+                            result.crossings.push_back({ fromDomain, 0, crossingPath(graph, analysis, domains, scratch, endpoint, fromDomain) });
+                        }
+                        ++result.crossings[crossingIdxOf[fromDomain]].endpointCnt;
+                    }
+                }
+            }
+        }
+    });
+    return results;
+}
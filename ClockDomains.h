@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Netlist.h"
+#include "NetlistGraph.h"
+#include "PathAnalysis.h"
+#include "ThreadPool.h"
+#include "TimingAnalysis.h"
+
+// DFF and RAM cells grouped by the net and edge of their clock, with the ports given by the architecture's
+// ArchTraits::controlPorts. A DFF launches and captures in the domain of its clock. A RAM launches read data in
+// the domain of its read clock and captures in the one of its write clock, its read address inputs are counted
+// as captured by the write clock as well.
+struct ClockDomain
+{
+    // Port::INVALID_ID for the cells whose clock is unconnected or constant
+    portId_t clockNet = Port::INVALID_ID;
+    bool negEdge = false;
+    // Top module port, driving cell output or net number
+    std::string name;
+
+    std::vector<cellId_t> captureCells;
+    std::vector<cellId_t> launchCells;
+    // Capture cells with a connected enable / set or reset input
+    size_t enableCnt = 0;
+    size_t resetCnt = 0;
+};
+
+struct ClockDomains
+{
+    std::vector<ClockDomain> domains;
+    // Domain indexes of the sequential cells, NO_DOMAIN for all other cells
+    std::vector<uint32_t> captureDomainOf;
+    std::vector<uint32_t> launchDomainOf;
+    // Clock enable and set / reset nets of the sequential cells, Port::INVALID_ID where there is none
+    std::vector<portId_t> enableNet;
+    std::vector<portId_t> resetNet;
+    static constexpr uint32_t NO_DOMAIN = UINT32_MAX;
+
+    // Reads the control nets from the port maps of the DFF and RAM cells. Domains are numbered in the order
+    // of their first cell.
+    static ClockDomains extract(const Netlist& netlist, const NetlistGraph& graph);
+};
+
+// Paths into a domain that start at registers of another one
+struct DomainCrossing
+{
+    uint32_t fromDomain;
+    size_t endpointCnt = 0;
+    // The crossing into the capture cell with the lowest id, starting with it and ending with the launching cell
+    std::vector<cellId_t> examplePath;
+};
+
+struct DomainAnalysis
+{
+    // Cells in the fanin cone of the capture cells, the working set of the domain's partition
+    size_t coneCellCnt = 0;
+    // Longest path into each capture cell that starts in the domain itself or at an unclocked start like a
+    // carry cell, in the order of ClockDomain::captureCells. 0 for capture cells only reached from other domains.
+    std::vector<depth_t> endpointDepths;
+    // The longest of these paths, longest first, each starting with the endpoint like PathAnalysis::pathTo
+    std::vector<std::vector<cellId_t>> criticalPaths;
+    // Latest arrival of such a path including setup time, only with a timing analysis
+    double criticalDelay = 0.0;
+    std::vector<DomainCrossing> crossings;
+
+    double fmaxMHz() const { return criticalDelay > 0.0 ? 1000.0 / criticalDelay : 0.0; }
+};
+
+// Every domain is a partition of its own: only the fanin cone of its capture cells is visited, with scratch
+// space for the cone only, and the domains are analyzed concurrently on the pool. Walks the cones in the order
+// of the global analyses, so analysis (and timing if given) have to be complete. With a single domain the
+// depths and paths are the ones of analysis.
+std::vector<DomainAnalysis> analyzeClockDomains(const NetlistGraph& graph, const PathAnalysis& analysis, const ClockDomains& domains,
+    ThreadPool& pool, size_t pathCnt, const TimingAnalysis* timing = nullptr);
@@ -0,0 +1,97 @@
+#include "CombinationalLoops.h"
+
+#include <algorithm>
+#include <limits>
+
+#include "Profiler.h"
+
+CellComponents findStronglyConnected(const NetlistGraph& graph, std::span<const cellId_t> subgraphCells)
+{
+    PROFILE_SCOPE("strongly connected components");
+    static constexpr uint32_t NONE = std::numeric_limits<uint32_t>::max();
+
+    // Dense indexes of the subgraph cells, NONE outside
+    const uint32_t cellCnt = static_cast<uint32_t>(subgraphCells.size());
+    std::vector<uint32_t> localIdxOf(graph.cellCnt(), NONE);
+    for (uint32_t idx = 0; idx < cellCnt; ++idx)
+    {
+        localIdxOf[subgraphCells[idx]] = idx;
+    }
+
+    std::vector<uint32_t> dfsIdx(cellCnt, NONE);
+    std::vector<uint32_t> lowLink(cellCnt, 0);
+    std::vector<bool> onStack(cellCnt, false);
+    std::vector<uint32_t> componentStack;
+
+    // The recursion of the textbook version: a cell and the next of its fanout entries to follow
+    struct Frame
+    {
+        uint32_t idx;
+        uint32_t fanoutIdx;
+    };
+    std::vector<Frame> callStack;
+    uint32_t nextDfsIdx = 0;
+
+    // Components come out sinks first, they are reversed below
+    CellComponents reversed;
+    auto enter = [&](uint32_t idx) {
+        dfsIdx[idx] = lowLink[idx] = nextDfsIdx++;
+        componentStack.push_back(idx);
+        onStack[idx] = true;
+        callStack.push_back({ idx, graph.fanoutOffsets[subgraphCells[idx]] });
+    };
+
+    for (uint32_t root = 0; root < cellCnt; ++root)
+    {
+        if (dfsIdx[root] != NONE) continue;
+        enter(root);
+        while (! callStack.empty())
+        {
+            Frame& frame = callStack.back();
+            uint32_t idx = frame.idx;
+            if (frame.fanoutIdx < graph.fanoutOffsets[subgraphCells[idx] + 1])
+            {
+                uint32_t nextIdx = localIdxOf[graph.fanout[frame.fanoutIdx++]];
+                if (nextIdx == NONE) continue;
+                if (dfsIdx[nextIdx] == NONE) enter(nextIdx);
+                else if (onStack[nextIdx]) lowLink[idx] = std::min(lowLink[idx], dfsIdx[nextIdx]);
+                continue;
+            }
+
+            callStack.pop_back();
+            if (! callStack.empty())
+            {
+                uint32_t parentIdx = callStack.back().idx;
+                lowLink[parentIdx] = std::min(lowLink[parentIdx], lowLink[idx]);
+            }
+            if (lowLink[idx] != dfsIdx[idx]) continue;
+
+            uint32_t memberIdx;
+            do
+            {
+                memberIdx = componentStack.back();
+                componentStack.pop_back();
+                onStack[memberIdx] = false;
+                reversed.cells.push_back(subgraphCells[memberIdx]);
+            } while (memberIdx != idx);
+            std::sort(reversed.cells.begin() + reversed.offsets.back(), reversed.cells.end());
+            reversed.offsets.push_back(static_cast<uint32_t>(reversed.cells.size()));
+        }
+    }
+
+    CellComponents components;
+    components.cells.reserve(reversed.cells.size());
+    components.offsets.reserve(reversed.offsets.size());
+    for (size_t idx = reversed.size(); idx-- > 0; )
+    {
+        std::span<const cellId_t> component = reversed[idx];
+        components.cells.insert(components.cells.end(), component.begin(), component.end());
+        components.offsets.push_back(static_cast<uint32_t>(components.cells.size()));
+    }
+    return components;
+}
+
+bool isLoop(const NetlistGraph& graph, std::span<const cellId_t> component)
+{
+    return component.size() > 1 || graph.hasLinkTo(component[0], component[0]);
+}
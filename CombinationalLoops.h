@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "NetlistGraph.h"
+
+// Strongly connected components of a subgraph, in topological order of its condensation: every component only
+// has fanin from earlier components and from cells outside the subgraph.
+struct CellComponents
+{
+    // offsets[i] .. offsets[i + 1] index the cells of component i, in ascending id order
+    std::vector<cellId_t> cells;
+    std::vector<uint32_t> offsets { 0 };
+
+    size_t size() const { return offsets.size() - 1; }
+
+    std::span<const cellId_t> operator[](size_t idx) const
+    {
+        return { cells.data() + offsets[idx], cells.data() + offsets[idx + 1] };
+    }
+};
+
+// Iterative Tarjan over the subgraph induced by the given cells, O(cells + their connections) apart from
+// clearing one index per graph cell
+CellComponents findStronglyConnected(const NetlistGraph& graph, std::span<const cellId_t> subgraphCells);
+
+// More than one cell, or a cell feeding itself
+bool isLoop(const NetlistGraph& graph, std::span<const cellId_t> component);
@@ -0,0 +1,258 @@
+#include "CompressedInput.h"
+
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+
+#ifdef FPGA_JSON_ZLIB
+#include <zlib.h>
+#endif
+#ifdef FPGA_JSON_ZSTD
+#include <zstd.h>
+#endif
+
+#include "Profiler.h"
+
+// Compressed input is read in chunks of this size
+static constexpr size_t INPUT_CHUNK_SIZE = 256 << 10;
+
+Compression detectCompression(const std::string& fileName)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    unsigned char magic[4] = {};
+    file.read(reinterpret_cast<char*>(magic), sizeof(magic));
+    if (file.gcount() >= 2 && magic[0] == 0x1f && magic[1] == 0x8b) return Compression::Gzip;
+    if (file.gcount() == 4 && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd) return Compression::Zstd;
+    return Compression::None;
+}
+
+const char* compressionName(Compression compression)
+{
+    switch (compression)
+    {
+        case Compression::Gzip: return "gzip";
+        case Compression::Zstd: return "zstd";
+        default: return "none";
+    }
+}
+
+bool isCompressionSupported(Compression compression)
+{
+    switch (compression)
+    {
+#ifdef FPGA_JSON_ZLIB
+        case Compression::Gzip: return true;
+#endif
+#ifdef FPGA_JSON_ZSTD
+        case Compression::Zstd: return true;
+#endif
+        case Compression::None: return true;
+        default: return false;
+    }
+}
+
+DecompressingStreamBuf::DecompressingStreamBuf(const std::string& fileName, Compression compression,
+    size_t blockSize /* = DEFAULT_BLOCK_SIZE */, size_t blockCnt /* = DEFAULT_BLOCK_CNT */)
+    : input(fileName, std::ios::binary), compression(compression), blockSize(blockSize), blocks(blockCnt), blockSizes(blockCnt, 0)
+{
+    if (! input)
+        throw std::runtime_error("Could not open file: " + fileName);
+    if (compression == Compression::None || ! isCompressionSupported(compression))
+        throw std::runtime_error(std::string("No ") + compressionName(compression) + " support in this build: " + fileName);
+
+    for (std::vector<char>& block : blocks) block.resize(blockSize);
+    thread = std::thread(&DecompressingStreamBuf::run, this);
+}
+
+DecompressingStreamBuf::~DecompressingStreamBuf()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    spaceAvailable.notify_one();
+    thread.join();
+}
+
+DecompressingStreamBuf::int_type DecompressingStreamBuf::underflow()
+{
+    if (gptr() < egptr()) return traits_type::to_int_type(*gptr());
+
+    std::unique_lock<std::mutex> lock(mutex);
+    if (holdingBlock)
+    {
+        holdingBlock = false;
+        ++consumedCnt;
+        spaceAvailable.notify_one();
+    }
+    dataAvailable.wait(lock, [&]() { return producedCnt > consumedCnt || finished; });
+    if (producedCnt == consumedCnt)
+    {
+        if (error) std::rethrow_exception(error);
+        return traits_type::eof();
+    }
+
+    size_t slot = consumedCnt % blocks.size();
+    holdingBlock = true;
+    char* begin = blocks[slot].data();
+    setg(begin, begin, begin + blockSizes[slot]);
+    return traits_type::to_int_type(*begin);
+}
+
+char* DecompressingStreamBuf::acquireBlock()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    spaceAvailable.wait(lock, [&]() { return producedCnt - consumedCnt < blocks.size() || stopping; });
+    return stopping ? nullptr : blocks[producedCnt % blocks.size()].data();
+}
+
+void DecompressingStreamBuf::publishBlock(size_t size)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        blockSizes[producedCnt % blocks.size()] = size;
+        ++producedCnt;
+    }
+    decompressed.fetch_add(size, std::memory_order_relaxed);
+    dataAvailable.notify_one();
+}
+
+void DecompressingStreamBuf::run()
+{
+    PROFILE_SCOPE("decompress");
+    try
+    {
+        if (compression == Compression::Gzip) inflateGzip();
+        else decompressZstd();
+    }
+    catch (std::exception&)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::current_exception();
+    }
+    PROFILE_COUNT("bytes decompressed", decompressedBytes());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        finished = true;
+    }
+    dataAvailable.notify_one();
+}
+
+void DecompressingStreamBuf::inflateGzip()
+{
+#ifdef FPGA_JSON_ZLIB
+    z_stream stream = {};
+    // Window size 15 with gzip header detection
+    if (inflateInit2(&stream, 15 + 32) != Z_OK)
+        throw std::runtime_error("Could not initialize zlib");
+    std::unique_ptr<z_stream, decltype(&inflateEnd)> streamGuard(&stream, &inflateEnd);
+
+    std::vector<char> chunk(INPUT_CHUNK_SIZE);
+    char* block = acquireBlock();
+    if (! block) return;
+    stream.next_out = reinterpret_cast<Bytef*>(block);
+    stream.avail_out = static_cast<uInt>(blockSize);
+
+    bool endOfInput = false;
+    // Inside a gzip member, concatenated members are decompressed one after the other like gzip -d does
+    bool inMember = false;
+    size_t memberCnt = 0;
+    while (true)
+    {
+        if (stream.avail_in == 0 && ! endOfInput)
+        {
+            input.read(chunk.data(), chunk.size());
+            stream.next_in = reinterpret_cast<Bytef*>(chunk.data());
+            stream.avail_in = static_cast<uInt>(input.gcount());
+            endOfInput = stream.avail_in == 0;
+        }
+
+        // Like gzip -d, bytes after the last member that do not start another one (e.g. zero padding) are ignored
+        if (memberCnt > 0 && ! inMember && stream.avail_in > 0 && (stream.next_in[0] != 0x1f || (stream.avail_in > 1 && stream.next_in[1] != 0x8b)))
+        {
+            std::cerr << "WARNING: trailing garbage after the gzip data ignored" << std::endl;
+            break;
+        }
+
+        int result = inflate(&stream, Z_NO_FLUSH);
+        if (result == Z_STREAM_END)
+        {
+            inMember = false;
+            ++memberCnt;
+            inflateReset(&stream);
+        }
+        else if (result == Z_OK)
+        {
+            inMember = true;
+        }
+        else if (result != Z_BUF_ERROR)
+        {
+            throw std::runtime_error(std::string("Invalid gzip data: ") + (stream.msg ? stream.msg : zError(result)));
+        }
+
+        if (stream.avail_out == 0)
+        {
+            publishBlock(blockSize);
+            if (! (block = acquireBlock())) return;
+            stream.next_out = reinterpret_cast<Bytef*>(block);
+            stream.avail_out = static_cast<uInt>(blockSize);
+        }
+        else if (endOfInput)
+        {
+            break;
+        }
+    }
+
+    if (stream.avail_out < blockSize) publishBlock(blockSize - stream.avail_out);
+    if (inMember) throw std::runtime_error("Truncated gzip data");
+#endif
+}
+
+void DecompressingStreamBuf::decompressZstd()
+{
+#ifdef FPGA_JSON_ZSTD
+    std::unique_ptr<ZSTD_DCtx, decltype(&ZSTD_freeDCtx)> context(ZSTD_createDCtx(), &ZSTD_freeDCtx);
+    if (! context)
+        throw std::runtime_error("Could not initialize zstd");
+
+    std::vector<char> chunk(INPUT_CHUNK_SIZE);
+    ZSTD_inBuffer in = { chunk.data(), 0, 0 };
+    char* block = acquireBlock();
+    if (! block) return;
+    ZSTD_outBuffer out = { block, blockSize, 0 };
+
+    bool endOfInput = false;
+    // 0 once a frame is complete, zstd decompresses concatenated frames on its own
+    size_t remaining = 0;
+    while (true)
+    {
+        if (in.pos == in.size && ! endOfInput)
+        {
+            input.read(chunk.data(), chunk.size());
+            in = { chunk.data(), static_cast<size_t>(input.gcount()), 0 };
+            endOfInput = in.size == 0;
+        }
+        // Without input, a call after the end of a frame only returns the size of the next frame header
+        if (endOfInput && remaining == 0) break;
+
+        remaining = ZSTD_decompressStream(context.get(), &out, &in);
+        if (ZSTD_isError(remaining))
+            throw std::runtime_error(std::string("Invalid zstd data: ") + ZSTD_getErrorName(remaining));
+
+        if (out.pos == out.size)
+        {
+            publishBlock(blockSize);
+            if (! (block = acquireBlock())) return;
+            out = { block, blockSize, 0 };
+        }
+        else if (endOfInput)
+        {
+            break;
+        }
+    }
+
+    if (out.pos > 0) publishBlock(out.pos);
+    if (remaining != 0) throw std::runtime_error("Truncated zstd data");
+#endif
+}
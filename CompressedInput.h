@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <fstream>
+#include <mutex>
+#include <streambuf>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class Compression
+{
+    None, Gzip, Zstd
+};
+
+// By the magic bytes at the start of the file, None if it cannot be read
+Compression detectCompression(const std::string& fileName);
+const char* compressionName(Compression compression);
+// Whether the build found the library for it, None is always supported
+bool isCompressionSupported(Compression compression);
+
+// Decompresses a gzip or zstd file on a thread of its own into a ring of fixed size blocks, which the reading
+// side consumes as they are filled, so that decompression and parsing overlap and at most blockCnt blocks of the
+// decompressed text are in memory. Errors of the decompression are thrown from underflow() as std::runtime_error
+// once the data before them has been read.
+class DecompressingStreamBuf : public std::streambuf
+{
+public:
+    static constexpr size_t DEFAULT_BLOCK_SIZE = 1 << 20;
+    static constexpr size_t DEFAULT_BLOCK_CNT = 4;
+
+    // Throws std::runtime_error if the file cannot be opened or the build does not support the compression
+    DecompressingStreamBuf(const std::string& fileName, Compression compression, size_t blockSize = DEFAULT_BLOCK_SIZE, size_t blockCnt = DEFAULT_BLOCK_CNT);
+    ~DecompressingStreamBuf() override;
+
+    DecompressingStreamBuf(const DecompressingStreamBuf&) = delete;
+    DecompressingStreamBuf& operator=(const DecompressingStreamBuf&) = delete;
+
+    size_t decompressedBytes() const { return decompressed.load(std::memory_order_relaxed); }
+
+protected:
+    int_type underflow() override;
+
+private:
+    void run();
+    void inflateGzip();
+    void decompressZstd();
+
+    // The next free block for the decompression thread, nullptr if the reader is gone
+    char* acquireBlock();
+    void publishBlock(size_t size);
+
+    std::ifstream input;
+    Compression compression;
+    size_t blockSize;
+    std::vector<std::vector<char>> blocks;
+    std::vector<size_t> blockSizes;
+
+    std::mutex mutex;
+    std::condition_variable dataAvailable;
+    std::condition_variable spaceAvailable;
+    // Blocks published by the decompression thread and released by the reader, the reader holds the block
+    // consumedCnt while it is reading it
+    size_t producedCnt = 0;
+    size_t consumedCnt = 0;
+    bool holdingBlock = false;
+    bool finished = false;
+    bool stopping = false;
+    std::exception_ptr error;
+    std::atomic<size_t> decompressed = 0;
+
+    std::thread thread;
+};
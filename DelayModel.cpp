@@ -0,0 +1,75 @@
+#include "DelayModel.h"
+
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+static Cell::Type parseTypeName(const std::string& name)
+{
+    for (Cell::Type type : { Cell::Type::LUT, Cell::Type::DFF, Cell::Type::Carry, Cell::Type::RAM })
+    {
+        if (Cell::typeToStr(type) == name) return type;
+    }
+    if (name == "Unknown") return Cell::Type::Unknown;
+
+    throw std::runtime_error("Unknown cell type in timing table: " + name);
+}
+
+/*static*/ DelayModel DelayModel::ice40()
+{
+    DelayModel model;
+    model.cellDelays[static_cast<size_t>(Cell::Type::LUT)] = 0.45;
+    model.cellDelays[static_cast<size_t>(Cell::Type::Carry)] = 0.13;
+    model.clockToOut[static_cast<size_t>(Cell::Type::DFF)] = 0.54;
+    model.clockToOut[static_cast<size_t>(Cell::Type::RAM)] = 2.25;
+    model.setupTimes[static_cast<size_t>(Cell::Type::DFF)] = 0.47;
+    model.setupTimes[static_cast<size_t>(Cell::Type::RAM)] = 0.26;
+    model.netBase = 0.80;
+    model.netPerFanout = 0.03;
+    model.carryNet = 0.0;
+    return model;
+}
+
+/*static*/ DelayModel DelayModel::load(const std::string& fileName)
+{
+    std::ifstream file(fileName);
+    if (! file)
+        throw std::runtime_error("Could not open timing table: " + fileName);
+
+    DelayModel model;
+    std::string line;
+    size_t lineNo = 0;
+    while (std::getline(file, line))
+    {
+        ++lineNo;
+        size_t commentPos = line.find('#');
+        if (commentPos != std::string::npos) line.erase(commentPos);
+
+        std::istringstream ss(line);
+        std::string key;
+        if (! (ss >> key)) continue;
+
+        auto readValue = [&]() {
+            double value;
+            if (! (ss >> value))
+                throw std::runtime_error(fileName + ":" + std::to_string(lineNo) + ": missing or invalid value");
+            return value;
+        };
+        auto readType = [&]() {
+            std::string typeName;
+            if (! (ss >> typeName))
+                throw std::runtime_error(fileName + ":" + std::to_string(lineNo) + ": missing cell type");
+            return static_cast<size_t>(parseTypeName(typeName));
+        };
+
+        if (key == "cell") { size_t type = readType(); model.cellDelays[type] = readValue(); }
+        else if (key == "clk_to_out") { size_t type = readType(); model.clockToOut[type] = readValue(); }
+        else if (key == "setup") { size_t type = readType(); model.setupTimes[type] = readValue(); }
+        else if (key == "net_base") model.netBase = readValue();
+        else if (key == "net_per_fanout") model.netPerFanout = readValue();
+        else if (key == "carry_net") model.carryNet = readValue();
+        else throw std::runtime_error(fileName + ":" + std::to_string(lineNo) + ": unknown key " + key);
+    }
+
+    return model;
+}
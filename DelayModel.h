@@ -0,0 +1,40 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <string>
+
+#include "Cell.h"
+
+// Per cell type intrinsic delays plus a fanout dependent net delay, all in ns
+struct DelayModel
+{
+    static constexpr size_t TYPE_CNT = static_cast<size_t>(Cell::Type::Instance) + 1;
+
+    // Input to output delay of combinational cells
+    std::array<double, TYPE_CNT> cellDelays = {};
+    // Clock to output delay of sequential cells, i.e. the arrival time of paths starting there
+    std::array<double, TYPE_CNT> clockToOut = {};
+    // Setup time of sequential cells, added to the arrival time of paths ending there
+    std::array<double, TYPE_CNT> setupTimes = {};
+
+    double netBase = 0.0;
+    double netPerFanout = 0.0;
+    // Nets between two carry cells use the dedicated carry chain instead of general routing
+    double carryNet = 0.0;
+
+    double cellDelay(Cell::Type type) const { return cellDelays[static_cast<size_t>(type)]; }
+    double clockToOutDelay(Cell::Type type) const { return clockToOut[static_cast<size_t>(type)]; }
+    double setupTime(Cell::Type type) const { return setupTimes[static_cast<size_t>(type)]; }
+
+    double netDelay(size_t fanout) const
+    {
+        return netBase + netPerFanout * (fanout > 0 ? fanout - 1 : 0);
+    }
+
+    // Rough iCE40 HX figures, same as timing/ice40-hx.timing
+    static DelayModel ice40();
+
+    // Reads a timing table, see timing/ice40-hx.timing for the format. Throws std::runtime_error on errors.
+    static DelayModel load(const std::string& fileName);
+};
@@ -0,0 +1,78 @@
+#include "Design.h"
+
+#include <set>
+#include <stdexcept>
+
+#include "Profiler.h"
+
+Netlist& Design::addModule(const std::string& name)
+{
+    auto& module = modules[name];
+    if (! module)
+    {
+        module = std::make_unique<Netlist>();
+        module->moduleName = name;
+        module->architecture = architecture;
+    }
+    return *module;
+}
+
+void Design::resolveHierarchy()
+{
+    PROFILE_SCOPE("hierarchy resolution");
+    std::set<std::string_view> instantiated;
+    for (auto& modulePair : modules)
+    {
+        for (Cell* cellPtr : modulePair.second->cells)
+        {
+            Cell& cell = *cellPtr;
+            auto moduleIt = modules.find(cell.typeName);
+            if (cell.type == Cell::Type::Unknown && moduleIt != modules.end() && ! moduleIt->second->isBlackbox)
+            {
+                cell.type = Cell::Type::Instance;
+                instantiated.insert(cell.typeName);
+            }
+        }
+    }
+
+    topModuleName.clear();
+    for (const auto& modulePair : modules)
+    {
+        if (modulePair.second->isTop)
+        {
+            topModuleName = modulePair.first;
+            return;
+        }
+    }
+
+    if (modules.size() == 1)
+    {
+        topModuleName = modules.begin()->first;
+    }
+    else if (modules.contains(std::string_view("top")))
+    {
+        topModuleName = "top";
+    }
+    else
+    {
+        for (const auto& modulePair : modules)
+        {
+            if (instantiated.contains(modulePair.first) || modulePair.second->isBlackbox) continue;
+            if (! topModuleName.empty())
+                throw std::out_of_range("Cannot determine the top module, both " + topModuleName + " and " + modulePair.first + " are candidates");
+            topModuleName = modulePair.first;
+        }
+    }
+
+    if (topModuleName.empty())
+        throw std::out_of_range("No top module found");
+}
+
+bool Design::isHierarchical() const
+{
+    for (const Cell* cell : topModule().cells)
+    {
+        if (cell->type == Cell::Type::Instance) return true;
+    }
+    return false;
+}
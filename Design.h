@@ -0,0 +1,29 @@
+#pragma once
+
+#include <map>
+#include <memory>
+#include <string>
+
+#include "Netlist.h"
+
+// All modules of a Yosys netlist
+struct Design
+{
+    std::map<std::string, std::unique_ptr<Netlist>, std::less<>> modules;
+    std::string topModuleName;
+    // Given to the modules added afterwards
+    Architecture architecture = Architecture::Auto;
+
+    Netlist& addModule(const std::string& name);
+
+    Netlist& topModule() { return *modules.at(topModuleName); }
+    const Netlist& topModule() const { return *modules.at(topModuleName); }
+
+    // Picks the top module and turns cells referring to other modules into instances. The top module is the one
+    // with the "top" attribute, or the only module, or the one named "top", or the only one never instantiated.
+    // Throws std::out_of_range if there is none.
+    void resolveHierarchy();
+
+    // True if the top module instantiates other modules, i.e. the design was not flattened
+    bool isHierarchical() const;
+};
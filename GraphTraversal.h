@@ -0,0 +1,95 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Traversals with explicit work lists instead of recursion, so they run at any netlist depth. The work lists
+// and visit marks are passed in by the caller, who can keep them between traversals to reuse their memory.
+
+// Visited flags for dense ids, grows on demand. clear() starts a new epoch instead of touching every mark.
+class VisitMarks
+{
+public:
+    explicit VisitMarks(size_t idCnt = 0) : marks(idCnt, 0) {}
+
+    void clear()
+    {
+        if (++epoch == 0)
+        {
+            std::fill(marks.begin(), marks.end(), 0);
+            epoch = 1;
+        }
+    }
+
+    bool isVisited(size_t id) const
+    {
+        return id < marks.size() && marks[id] == epoch;
+    }
+
+    // Returns false if the id was visited before
+    bool visit(size_t id)
+    {
+        if (id >= marks.size()) marks.resize(id + 1, 0);
+        if (marks[id] == epoch) return false;
+        marks[id] = epoch;
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> marks;
+    uint32_t epoch = 1;
+};
+
+// Depth first preorder from root, in the same order as the recursive walk
+//     visit(item); for (child : children(item)) walk(child);
+// visit(item) returns whether to descend, forEachChild(item, push) calls push(child) for the children in order.
+// Items are not marked, an item reachable on two ways is visited twice like in the recursive walk: put a
+// VisitMarks check into visit for graphs. stack is cleared first, only its capacity is reused.
+template <typename Item, typename Visit, typename ForEachChild>
+void depthFirst(std::vector<Item>& stack, Item root, Visit visit, ForEachChild forEachChild)
+{
+    stack.clear();
+    stack.push_back(std::move(root));
+    while (! stack.empty())
+    {
+        Item item = std::move(stack.back());
+        stack.pop_back();
+        if (! visit(item)) continue;
+
+        size_t childrenBegin = stack.size();
+        forEachChild(item, [&](Item child) { stack.push_back(std::move(child)); });
+        std::reverse(stack.begin() + childrenBegin, stack.end());
+    }
+}
+
+// Breadth first from the roots over neighbors(id), a range of ids. Every reached id is passed to visit(id, level)
+// exactly once, level by level with the roots on level 0. The traversal continues behind an id if visit returns
+// true and its level is below maxLevel. marks and queue are cleared first; afterwards queue holds the reached
+// ids in visiting order and marks has them marked.
+template <typename Id, typename Neighbors, typename Visit>
+void breadthFirst(VisitMarks& marks, std::vector<Id>& queue, std::span<const Id> roots, Neighbors neighbors, Visit visit,
+    size_t maxLevel = SIZE_MAX)
+{
+    marks.clear();
+    queue.clear();
+    for (Id root : roots)
+    {
+        if (marks.visit(root)) queue.push_back(root);
+    }
+
+    size_t idx = 0;
+    for (size_t level = 0; idx < queue.size(); ++level)
+    {
+        for (size_t levelEnd = queue.size(); idx < levelEnd; ++idx)
+        {
+            Id id = queue[idx];
+            if (! visit(id, level) || level >= maxLevel) continue;
+            for (Id next : neighbors(id))
+            {
+                if (marks.visit(next)) queue.push_back(next);
+            }
+        }
+    }
+}
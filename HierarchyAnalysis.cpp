@@ -0,0 +1,570 @@
+#include "HierarchyAnalysis.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "Profiler.h"
+
+namespace
+{
+    constexpr uint32_t NO_NET = std::numeric_limits<uint32_t>::max();
+    constexpr int32_t NONE = ModuleSummary::NONE;
+
+    struct NetEdge
+    {
+        uint32_t from;
+        depth_t weight;
+        // Combinational cell or instance the edge passes through
+        const Cell* via;
+    };
+
+    struct InstanceRef
+    {
+        const Cell* cell;
+        const ModuleSummary* summary;
+        // Net index of every input / output bit of the summary, NO_NET if unconnected
+        std::vector<uint32_t> inputNets;
+        std::vector<uint32_t> outputNets;
+    };
+
+    // Consumer of a net where a path ends: a register of the module, or a register inside an instance
+    struct NetSink
+    {
+        const Cell* reg;
+        uint32_t instance;
+        uint32_t bit;
+    };
+
+    struct EndpointDepth
+    {
+        int32_t depth = NONE;
+        std::string name;
+    };
+
+    // Nets of one module as nodes. Combinational cells connect each of their input nets to each of their output
+    // nets with weight 1, instances connect them according to the arcs of their module summary.
+    class ModuleNetGraph
+    {
+    public:
+        template <typename SummaryOf>
+        ModuleNetGraph(const Netlist& netlist, bool isTop, SummaryOf summaryOf)
+        {
+            struct PendingEdge
+            {
+                uint32_t to;
+                NetEdge edge;
+            };
+            std::vector<PendingEdge> edges;
+            std::vector<std::pair<uint32_t, NetSink>> sinks;
+
+            for (const ModulePort& port : netlist.ports)
+            {
+                auto& portNets = port.direction == Port::Type::INPUT ? inputNets : outputNets;
+                for (portId_t bit : port.bits)
+                {
+                    portNets.push_back(netOf(bit));
+                }
+            }
+
+            for (const Cell* cellPtr : netlist.cells)
+            {
+                const Cell& cell = *cellPtr;
+                switch (cell.type)
+                {
+                    case Cell::Type::DFF:
+                    case Cell::Type::RAM:
+                        for (const auto& input : cell.inputs)
+                        {
+                            for (const Link& link : input.second.links)
+                            {
+                                sinks.push_back({ netOf(link.id), NetSink { &cell, 0, 0 } });
+                            }
+                        }
+                        [[fallthrough]];
+                    case Cell::Type::Carry:
+                        forOutputNets(cell, [&](uint32_t net) { driverBase(net) = 0; });
+                        break;
+
+                    case Cell::Type::Instance:
+                    {
+                        const ModuleSummary& summary = summaryOf(cell.typeName);
+                        InstanceRef& instance = instances.emplace_back(InstanceRef { &cell, &summary,
+                            std::vector<uint32_t>(summary.inputs.size(), NO_NET), std::vector<uint32_t>(summary.outputs.size(), NO_NET) });
+
+                        auto portsIt = netlist.unknownCellPorts.find(cell.id);
+                        if (portsIt != netlist.unknownCellPorts.end())
+                        {
+                            for (const auto& portPair : portsIt->second)
+                            {
+                                bool isInput = portPair.second.type == Port::Type::INPUT;
+                                const auto& firstBits = isInput ? summary.firstInput : summary.firstOutput;
+                                const auto& summaryBits = isInput ? summary.inputs : summary.outputs;
+                                auto& instanceNets = isInput ? instance.inputNets : instance.outputNets;
+
+                                auto firstIt = firstBits.find(portPair.first);
+                                if (firstIt == firstBits.end()) continue;
+                                for (size_t k = 0; k < portPair.second.bits.size(); ++k)
+                                {
+                                    size_t bitIdx = firstIt->second + k;
+                                    if (bitIdx >= summaryBits.size() || summaryBits[bitIdx].portName != portPair.first) break;
+                                    instanceNets[bitIdx] = netOf(portPair.second.bits[k]);
+                                }
+                            }
+                        }
+
+                        const uint32_t instanceIdx = instances.size() - 1;
+                        for (uint32_t o = 0; o < instance.outputNets.size(); ++o)
+                        {
+                            if (instance.outputNets[o] == NO_NET) continue;
+                            int32_t& base = driverBase(instance.outputNets[o]);
+                            base = std::max(base, summary.registerToOutput[o]);
+                        }
+                        for (uint32_t i = 0; i < instance.inputNets.size(); ++i)
+                        {
+                            if (instance.inputNets[i] == NO_NET) continue;
+                            if (summary.inputToRegister[i] != NONE)
+                                sinks.push_back({ instance.inputNets[i], NetSink { nullptr, instanceIdx, i } });
+                            for (const auto& arc : summary.arcs[i])
+                            {
+                                if (instance.outputNets[arc.first] != NO_NET)
+                                    edges.push_back({ instance.outputNets[arc.first], NetEdge { instance.inputNets[i], arc.second, &cell } });
+                            }
+                        }
+                        break;
+                    }
+
+                    default:
+                    {
+                        std::vector<uint32_t> cellInputs;
+                        for (const auto& input : cell.inputs)
+                        {
+                            for (const Link& link : input.second.links)
+                            {
+                                cellInputs.push_back(netOf(link.id));
+                            }
+                        }
+                        forOutputNets(cell, [&](uint32_t net) {
+                            // a combinational cell without inputs starts a path of its own
+                            if (cellInputs.empty()) driverBase(net) = 1;
+                            for (uint32_t from : cellInputs)
+                            {
+                                edges.push_back({ net, NetEdge { from, 1, &cell } });
+                            }
+                        });
+                        break;
+                    }
+                }
+            }
+
+            const uint32_t netCnt = netIds.size();
+            base.resize(netCnt, NONE);
+            for (uint32_t net = 0; net < netCnt; ++net)
+            {
+                if (base[net] == NONE && ! hasDriver[net]) base[net] = 0;
+            }
+            if (! isTop)
+            {
+                // paths from outside only enter through the per input bit passes
+                for (uint32_t net : inputNets)
+                {
+                    if (net != NO_NET) base[net] = NONE;
+                }
+            }
+
+            buildCsr(edges, sinks, netCnt);
+            sortTopologically();
+        }
+
+        const std::vector<int32_t>& baseArrivals() const { return base; }
+
+        // Longest path propagation over all nets in topological order
+        std::vector<int32_t> propagate(std::vector<const NetEdge*>* predecessors) const
+        {
+            std::vector<int32_t> arrival = base;
+            if (predecessors) predecessors->assign(arrival.size(), nullptr);
+
+            for (uint32_t net : topoOrder)
+            {
+                for (uint32_t e = faninOffsets[net]; e < faninOffsets[net + 1]; ++e)
+                {
+                    const NetEdge& edge = fanin[e];
+                    if (arrival[edge.from] == NONE) continue;
+                    int32_t candidate = arrival[edge.from] + static_cast<int32_t>(edge.weight);
+                    if (candidate > arrival[net])
+                    {
+                        arrival[net] = candidate;
+                        if (predecessors) (*predecessors)[net] = &edge;
+                    }
+                }
+            }
+            return arrival;
+        }
+
+        // Propagation of a single launching net, only visits its fanout cone. arrival has to be all NONE on entry
+        // and is reset to that before returning, the reached nets are returned in topological order together with
+        // their arrival.
+        std::vector<std::pair<uint32_t, int32_t>> propagateCone(uint32_t startNet, std::vector<int32_t>& arrival) const
+        {
+            std::vector<uint32_t> cone { startNet };
+            std::vector<bool>& inCone = coneMarks;
+            inCone[startNet] = true;
+            for (size_t i = 0; i < cone.size(); ++i)
+            {
+                for (uint32_t f = fanoutOffsets[cone[i]]; f < fanoutOffsets[cone[i] + 1]; ++f)
+                {
+                    uint32_t next = fanout[f];
+                    if (inCone[next] || topoPos[next] == NO_NET) continue;
+                    inCone[next] = true;
+                    cone.push_back(next);
+                }
+            }
+            std::sort(cone.begin() + 1, cone.end(), [&](uint32_t a, uint32_t b) { return topoPos[a] < topoPos[b]; });
+
+            arrival[startNet] = 0;
+            for (size_t i = 1; i < cone.size(); ++i)
+            {
+                uint32_t net = cone[i];
+                for (uint32_t e = faninOffsets[net]; e < faninOffsets[net + 1]; ++e)
+                {
+                    const NetEdge& edge = fanin[e];
+                    if (arrival[edge.from] != NONE)
+                        arrival[net] = std::max(arrival[net], arrival[edge.from] + static_cast<int32_t>(edge.weight));
+                }
+            }
+
+            std::vector<std::pair<uint32_t, int32_t>> reached;
+            reached.reserve(cone.size());
+            for (uint32_t net : cone)
+            {
+                if (arrival[net] != NONE) reached.emplace_back(net, arrival[net]);
+                arrival[net] = NONE;
+                inCone[net] = false;
+            }
+            return reached;
+        }
+
+        // Deepest register reached through the sinks of the given net
+        void updateEndpoint(uint32_t net, int32_t arrival, EndpointDepth& best) const
+        {
+            for (uint32_t s = sinkOffsets[net]; s < sinkOffsets[net + 1]; ++s)
+            {
+                const NetSink& sink = sinkList[s];
+                if (sink.reg != nullptr)
+                {
+                    if (arrival > best.depth)
+                    {
+                        best.depth = arrival;
+                        best.name = sink.reg->name;
+                    }
+                }
+                else
+                {
+                    const InstanceRef& instance = instances[sink.instance];
+                    int32_t depth = arrival + instance.summary->inputToRegister[sink.bit];
+                    if (depth > best.depth)
+                    {
+                        best.depth = depth;
+                        best.name = std::string(instance.cell->name) + "/" + instance.summary->inputToRegisterName[sink.bit];
+                    }
+                }
+            }
+        }
+
+        uint32_t netCnt() const { return netIds.size(); }
+
+        uint32_t findNet(portId_t netId) const
+        {
+            auto it = netIndex.find(netId);
+            return it == netIndex.end() ? NO_NET : it->second;
+        }
+
+        std::vector<uint32_t> inputNets;
+        std::vector<uint32_t> outputNets;
+        std::vector<InstanceRef> instances;
+
+    private:
+        uint32_t netOf(portId_t netId)
+        {
+            if (netId == Port::INVALID_ID) return NO_NET;
+            auto it = netIndex.try_emplace(netId, netIds.size()).first;
+            if (it->second == netIds.size())
+            {
+                netIds.push_back(netId);
+                hasDriver.push_back(false);
+                base.push_back(NONE);
+            }
+            return it->second;
+        }
+
+        int32_t& driverBase(uint32_t net)
+        {
+            hasDriver[net] = true;
+            return base[net];
+        }
+
+        template <typename Func>
+        void forOutputNets(const Cell& cell, Func func)
+        {
+            for (const auto& output : cell.outputs)
+            {
+                for (const Link& link : output.second.links)
+                {
+                    uint32_t net = netOf(link.id);
+                    hasDriver[net] = true;
+                    func(net);
+                }
+            }
+        }
+
+        template <typename PendingEdge>
+        void buildCsr(std::vector<PendingEdge>& edges, std::vector<std::pair<uint32_t, NetSink>>& sinks, uint32_t netCnt)
+        {
+            faninOffsets.assign(netCnt + 1, 0);
+            fanoutOffsets.assign(netCnt + 1, 0);
+            for (const auto& pending : edges)
+            {
+                ++faninOffsets[pending.to + 1];
+                ++fanoutOffsets[pending.edge.from + 1];
+            }
+            for (uint32_t net = 0; net < netCnt; ++net)
+            {
+                faninOffsets[net + 1] += faninOffsets[net];
+                fanoutOffsets[net + 1] += fanoutOffsets[net];
+            }
+
+            fanin.resize(edges.size());
+            fanout.resize(edges.size());
+            std::vector<uint32_t> faninFill(faninOffsets.begin(), faninOffsets.end() - 1);
+            std::vector<uint32_t> fanoutFill(fanoutOffsets.begin(), fanoutOffsets.end() - 1);
+            for (const auto& pending : edges)
+            {
+                fanin[faninFill[pending.to]++] = pending.edge;
+                fanout[fanoutFill[pending.edge.from]++] = pending.to;
+            }
+
+            sinkOffsets.assign(netCnt + 1, 0);
+            for (const auto& sink : sinks) ++sinkOffsets[sink.first + 1];
+            for (uint32_t net = 0; net < netCnt; ++net) sinkOffsets[net + 1] += sinkOffsets[net];
+            sinkList.resize(sinks.size());
+            std::vector<uint32_t> sinkFill(sinkOffsets.begin(), sinkOffsets.end() - 1);
+            for (const auto& sink : sinks) sinkList[sinkFill[sink.first]++] = sink.second;
+
+            coneMarks.assign(netCnt, false);
+        }
+
+        // Kahn's algorithm, nets on or behind loops stay unordered and keep their base arrival
+        void sortTopologically()
+        {
+            const uint32_t netCnt = netIds.size();
+            std::vector<uint32_t> pending(netCnt);
+            std::vector<uint32_t> ready;
+            for (uint32_t net = 0; net < netCnt; ++net)
+            {
+                pending[net] = faninOffsets[net + 1] - faninOffsets[net];
+                if (pending[net] == 0) ready.push_back(net);
+            }
+
+            topoPos.assign(netCnt, NO_NET);
+            while (! ready.empty())
+            {
+                uint32_t net = ready.back();
+                ready.pop_back();
+                topoPos[net] = topoOrder.size();
+                topoOrder.push_back(net);
+                for (uint32_t f = fanoutOffsets[net]; f < fanoutOffsets[net + 1]; ++f)
+                {
+                    if (--pending[fanout[f]] == 0) ready.push_back(fanout[f]);
+                }
+            }
+        }
+
+        std::unordered_map<portId_t, uint32_t> netIndex;
+        std::vector<portId_t> netIds;
+        std::vector<bool> hasDriver;
+        std::vector<int32_t> base;
+
+        std::vector<uint32_t> faninOffsets;
+        std::vector<NetEdge> fanin;
+        std::vector<uint32_t> fanoutOffsets;
+        std::vector<uint32_t> fanout;
+        std::vector<uint32_t> sinkOffsets;
+        std::vector<NetSink> sinkList;
+
+        std::vector<uint32_t> topoOrder;
+        std::vector<uint32_t> topoPos;
+        mutable std::vector<bool> coneMarks;
+    };
+
+    void updateInstanceInternals(const ModuleNetGraph& graph, EndpointDepth& best)
+    {
+        for (const InstanceRef& instance : graph.instances)
+        {
+            if (instance.summary->internalDepth > best.depth)
+            {
+                best.depth = instance.summary->internalDepth;
+                best.name = std::string(instance.cell->name) + "/" + instance.summary->internalEndpoint;
+            }
+        }
+    }
+}
+
+const ModuleSummary& HierarchyAnalysis::summaryOf(const std::string& moduleName)
+{
+    auto it = summaries.find(moduleName);
+    if (it != summaries.end())
+    {
+        PROFILE_COUNT("module summary memo hits", 1);
+        return it->second;
+    }
+
+    if (std::find(inProgress.begin(), inProgress.end(), moduleName) != inProgress.end())
+        throw std::runtime_error("Recursive instantiation of module " + moduleName);
+    inProgress.push_back(moduleName);
+    PROFILE_SCOPE("module summary");
+
+    const Netlist& netlist = *design.modules.at(moduleName);
+    ModuleNetGraph graph(netlist, false, [&](std::string_view childName) -> const ModuleSummary& { return summaryOf(std::string(childName)); });
+
+    ModuleSummary summary;
+    summary.moduleName = moduleName;
+    for (const ModulePort& port : netlist.ports)
+    {
+        auto& bits = port.direction == Port::Type::INPUT ? summary.inputs : summary.outputs;
+        auto& firstBits = port.direction == Port::Type::INPUT ? summary.firstInput : summary.firstOutput;
+        firstBits.emplace(port.name, bits.size());
+        for (uint32_t k = 0; k < port.bits.size(); ++k)
+        {
+            bits.push_back({ port.name, k, port.bits[k] });
+        }
+    }
+
+    for (const Cell* cell : netlist.cells)
+    {
+        summary.flatCellCnt += cell->type == Cell::Type::Instance ? 0 : 1;
+    }
+    for (const InstanceRef& instance : graph.instances)
+    {
+        summary.flatCellCnt += instance.summary->flatCellCnt;
+    }
+
+    // paths launched inside the module
+    std::vector<int32_t> arrival = graph.propagate(nullptr);
+    EndpointDepth internal;
+    for (uint32_t net = 0; net < graph.netCnt(); ++net)
+    {
+        if (arrival[net] != NONE) graph.updateEndpoint(net, arrival[net], internal);
+    }
+    updateInstanceInternals(graph, internal);
+    summary.internalDepth = internal.depth;
+    summary.internalEndpoint = internal.name;
+
+    summary.registerToOutput.resize(summary.outputs.size(), NONE);
+    std::unordered_multimap<uint32_t, uint32_t> outputBitsOfNet;
+    for (uint32_t o = 0; o < graph.outputNets.size(); ++o)
+    {
+        if (graph.outputNets[o] == NO_NET) continue;
+        summary.registerToOutput[o] = arrival[graph.outputNets[o]];
+        outputBitsOfNet.emplace(graph.outputNets[o], o);
+    }
+
+    // paths entering through each input bit, restricted to the bit's fanout cone
+    summary.arcs.resize(summary.inputs.size());
+    summary.inputToRegister.resize(summary.inputs.size(), NONE);
+    summary.inputToRegisterName.resize(summary.inputs.size());
+    std::fill(arrival.begin(), arrival.end(), NONE);
+    for (uint32_t i = 0; i < graph.inputNets.size(); ++i)
+    {
+        if (graph.inputNets[i] == NO_NET) continue;
+
+        EndpointDepth reachedRegister;
+        for (const auto& [net, netArrival] : graph.propagateCone(graph.inputNets[i], arrival))
+        {
+            graph.updateEndpoint(net, netArrival, reachedRegister);
+            auto range = outputBitsOfNet.equal_range(net);
+            for (auto outIt = range.first; outIt != range.second; ++outIt)
+            {
+                summary.arcs[i].emplace_back(outIt->second, netArrival);
+            }
+        }
+        summary.inputToRegister[i] = reachedRegister.depth;
+        summary.inputToRegisterName[i] = reachedRegister.name;
+    }
+
+    inProgress.pop_back();
+    return summaries.emplace(moduleName, std::move(summary)).first->second;
+}
+
+std::vector<HierarchyAnalysis::EndpointResult> HierarchyAnalysis::analyzeTop()
+{
+    PROFILE_SCOPE("hierarchical analysis");
+    const Netlist& top = design.topModule();
+    ModuleNetGraph graph(top, true, [&](std::string_view childName) -> const ModuleSummary& { return summaryOf(std::string(childName)); });
+
+    std::vector<const NetEdge*> predecessors;
+    std::vector<int32_t> arrival = graph.propagate(&predecessors);
+
+    std::vector<EndpointResult> results;
+
+    auto tracePath = [&](uint32_t net, std::vector<const Cell*>& path) {
+        for (const NetEdge* edge = predecessors[net]; edge != nullptr; edge = predecessors[edge->from])
+        {
+            path.push_back(edge->via);
+        }
+    };
+
+    // registers of the top module itself
+    for (const Cell* cellPtr : top.cells)
+    {
+        const Cell& cell = *cellPtr;
+        if (! PathAnalysis::isEndpoint(cell.type)) continue;
+
+        int32_t depth = NONE;
+        uint32_t deepestNet = NO_NET;
+        for (const auto& input : cell.inputs)
+        {
+            for (const Link& link : input.second.links)
+            {
+                uint32_t net = graph.findNet(link.id);
+                if (net != NO_NET && arrival[net] > depth)
+                {
+                    depth = arrival[net];
+                    deepestNet = net;
+                }
+            }
+        }
+        if (depth == NONE) continue;
+
+        EndpointResult& result = results.emplace_back(EndpointResult { std::string(cell.name), cell.verilogSrc, static_cast<depth_t>(depth), { &cell } });
+        tracePath(deepestNet, result.path);
+    }
+
+    // registers inside the instances, reached from inside or from the top module
+    for (const InstanceRef& instance : graph.instances)
+    {
+        const ModuleSummary& summary = *instance.summary;
+        int32_t depth = summary.internalDepth;
+        std::string name = summary.internalEndpoint;
+        uint32_t deepestNet = NO_NET;
+        for (uint32_t i = 0; i < instance.inputNets.size(); ++i)
+        {
+            uint32_t net = instance.inputNets[i];
+            if (net == NO_NET || arrival[net] == NONE || summary.inputToRegister[i] == NONE) continue;
+            if (arrival[net] + summary.inputToRegister[i] > depth)
+            {
+                depth = arrival[net] + summary.inputToRegister[i];
+                name = summary.inputToRegisterName[i];
+                deepestNet = net;
+            }
+        }
+        if (depth == NONE) continue;
+
+        EndpointResult& result = results.emplace_back(EndpointResult { std::string(instance.cell->name) + "/" + name,
+            instance.cell->verilogSrc, static_cast<depth_t>(depth), { instance.cell } });
+        if (deepestNet != NO_NET) tracePath(deepestNet, result.path);
+    }
+
+    std::stable_sort(results.begin(), results.end(), [](const EndpointResult& a, const EndpointResult& b) { return a.depth > b.depth; });
+    return results;
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "Design.h"
+#include "PathAnalysis.h"
+
+// Boundary to boundary depths of a module definition, as seen from an instance of it. Bits are indexed in port
+// order of the module's input / output ports.
+struct ModuleSummary
+{
+    static constexpr int32_t NONE = -1;
+
+    struct PortBit
+    {
+        std::string portName;
+        uint32_t bitIdx;
+        portId_t net;
+    };
+
+    std::string moduleName;
+    std::vector<PortBit> inputs;
+    std::vector<PortBit> outputs;
+    // Index of the first bit of each port in inputs / outputs
+    std::map<std::string, uint32_t, std::less<>> firstInput;
+    std::map<std::string, uint32_t, std::less<>> firstOutput;
+
+    // arcs[input] lists the output bits reachable from the input bit together with the longest combinational depth
+    std::vector<std::vector<std::pair<uint32_t, depth_t>>> arcs;
+    // Longest depth from the input bit to a register inside, NONE if none is reachable
+    std::vector<int32_t> inputToRegister;
+    std::vector<std::string> inputToRegisterName;
+    // Longest depth from a register inside to the output bit, NONE if the output is not driven by any
+    std::vector<int32_t> registerToOutput;
+    // Longest register to register path inside the module
+    int32_t internalDepth = NONE;
+    std::string internalEndpoint;
+
+    // Primitive cells of the flattened module
+    size_t flatCellCnt = 0;
+};
+
+// Analyzes non-flattened designs. Every module definition is summarized once, instances only apply the summary
+// of their definition to the depths arriving at their inputs.
+class HierarchyAnalysis
+{
+public:
+    struct EndpointResult
+    {
+        // Hierarchical name, instance names separated by '/'
+        std::string name;
+        std::string_view verilogSrc;
+        depth_t depth;
+        // Cells of the longest path in the top module, starting with the endpoint. For endpoints inside instances it
+        // starts with the instance cell, the cells inside are not listed.
+        std::vector<const Cell*> path;
+    };
+
+    explicit HierarchyAnalysis(const Design& design) : design(design) {}
+
+    // Throws std::runtime_error on recursive instantiation
+    const ModuleSummary& summaryOf(const std::string& moduleName);
+
+    // All endpoints of the top module including the ones inside instances, ordered by decreasing depth
+    std::vector<EndpointResult> analyzeTop();
+
+    size_t summaryCnt() const { return summaries.size(); }
+
+private:
+    const Design& design;
+    std::map<std::string, ModuleSummary, std::less<>> summaries;
+    std::vector<std::string> inProgress;
+};
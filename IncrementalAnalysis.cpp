@@ -0,0 +1,376 @@
+#include "IncrementalAnalysis.h"
+
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "GraphTraversal.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+
+namespace
+{
+    constexpr uint32_t MAGIC = 0x54534a46; // "FJST"
+    constexpr uint32_t VERSION = 3;
+    // relaxing a cell of the cones costs a few times more than in the full pass, beyond an eighth of the cells
+    // the restricted pass doesn't pay off
+    constexpr size_t FULL_PASS_DIVISOR = 8;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t cellCnt;
+        uint64_t nameBytes;
+    };
+
+    // FNV-1a
+    void hashBytes(uint64_t& hash, std::string_view bytes)
+    {
+        for (char c : bytes)
+        {
+            hash = (hash ^ static_cast<unsigned char>(c)) * 0x100000001b3ull;
+        }
+        // separator, so "ab" + "c" differs from "a" + "bc"
+        hash = (hash ^ 0xffu) * 0x100000001b3ull;
+    }
+
+    void hashValue(uint64_t& hash, uint64_t value)
+    {
+        hash = (hash ^ value) * 0x100000001b3ull;
+        hash ^= hash >> 29;
+    }
+
+    // The port name ids of the graph depend on the order the names were seen in, their hashes don't
+    std::vector<uint64_t> portNameHashes(const NetlistGraph& graph)
+    {
+        std::vector<uint64_t> hashes(graph.portNames.size(), 0xcbf29ce484222325ull);
+        for (size_t portNameIdx = 0; portNameIdx < graph.portNames.size(); ++portNameIdx)
+        {
+            hashBytes(hashes[portNameIdx], graph.portNames[portNameIdx]);
+        }
+        return hashes;
+    }
+
+    // Hash of the cell's type and its fanin cells and ports. The fanin cells are given by stateIdOf, their ids in the
+    // state the signature is compared with.
+    template <typename StateIdOf>
+    uint64_t faninSignatureOf(const NetlistGraph& graph, const std::vector<uint64_t>& portHashes, cellId_t cellId, StateIdOf stateIdOf)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        hashValue(hash, static_cast<uint64_t>(graph.types[cellId]));
+        for (uint32_t f = graph.faninOffsets[cellId]; f < graph.faninOffsets[cellId + 1]; ++f)
+        {
+            hashValue(hash, static_cast<uint32_t>(stateIdOf(graph.fanin[f])));
+            hashValue(hash, portHashes[graph.faninPort[f]]);
+        }
+        return hash;
+    }
+
+    std::vector<cellId_t> sortedByDepth(std::vector<cellId_t> endpoints, const std::vector<depth_t>& depth)
+    {
+        std::sort(endpoints.begin(), endpoints.end(), [&](cellId_t a, cellId_t b) {
+            return depth[a] != depth[b] ? depth[a] > depth[b] : a < b;
+        });
+        return endpoints;
+    }
+}
+
+std::vector<cellId_t> AnalysisState::pathTo(cellId_t endpoint) const
+{
+    std::vector<cellId_t> path;
+    for (cellId_t cellId = endpoint; cellId != Cell::INVALID_ID; cellId = predecessor[cellId])
+    {
+        path.push_back(cellId);
+    }
+    return path;
+}
+
+std::vector<cellId_t> AnalysisState::sortedEndpoints() const
+{
+    std::vector<cellId_t> endpoints;
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt()); ++cellId)
+    {
+        if (PathAnalysis::isEndpoint(types[cellId])) endpoints.push_back(cellId);
+    }
+    return sortedByDepth(std::move(endpoints), depth);
+}
+
+/*static*/ AnalysisState AnalysisState::capture(const NetlistGraph& graph, const PathAnalysis& analysis)
+{
+    PROFILE_SCOPE("state capture");
+    AnalysisState state;
+    state.types = graph.types;
+    state.depth = analysis.depth;
+    state.predecessor = analysis.predecessor;
+    state.onLoop = analysis.onLoop;
+
+    const std::vector<uint64_t> portHashes = portNameHashes(graph);
+    state.faninSignature.resize(graph.cellCnt());
+    size_t nameBytes = 0;
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(graph.cellCnt()); ++cellId)
+    {
+        state.faninSignature[cellId] = faninSignatureOf(graph, portHashes, cellId, [](cellId_t faninId) { return faninId; });
+        nameBytes += graph.cells[cellId]->name.size();
+    }
+
+    state.nameData.reserve(nameBytes);
+    state.nameOffsets.reserve(graph.cellCnt() + 1);
+    state.nameOffsets.push_back(0);
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(graph.cellCnt()); ++cellId)
+    {
+        state.nameData += graph.cells[cellId]->name;
+        state.nameOffsets.push_back(state.nameData.size());
+    }
+    return state;
+}
+
+/*static*/ AnalysisState AnalysisState::load(const std::string& fileName)
+{
+    PROFILE_SCOPE("state load");
+    MappedFile file(fileName);
+    PROFILE_COUNT("bytes read", file.size());
+
+    Header header;
+    if (file.size() < sizeof(header)) throw std::runtime_error("Truncated state file: " + fileName);
+    std::memcpy(&header, file.data(), sizeof(header));
+    if (header.magic != MAGIC || header.version != VERSION) throw std::runtime_error("Unsupported state file: " + fileName);
+
+    const uint64_t n = header.cellCnt;
+    const uint64_t expectedSize = sizeof(header) + n * (sizeof(uint8_t) * 2 + sizeof(depth_t) + sizeof(cellId_t) + sizeof(uint64_t))
+        + (n + 1) * sizeof(uint64_t) + header.nameBytes;
+    if (file.size() != expectedSize) throw std::runtime_error("Truncated state file: " + fileName);
+
+    AnalysisState state;
+    const char* pos = file.data() + sizeof(header);
+    auto readVector = [&](auto& vec, size_t size) {
+        vec.resize(size);
+        std::memcpy(vec.data(), pos, size * sizeof(vec[0]));
+        pos += size * sizeof(vec[0]);
+    };
+
+    std::vector<uint8_t> types, onLoop;
+    readVector(types, n);
+    readVector(onLoop, n);
+    readVector(state.depth, n);
+    readVector(state.predecessor, n);
+    readVector(state.faninSignature, n);
+    readVector(state.nameOffsets, n + 1);
+    state.nameData.assign(pos, header.nameBytes);
+
+    state.types.resize(n);
+    state.onLoop.resize(n);
+    for (uint64_t i = 0; i < n; ++i)
+    {
+        if (types[i] > static_cast<uint8_t>(Cell::Type::Instance) || state.nameOffsets[i + 1] > header.nameBytes
+            || state.nameOffsets[i] > state.nameOffsets[i + 1] || state.predecessor[i] >= static_cast<cellId_t>(n))
+            throw std::runtime_error("Corrupt state file: " + fileName);
+        state.types[i] = static_cast<Cell::Type>(types[i]);
+        state.onLoop[i] = onLoop[i] != 0;
+    }
+    return state;
+}
+
+void AnalysisState::save(const std::string& fileName) const
+{
+    PROFILE_SCOPE("state save");
+    Header header { MAGIC, VERSION, cellCnt(), nameData.size() };
+
+    std::vector<uint8_t> typeBytes(cellCnt()), onLoopBytes(cellCnt());
+    for (size_t i = 0; i < cellCnt(); ++i)
+    {
+        typeBytes[i] = static_cast<uint8_t>(types[i]);
+        onLoopBytes[i] = onLoop[i] ? 1 : 0;
+    }
+
+    // write next to the final file and rename, so a crash never leaves a partial state behind
+    const std::string tempFileName = fileName + ".tmp";
+    {
+        std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+        if (! file)
+            throw std::runtime_error("Could not create state file: " + tempFileName);
+
+        auto writeVector = [&](const auto& vec) {
+            file.write(reinterpret_cast<const char*>(vec.data()), vec.size() * sizeof(vec[0]));
+        };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeVector(typeBytes);
+        writeVector(onLoopBytes);
+        writeVector(depth);
+        writeVector(predecessor);
+        writeVector(faninSignature);
+        writeVector(nameOffsets);
+        file.write(nameData.data(), nameData.size());
+        if (! file)
+            throw std::runtime_error("Could not write state file: " + tempFileName);
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempFileName, fileName, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tempFileName, ec);
+        throw std::runtime_error("Could not replace state file: " + fileName);
+    }
+}
+
+IncrementalAnalysis analyzeLongestPathsIncremental(const NetlistGraph& graph, const AnalysisState& previous)
+{
+    PROFILE_SCOPE("incremental longest paths");
+    const size_t cellCnt = graph.cellCnt();
+
+    IncrementalAnalysis incremental;
+    PathAnalysis& result = incremental.analysis;
+    result.depth.assign(cellCnt, 0);
+    result.predecessor.assign(cellCnt, Cell::INVALID_ID);
+    result.onLoop.assign(cellCnt, false);
+
+    // the loaders number the cells in file order, which mostly survives a resynthesis, so only the cells that
+    // moved need the name index
+    std::unordered_map<std::string_view, cellId_t> previousByName;
+    auto findPrevious = [&](cellId_t cellId) {
+        std::string_view name = graph.cells[cellId]->name;
+        if (static_cast<size_t>(cellId) < previous.cellCnt() && previous.nameOf(cellId) == name) return cellId;
+        if (previousByName.empty())
+        {
+            previousByName.reserve(previous.cellCnt());
+            for (cellId_t oldId = 0; oldId < static_cast<cellId_t>(previous.cellCnt()); ++oldId)
+            {
+                previousByName.emplace(previous.nameOf(oldId), oldId);
+            }
+        }
+        auto it = previousByName.find(name);
+        return it == previousByName.end() ? Cell::INVALID_ID : it->second;
+    };
+
+    // match the cells by name first, the signatures refer to the fanin cells by their previous ids
+    std::vector<cellId_t> oldIdOf(cellCnt);
+    std::vector<cellId_t> newIdOf(previous.cellCnt(), Cell::INVALID_ID);
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+    {
+        oldIdOf[cellId] = findPrevious(cellId);
+        if (oldIdOf[cellId] != Cell::INVALID_ID) newIdOf[oldIdOf[cellId]] = cellId;
+    }
+
+    // unchanged cells take over the previous result
+    const std::vector<uint64_t> portHashes = portNameHashes(graph);
+    std::vector<cellId_t> changedCells;
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+    {
+        if (PathAnalysis::isEndpoint(graph.types[cellId])) result.endpoints.push_back(cellId);
+
+        cellId_t oldId = oldIdOf[cellId];
+        if (oldId == Cell::INVALID_ID || previous.types[oldId] != graph.types[cellId]
+            || previous.faninSignature[oldId] != faninSignatureOf(graph, portHashes, cellId, [&](cellId_t faninId) { return oldIdOf[faninId]; }))
+        {
+            changedCells.push_back(cellId);
+            continue;
+        }
+        result.depth[cellId] = previous.depth[oldId];
+        result.onLoop[cellId] = previous.onLoop[oldId];
+    }
+    incremental.changedCellCnt = changedCells.size();
+    incremental.removedCellCnt = std::count(newIdOf.begin(), newIdOf.end(), Cell::INVALID_ID);
+
+    auto fullPass = [&]() {
+        result = analyzeLongestPaths(graph);
+        incremental.recomputedCellCnt = cellCnt;
+    };
+    if (changedCells.size() > cellCnt / FULL_PASS_DIVISOR)
+    {
+        fullPass();
+        return incremental;
+    }
+
+    // an unchanged cell keeps its predecessor, which is unchanged as well: a removed or renamed fanin would
+    // have changed the signature
+    for (cellId_t oldId = 0; oldId < static_cast<cellId_t>(previous.cellCnt()); ++oldId)
+    {
+        cellId_t cellId = newIdOf[oldId];
+        if (cellId != Cell::INVALID_ID && previous.predecessor[oldId] != Cell::INVALID_ID)
+            result.predecessor[cellId] = newIdOf[previous.predecessor[oldId]];
+    }
+
+    // fanout cones of the changed cells, unchanged boundaries end the cones
+    VisitMarks inCone(cellCnt);
+    std::vector<cellId_t> cone;
+    breadthFirst<cellId_t>(inCone, cone, changedCells, [&](cellId_t cellId) { return graph.fanoutOf(cellId); }, [&](cellId_t cellId, size_t level) {
+        return level == 0 || ! PathAnalysis::isBoundary(graph.types[cellId]);
+    });
+    if (cone.size() > cellCnt / FULL_PASS_DIVISOR)
+    {
+        fullPass();
+        return incremental;
+    }
+    incremental.recomputedCellCnt = cone.size();
+    PROFILE_COUNT("cells visited", cone.size());
+
+    // Kahn's algorithm restricted to the cones, fanins outside keep their depth. A loop is either completely
+    // inside the cones or outside, the cells on or behind loops in the cones are resolved like in the full pass.
+    std::vector<uint32_t> pendingInputs(cellCnt, 0);
+    std::vector<cellId_t> ready;
+    for (cellId_t cellId : cone)
+    {
+        result.predecessor[cellId] = Cell::INVALID_ID;
+        result.depth[cellId] = 0;
+        if (PathAnalysis::isBoundary(graph.types[cellId])) continue;
+
+        for (cellId_t prevCell : graph.faninOf(cellId))
+        {
+            if (PathAnalysis::isBoundary(graph.types[prevCell])) continue;
+            if (inCone.isVisited(prevCell)) ++pendingInputs[cellId];
+        }
+        result.onLoop[cellId] = false;
+        if (pendingInputs[cellId] == 0) ready.push_back(cellId);
+    }
+
+    size_t edgeCnt = 0;
+    auto relax = [&](cellId_t cellId) {
+        depth_t maxDepth = 0;
+        cellId_t longestPred = Cell::INVALID_ID;
+        edgeCnt += graph.faninOf(cellId).size();
+        for (cellId_t prevCell : graph.faninOf(cellId))
+        {
+            if (PathAnalysis::isBoundary(graph.types[prevCell])) continue;
+            if (longestPred == Cell::INVALID_ID || result.depth[prevCell] > maxDepth)
+            {
+                maxDepth = result.depth[prevCell];
+                longestPred = prevCell;
+            }
+        }
+        result.predecessor[cellId] = longestPred;
+        return maxDepth;
+    };
+
+    while (! ready.empty())
+    {
+        cellId_t cellId = ready.back();
+        ready.pop_back();
+        result.depth[cellId] = relax(cellId) + 1;
+
+        for (cellId_t nextCell : graph.fanoutOf(cellId))
+        {
+            if (inCone.isVisited(nextCell) && ! PathAnalysis::isBoundary(graph.types[nextCell]) && --pendingInputs[nextCell] == 0)
+                ready.push_back(nextCell);
+        }
+    }
+
+    std::vector<cellId_t> unorderedCells;
+    for (cellId_t cellId : cone)
+    {
+        if (pendingInputs[cellId] != 0) unorderedCells.push_back(cellId);
+    }
+    if (! unorderedCells.empty()) resolveLoops(graph, result, unorderedCells);
+
+    for (cellId_t cellId : cone)
+    {
+        if (PathAnalysis::isEndpoint(graph.types[cellId])) result.depth[cellId] = relax(cellId);
+    }
+    PROFILE_COUNT("edges traversed", edgeCnt);
+
+    result.indexLoops(graph);
+    return incremental;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Cell.h"
+#include "NetlistGraph.h"
+#include "PathAnalysis.h"
+
+// Per cell result of a path analysis, saved after a run so that the next run on a slightly edited netlist only
+// recomputes the fanout cones of the cells that changed. Cells are matched by name.
+struct AnalysisState
+{
+    std::vector<Cell::Type> types;
+    std::vector<depth_t> depth;
+    // Index into this state, Cell::INVALID_ID where the path starts
+    std::vector<cellId_t> predecessor;
+    std::vector<bool> onLoop;
+    // Hash of the cell's type, the ids of its fanin cells in this state and the names of their ports
+    std::vector<uint64_t> faninSignature;
+    std::vector<uint64_t> nameOffsets;
+    std::string nameData;
+
+    size_t cellCnt() const { return types.size(); }
+
+    std::string_view nameOf(cellId_t cellId) const
+    {
+        return std::string_view(nameData).substr(nameOffsets[cellId], nameOffsets[cellId + 1] - nameOffsets[cellId]);
+    }
+
+    // Same order and content as PathAnalysis::pathTo and PathAnalysis::sortedEndpoints of the saved run
+    std::vector<cellId_t> pathTo(cellId_t endpoint) const;
+    std::vector<cellId_t> sortedEndpoints() const;
+
+    static AnalysisState capture(const NetlistGraph& graph, const PathAnalysis& analysis);
+
+    // Throws std::runtime_error if the file cannot be read or has an unexpected format
+    static AnalysisState load(const std::string& fileName);
+    // Throws std::runtime_error if the file cannot be written
+    void save(const std::string& fileName) const;
+};
+
+struct IncrementalAnalysis
+{
+    PathAnalysis analysis;
+    // New cells and cells whose type or fanin changed
+    size_t changedCellCnt = 0;
+    // Cells of the previous run without a counterpart
+    size_t removedCellCnt = 0;
+    // Cells in the fanout cones of the changed ones, only these were relaxed again. All cells if the cones were too
+    // large and a full pass was run instead.
+    size_t recomputedCellCnt = 0;
+};
+
+// Gives the same depths and paths as analyzeLongestPaths(graph), reusing the previous results outside the fanout
+// cones of changed cells. Falls back to the full pass when the cones cover more than an eighth of the cells.
+IncrementalAnalysis analyzeLongestPathsIncremental(const NetlistGraph& graph, const AnalysisState& previous);
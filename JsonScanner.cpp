@@ -0,0 +1,87 @@
+#include "JsonScanner.h"
+
+#include <stdexcept>
+
+/*[[noreturn]]*/ void JsonScanner::fail(const std::string& message) const
+{
+    throw std::runtime_error("JSON parse error: " + message + " at offset " + std::to_string(pos - documentBegin));
+}
+
+static void appendUtf8(std::string& str, uint32_t codePoint)
+{
+    if (codePoint < 0x80)
+    {
+        str.push_back(static_cast<char>(codePoint));
+    }
+    else if (codePoint < 0x800)
+    {
+        str.push_back(static_cast<char>(0xc0 | (codePoint >> 6)));
+        str.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    }
+    else if (codePoint < 0x10000)
+    {
+        str.push_back(static_cast<char>(0xe0 | (codePoint >> 12)));
+        str.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+        str.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    }
+    else
+    {
+        str.push_back(static_cast<char>(0xf0 | (codePoint >> 18)));
+        str.push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3f)));
+        str.push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3f)));
+        str.push_back(static_cast<char>(0x80 | (codePoint & 0x3f)));
+    }
+}
+
+static uint32_t parseHex4(std::string_view raw, size_t pos)
+{
+    uint32_t value = 0;
+    if (pos + 4 > raw.size() || std::from_chars(raw.data() + pos, raw.data() + pos + 4, value, 16).ptr != raw.data() + pos + 4)
+        throw std::runtime_error("JSON parse error: invalid \\u escape in string " + std::string(raw));
+    return value;
+}
+
+/*static*/ std::string JsonScanner::unescape(std::string_view raw)
+{
+    std::string str;
+    str.reserve(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i)
+    {
+        if (raw[i] != '\\')
+        {
+            str.push_back(raw[i]);
+            continue;
+        }
+
+        if (++i == raw.size()) break;
+        switch (raw[i])
+        {
+            case 'b': str.push_back('\b'); break;
+            case 'f': str.push_back('\f'); break;
+            case 'n': str.push_back('\n'); break;
+            case 'r': str.push_back('\r'); break;
+            case 't': str.push_back('\t'); break;
+            case 'u':
+            {
+                uint32_t codePoint = parseHex4(raw, i + 1);
+                i += 4;
+                if (codePoint >= 0xd800 && codePoint < 0xdc00 && i + 2 < raw.size() && raw[i + 1] == '\\' && raw[i + 2] == 'u')
+                {
+                    uint32_t low = parseHex4(raw, i + 3);
+                    if (low >= 0xdc00 && low < 0xe000)
+                    {
+                        codePoint = 0x10000 + ((codePoint - 0xd800) << 10) + (low - 0xdc00);
+                        i += 6;
+                    }
+                }
+                appendUtf8(str, codePoint);
+                break;
+            }
+            default:
+                // \" \\ \/
+                str.push_back(raw[i]);
+                break;
+        }
+    }
+    return str;
+}
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
+
+#include "StringStore.h"
+
+// Tokenizes a JSON document in place, e.g. a MappedFile. Strings are returned as views into the document and
+// only strings with escape sequences are decoded into a StringStore. Values that are not needed are skipped by
+// their structure only. Throws std::runtime_error on malformed input.
+// The searches for quotes, brackets and the end of indentation look at 32 (AVX2) or 16 (SSE2) bytes at a time, other hosts get the
+// scalar loops. Integers of up to 8 digits are decoded as one 64 bit word.
+class JsonScanner
+{
+public:
+    JsonScanner(const char* begin, const char* end) : documentBegin(begin), pos(begin), end(end) {}
+
+    const char* position() const { return pos; }
+    // Continues at a position found by an earlier pass over the same document
+    void seek(const char* position) { pos = position; }
+
+    // First character of the next value, 0 at the end of the document
+    char peek()
+    {
+        skipWhitespace();
+        return pos == end ? 0 : *pos;
+    }
+
+    // Raw characters between the quotes, escape sequences are left as they are
+    std::string_view readRawString()
+    {
+        expect('"');
+        const char* begin = pos;
+        while (true)
+        {
+            pos = findQuoteOrBackslash(pos, end);
+            if (pos == end) fail("unterminated string");
+            if (*pos == '"') break;
+            pos += 2;
+            if (pos > end) fail("unterminated string");
+        }
+        return { begin, static_cast<size_t>(pos++ - begin) };
+    }
+
+    // The string's characters, decoded into the store if it contains escape sequences
+    std::string_view readString(StringStore& decoded)
+    {
+        std::string_view raw = readRawString();
+        if (raw.find('\\') == std::string_view::npos) return raw;
+        return decoded.store(unescape(raw));
+    }
+
+    template <typename Int>
+    Int readInteger()
+    {
+        skipWhitespace();
+        Int value;
+        if (readUnsigned(value)) return value;
+
+        auto result = std::from_chars(pos, end, value);
+        if (result.ec != std::errc()) fail("expected an integer");
+        pos = result.ptr;
+        return value;
+    }
+
+    // Appends the elements of an array of integers and strings, strings are stored as stringValue. Stops at
+    // the first other element and returns false, positioned at that element.
+    template <typename Int>
+    bool readIntegerArray(std::vector<Int>& values, Int stringValue)
+    {
+        expect('[');
+        if (peek() == ']')
+        {
+            ++pos;
+            return true;
+        }
+
+        do
+        {
+            char first = peek();
+            if (first == '"')
+            {
+                readRawString();
+                values.push_back(stringValue);
+            }
+            else if (first >= '0' && first <= '9')
+            {
+                values.push_back(readInteger<Int>());
+            }
+            else
+            {
+                return false;
+            }
+        } while (consume(','));
+        expect(']');
+        return true;
+    }
+
+    void skipValue()
+    {
+        skipWhitespace();
+        if (pos == end) fail("unexpected end of input");
+
+        if (*pos == '"')
+        {
+            readRawString();
+            return;
+        }
+
+        if (*pos != '{' && *pos != '[')
+        {
+            const char* begin = pos;
+            pos = std::find_if(pos, end, [](char c) { return c == ',' || c == '}' || c == ']' || isWhitespace(c); });
+            if (pos == begin) fail("expected a value");
+            return;
+        }
+
+        size_t depth = 0;
+        while (true)
+        {
+            pos = findStructural(pos, end);
+            if (pos == end) fail("unexpected end of input");
+
+            char c = *pos;
+            if (c == '"')
+            {
+                readRawString();
+                continue;
+            }
+            ++pos;
+            // '[' and '{' only differ in bit 5, so do ']' and '}'
+            if ((c | 0x20) == '{') ++depth;
+            else if (--depth == 0) return;
+        }
+    }
+
+    // Calls func(rawKey) positioned at the value of each member, func has to consume the value
+    template <typename Func>
+    void forEachMember(Func func)
+    {
+        expect('{');
+        if (peek() == '}')
+        {
+            ++pos;
+            return;
+        }
+
+        do
+        {
+            std::string_view key = readRawString();
+            expect(':');
+            func(key);
+        } while (consume(','));
+        expect('}');
+    }
+
+    [[noreturn]] void fail(const std::string& message) const;
+
+    // Decodes the escape sequences of a raw string, \u escapes become UTF-8
+    static std::string unescape(std::string_view raw);
+
+private:
+    static bool isWhitespace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+
+    void skipWhitespace()
+    {
+        // mostly a single space or none, indentation takes the vector path
+        if (pos == end || ! isWhitespace(*pos)) return;
+        if (++pos == end || ! isWhitespace(*pos)) return;
+        pos = findNonWhitespace(pos, end);
+    }
+
+    bool consume(char c)
+    {
+        if (peek() != c) return false;
+        ++pos;
+        return true;
+    }
+
+    void expect(char c)
+    {
+        if (! consume(c)) fail(std::string("expected '") + c + "'");
+    }
+
+    // Decodes a non-negative integer of 1 to 8 digits that is followed by a non-digit, otherwise leaves it to
+    // std::from_chars
+    template <typename Int>
+    bool readUnsigned(Int& value)
+    {
+        if constexpr (std::endian::native != std::endian::little)
+        {
+            return false;
+        }
+        else
+        {
+            if (end - pos < 9) return false;
+
+            uint64_t word;
+            std::memcpy(&word, pos, sizeof(word));
+            // a byte is a digit if its high nibble is 3 and adding 6 keeps it that way
+            uint64_t nonDigits = ((word & 0xf0f0f0f0f0f0f0f0) ^ 0x3030303030303030)
+                | (((word + 0x0606060606060606) & 0xf0f0f0f0f0f0f0f0) ^ 0x3030303030303030);
+            // high bit of every non-zero byte
+            uint64_t nonDigitBytes = (((nonDigits & 0x7f7f7f7f7f7f7f7f) + 0x7f7f7f7f7f7f7f7f) | nonDigits) & 0x8080808080808080;
+            if (nonDigitBytes == 0) return pos[8] < '0' || pos[8] > '9' ? decodeDigits(word, 8, value) : false;
+
+            size_t digitCnt = std::countr_zero(nonDigitBytes) / 8;
+            if (digitCnt == 0) return false;
+            return decodeDigits(word << (8 * (8 - digitCnt)), digitCnt, value);
+        }
+    }
+
+    // The digits are in the high digitCnt bytes of the word, the low bytes are zero
+    template <typename Int>
+    bool decodeDigits(uint64_t word, size_t digitCnt, Int& value)
+    {
+        word = ((word & 0x0f0f0f0f0f0f0f0f) * 2561) >> 8;
+        word = ((word & 0x00ff00ff00ff00ff) * 6553601) >> 16;
+        uint64_t decoded = ((word & 0x0000ffff0000ffff) * 42949672960001) >> 32;
+        if (decoded > static_cast<uint64_t>(std::numeric_limits<Int>::max())) return false;
+
+        value = static_cast<Int>(decoded);
+        pos += digitCnt;
+        return true;
+    }
+
+    static const char* findQuoteOrBackslash(const char* pos, const char* end)
+    {
+#if defined(__AVX2__)
+        const __m256i quotes = _mm256_set1_epi8('"');
+        const __m256i backslashes = _mm256_set1_epi8('\\');
+        for (; end - pos >= 32; pos += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+            uint32_t mask = _mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, quotes), _mm256_cmpeq_epi8(chunk, backslashes)));
+            if (mask != 0) return pos + std::countr_zero(mask);
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128i quotes = _mm_set1_epi8('"');
+        const __m128i backslashes = _mm_set1_epi8('\\');
+        for (; end - pos >= 16; pos += 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            uint32_t mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(chunk, quotes), _mm_cmpeq_epi8(chunk, backslashes)));
+            if (mask != 0) return pos + std::countr_zero(mask);
+        }
+#endif
+        return std::find_if(pos, end, [](char c) { return c == '"' || c == '\\'; });
+    }
+
+    static const char* findNonWhitespace(const char* pos, const char* end)
+    {
+#if defined(__AVX2__)
+        const __m256i spaces = _mm256_set1_epi8(' ');
+        const __m256i newlines = _mm256_set1_epi8('\n');
+        const __m256i returns = _mm256_set1_epi8('\r');
+        const __m256i tabs = _mm256_set1_epi8('\t');
+        for (; end - pos >= 32; pos += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+            __m256i matches = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, spaces), _mm256_cmpeq_epi8(chunk, newlines)),
+                _mm256_or_si256(_mm256_cmpeq_epi8(chunk, returns), _mm256_cmpeq_epi8(chunk, tabs)));
+            uint32_t mask = ~static_cast<uint32_t>(_mm256_movemask_epi8(matches));
+            if (mask != 0) return pos + std::countr_zero(mask);
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128i spaces = _mm_set1_epi8(' ');
+        const __m128i newlines = _mm_set1_epi8('\n');
+        const __m128i returns = _mm_set1_epi8('\r');
+        const __m128i tabs = _mm_set1_epi8('\t');
+        for (; end - pos >= 16; pos += 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            __m128i matches = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(chunk, spaces), _mm_cmpeq_epi8(chunk, newlines)),
+                _mm_or_si128(_mm_cmpeq_epi8(chunk, returns), _mm_cmpeq_epi8(chunk, tabs)));
+            uint32_t mask = ~static_cast<uint32_t>(_mm_movemask_epi8(matches)) & 0xffff;
+            if (mask != 0) return pos + std::countr_zero(mask);
+        }
+#endif
+        return std::find_if(pos, end, [](char c) { return ! isWhitespace(c); });
+    }
+
+    // Next quote or bracket
+    static const char* findStructural(const char* pos, const char* end)
+    {
+#if defined(__AVX2__)
+        const __m256i quotes = _mm256_set1_epi8('"');
+        const __m256i caseBit = _mm256_set1_epi8(0x20);
+        const __m256i opening = _mm256_set1_epi8('{');
+        const __m256i closing = _mm256_set1_epi8('}');
+        for (; end - pos >= 32; pos += 32)
+        {
+            __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pos));
+            __m256i folded = _mm256_or_si256(chunk, caseBit);
+            __m256i matches = _mm256_or_si256(_mm256_cmpeq_epi8(chunk, quotes), _mm256_or_si256(_mm256_cmpeq_epi8(folded, opening), _mm256_cmpeq_epi8(folded, closing)));
+            uint32_t mask = _mm256_movemask_epi8(matches);
+            if (mask != 0) return pos + std::countr_zero(mask);
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        const __m128i quotes = _mm_set1_epi8('"');
+        const __m128i caseBit = _mm_set1_epi8(0x20);
+        const __m128i opening = _mm_set1_epi8('{');
+        const __m128i closing = _mm_set1_epi8('}');
+        for (; end - pos >= 16; pos += 16)
+        {
+            __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(pos));
+            __m128i folded = _mm_or_si128(chunk, caseBit);
+            __m128i matches = _mm_or_si128(_mm_cmpeq_epi8(chunk, quotes), _mm_or_si128(_mm_cmpeq_epi8(folded, opening), _mm_cmpeq_epi8(folded, closing)));
+            uint32_t mask = _mm_movemask_epi8(matches);
+            if (mask != 0) return pos + std::countr_zero(mask);
+        }
+#endif
+        return std::find_if(pos, end, [](char c) { return c == '"' || (c | 0x20) == '{' || (c | 0x20) == '}'; });
+    }
+
+    const char* documentBegin;
+    const char* pos;
+    const char* end;
+};
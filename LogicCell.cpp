@@ -0,0 +1,82 @@
+#include "LogicCell.h"
+
+#include "Profiler.h"
+
+static std::string subcellIdToStr(cellId_t cellId)
+{
+    return cellId == Cell::INVALID_ID ? "X" : std::to_string(cellId);
+}
+
+static LogicCell& newLogicCell(LogicCellPacking& packing)
+{
+    LogicCell& lc = packing.logicCells.emplace_back();
+    lc.id = packing.logicCells.size() - 1;
+    return lc;
+}
+
+void parseLogicCellsFromLUTs(const NetlistGraph& graph, LogicCellPacking& packing)
+{
+    PROFILE_SCOPE("pack LUTs");
+    PROFILE_COUNT("cells visited", graph.cellCnt());
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(graph.cellCnt()); ++cellId)
+    {
+        if (graph.types[cellId] != Cell::Type::LUT) continue;
+        if (packing.parentLC[cellId] != LogicCell::INVALID_ID) continue;
+
+        LogicCell& lc = newLogicCell(packing);
+        lc.lut = cellId;
+        packing.parentLC[cellId] = lc.id;
+
+        graph.doForAllOutputCells(cellId, [&](cellId_t nextCell) {
+            if (graph.types[nextCell] != Cell::Type::DFF) return true;
+
+            lc.dff = nextCell;
+            packing.parentLC[nextCell] = lc.id;
+
+            graph.doForAllOutputCells(nextCell, [&](cellId_t nextNextCell) {
+                if (graph.types[nextNextCell] != Cell::Type::Carry) return true;
+
+                lc.carry = nextNextCell;
+                packing.parentLC[nextNextCell] = lc.id;
+                return false;
+            });
+            return false;
+        });
+    }
+}
+
+void parseLogicCellsFromDFFs(const NetlistGraph& graph, LogicCellPacking& packing)
+{
+    PROFILE_SCOPE("pack DFFs");
+    PROFILE_COUNT("cells visited", graph.cellCnt());
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(graph.cellCnt()); ++cellId)
+    {
+        if (graph.types[cellId] != Cell::Type::DFF) continue;
+        if (packing.parentLC[cellId] != LogicCell::INVALID_ID) continue;
+
+        LogicCell& lc = newLogicCell(packing);
+        lc.dff = cellId;
+        packing.parentLC[cellId] = lc.id;
+
+        graph.doForAllInputCells(cellId, [&](cellId_t prevCell) {
+            if (graph.types[prevCell] != Cell::Type::LUT) return true;
+
+            lc.lut = prevCell;
+            packing.parentLC[prevCell] = lc.id;
+            return false;
+        });
+        graph.doForAllOutputCells(cellId, [&](cellId_t nextCell) {
+            if (graph.types[nextCell] != Cell::Type::Carry) return true;
+
+            lc.carry = nextCell;
+            packing.parentLC[nextCell] = lc.id;
+            return false;
+        });
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const LogicCell& lc)
+{
+    os << "LC #" << lc.id << " [LUT: " << subcellIdToStr(lc.lut) << ", DFF: " << subcellIdToStr(lc.dff) << ", CARRY: " << subcellIdToStr(lc.carry) << "]";
+    return os;
+}
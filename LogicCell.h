@@ -1,29 +1,34 @@
 #pragma once
 
 #include "Cell.h"
+#include "NetlistGraph.h"
 
 #include <ostream>
 #include <string>
+#include <vector>
 
 typedef int lcId_t;
 
 struct LogicCell
 {
-    static constexpr cellId_t INVALID_ID = -1;
+    static constexpr lcId_t INVALID_ID = -1;
 
     lcId_t id = INVALID_ID;
-    Cell* lut = nullptr;
-    Cell* dff = nullptr;
-    Cell* carry = nullptr;
+    cellId_t lut = Cell::INVALID_ID;
+    cellId_t dff = Cell::INVALID_ID;
+    cellId_t carry = Cell::INVALID_ID;
 };
 
-std::string subcellIdToStr(Cell* cell)
+// LUT / DFF / Carry triplets packed together, indexed by the dense cell ids of the graph
+struct LogicCellPacking
 {
-    return cell == nullptr ? "X" : std::to_string(cell->id);
-}
+    std::vector<LogicCell> logicCells;
+    std::vector<lcId_t> parentLC;
 
-std::ostream& operator<<(std::ostream& os, const LogicCell& lc)
-{
-    os << "LC #" << lc.id << " [LUT: " << subcellIdToStr(lc.lut) << ", DFF: " << subcellIdToStr(lc.dff) << ", CARRY: " << subcellIdToStr(lc.carry) << "]";
-    return os;
-}
+    explicit LogicCellPacking(const NetlistGraph& graph) : parentLC(graph.cellCnt(), LogicCell::INVALID_ID) {}
+};
+
+void parseLogicCellsFromLUTs(const NetlistGraph& graph, LogicCellPacking& packing);
+void parseLogicCellsFromDFFs(const NetlistGraph& graph, LogicCellPacking& packing);
+
+std::ostream& operator<<(std::ostream& os, const LogicCell& lc);
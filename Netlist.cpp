@@ -0,0 +1,123 @@
+#include "Netlist.h"
+
+#include <stdexcept>
+
+// Rough per-allocation bookkeeping cost of the heap and of std::map nodes
+static constexpr size_t MALLOC_OVERHEAD = 16;
+static constexpr size_t MAP_NODE_OVERHEAD = 32 + MALLOC_OVERHEAD;
+
+static size_t stringBytes(const std::string& str)
+{
+    // short strings live inside the object
+    return str.capacity() > 15 ? str.capacity() + 1 + MALLOC_OVERHEAD : 0;
+}
+
+CellRecord::Connection& CellRecord::addConnection()
+{
+    if (spareConnections.empty()) return connections.emplace_back();
+
+    connections.push_back(std::move(spareConnections.back()));
+    spareConnections.pop_back();
+    return connections.back();
+}
+
+void CellRecord::clear()
+{
+    name.clear();
+    type.clear();
+    verilogSrc.clear();
+    for (auto& connection : connections)
+    {
+        connection.portName.clear();
+        connection.bits.clear();
+        spareConnections.push_back(std::move(connection));
+    }
+    connections.clear();
+}
+
+Cell& Netlist::addCell(const CellRecord& record)
+{
+    Cell& cell = addCell(strings.store(record.name), record.type, interned.intern(record.verilogSrc));
+
+    for (const auto& connection : record.connections)
+    {
+        for (portId_t bit : connection.bits)
+        {
+            connect(cell, connection.portName, connection.type, bit);
+        }
+    }
+
+    return cell;
+}
+
+Cell& Netlist::addCell(std::string_view name, std::string_view typeName, std::string_view verilogSrc)
+{
+    const cellId_t cellId = cells.size();
+    const auto& typePair = countCellType(typeName, 1);
+
+    Cell& cell = *cells.emplace_back(std::pmr::polymorphic_allocator<Cell>(arena.resource()).new_object<Cell>(cellId, name, typePair.second.type, arena.resource()));
+    cell.typeName = typePair.first;
+    cell.verilogSrc = verilogSrc;
+    return cell;
+}
+
+std::pair<const std::string, CellTypeCount>& Netlist::countCellType(std::string_view typeName, size_t cnt)
+{
+    auto typeIt = cellTypes.find(typeName);
+    if (typeIt == cellTypes.end())
+        typeIt = cellTypes.emplace(std::string(typeName), CellTypeCount { 0, resolveCellType(typeName, architecture) }).first;
+    typeIt->second.cnt += cnt;
+    return *typeIt;
+}
+
+Link& Netlist::linkOf(portId_t netId)
+{
+    if (netId < 0) throw std::out_of_range("Invalid net id " + std::to_string(netId));
+
+    while (links.size() <= static_cast<size_t>(netId))
+    {
+        links.emplace_back(static_cast<portId_t>(links.size()), arena.resource());
+    }
+    return links[netId];
+}
+
+void Netlist::connect(Cell& cell, std::string_view portName, Port::Type type, portId_t netId)
+{
+    std::string_view internedName = interned.intern(portName);
+
+    if (cell.type == Cell::Type::Unknown || cell.type == Cell::Type::Instance)
+    {
+        PortBits& portBits = unknownCellPorts[cell.id].try_emplace(internedName, PortBits { type, {} }).first->second;
+        portBits.bits.push_back(netId);
+    }
+
+    if (netId == Port::INVALID_ID) return;
+
+    cell.assignPort(internedName, linkOf(netId), type);
+}
+
+size_t Netlist::memoryBytes() const
+{
+    size_t bytes = sizeof(*this) + strings.memoryBytes() + interned.memoryBytes() + arena.reservedBytes() + cells.capacity() * sizeof(Cell*);
+
+    for (const auto& chunk : cellChunks)
+    {
+        bytes += sizeof(*chunk) + chunk->strings.memoryBytes() + chunk->interned.memoryBytes() + chunk->arena.reservedBytes();
+    }
+
+    for (const auto& typePair : cellTypes)
+    {
+        bytes += MAP_NODE_OVERHEAD + sizeof(typePair) + stringBytes(typePair.first);
+    }
+
+    for (const auto& unknownPair : unknownCellPorts)
+    {
+        bytes += MAP_NODE_OVERHEAD + sizeof(unknownPair);
+        for (const auto& portPair : unknownPair.second)
+        {
+            bytes += MAP_NODE_OVERHEAD + sizeof(portPair) + portPair.second.bits.capacity() * sizeof(portId_t) + MALLOC_OVERHEAD;
+        }
+    }
+
+    return bytes;
+}
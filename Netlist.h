@@ -0,0 +1,118 @@
+#pragma once
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Architecture.h"
+#include "Cell.h"
+#include "Port.h"
+#include "MappedFile.h"
+#include "StringStore.h"
+#include "Arena.h"
+
+// Loader-independent description of a single cell as read from the netlist
+struct CellRecord
+{
+    struct Connection
+    {
+        std::string portName;
+        Port::Type type;
+        // net ids of the port bits, Port::INVALID_ID for constant / unconnected bits
+        std::vector<portId_t> bits;
+    };
+
+    std::string name;
+    std::string type;
+    std::string verilogSrc;
+    std::vector<Connection> connections;
+
+    // Appends an empty connection, reusing the buffers of connections dropped by clear()
+    Connection& addConnection();
+    void clear();
+
+private:
+    std::vector<Connection> spareConnections;
+};
+
+struct ModulePort
+{
+    std::string name;
+    Port::Type direction;
+    // net ids of the port bits, Port::INVALID_ID for constant bits
+    std::vector<portId_t> bits;
+};
+
+// Bits of a cell port including the unconnected ones, which Port::links leaves out
+struct PortBits
+{
+    Port::Type type;
+    std::vector<portId_t> bits;
+};
+
+// Number of cells of a type name and the type they were given
+struct CellTypeCount
+{
+    size_t cnt = 0;
+    Cell::Type type = Cell::Type::Unknown;
+};
+
+// Cells and nets of a single module
+struct Netlist
+{
+    std::string moduleName;
+    // Set by the "top" attribute of the module
+    bool isTop = false;
+    // Set by the "blackbox" attribute, such modules only describe the interface of a primitive
+    bool isBlackbox = false;
+    std::vector<ModulePort> ports;
+    // Decides the cell types, Auto until the first cell of a known family was added
+    Architecture architecture = Architecture::Auto;
+
+    // Backing storage of the cells' names and sources
+    StringStore strings;
+    // Port names and sources repeat a lot, these are stored once
+    StringInterner interned { strings };
+    std::vector<std::shared_ptr<const MappedFile>> mappings;
+    // Cells, ports and links, released together with the netlist
+    Arena arena;
+
+    // Cells built by the workers of a parallel loader, with their ports and the strings that are not in a mapping
+    struct CellChunk
+    {
+        Arena arena;
+        StringStore strings;
+        StringInterner interned { strings };
+    };
+    std::vector<std::unique_ptr<CellChunk>> cellChunks;
+
+    // By id. The arenas release the cells without running their destructors.
+    std::vector<Cell*> cells;
+    // By net id, up to the largest connected one. Nets no port is connected to have an empty link.
+    std::pmr::deque<Link> links { arena.resource() };
+    // Cell::typeName points into the keys. Every type name is resolved once, when its first cell is added.
+    std::map<std::string, CellTypeCount, std::less<>> cellTypes;
+    // Full bit lists of the ports of cells with unknown type, these may be instances of other modules
+    std::map<cellId_t, std::map<std::string_view, PortBits>> unknownCellPorts;
+
+    // Copies the strings of the record into the string store
+    Cell& addCell(const CellRecord& record);
+    // Does not copy, name and verilogSrc must live as long as the netlist (see mappings)
+    Cell& addCell(std::string_view name, std::string_view typeName, std::string_view verilogSrc);
+    // Constant bits (Port::INVALID_ID) are only recorded for cells of unknown type
+    void connect(Cell& cell, std::string_view portName, Port::Type type, portId_t netId);
+    // Resolves the type name when it is new, in the order the cells are added, and counts cnt more cells of it
+    std::pair<const std::string, CellTypeCount>& countCellType(std::string_view typeName, size_t cnt);
+    // Extends the link table up to the net
+    Link& linkOf(portId_t netId);
+
+    // Estimated heap footprint of the cell / port / link structures
+    size_t memoryBytes() const;
+
+    Netlist() = default;
+    Netlist(const Netlist&) = delete;
+    Netlist& operator=(const Netlist&) = delete;
+};
@@ -0,0 +1,370 @@
+#include "NetlistCache.h"
+
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "Profiler.h"
+
+namespace
+{
+    constexpr uint32_t MAGIC = 0x434e4a46; // "FJNC"
+    constexpr uint32_t VERSION = 2;
+
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t jsonSize;
+        int64_t jsonMtime;
+        uint64_t jsonHash;
+        uint64_t moduleCnt;
+        uint64_t cellCnt;
+        uint64_t connectionCnt;
+        uint64_t modulePortCnt;
+        uint64_t portNameCnt;
+        uint64_t portBitCnt;
+        uint64_t stringBytes;
+    };
+
+    struct StringRef
+    {
+        uint32_t offset;
+        uint32_t length;
+    };
+
+    struct ModuleEntry
+    {
+        static constexpr uint32_t FLAG_TOP = 1;
+        static constexpr uint32_t FLAG_BLACKBOX = 2;
+
+        StringRef name;
+        uint32_t firstCell;
+        uint32_t cellCnt;
+        uint32_t firstPort;
+        uint32_t portCnt;
+        uint32_t flags;
+        uint32_t reserved;
+    };
+
+    struct ModulePortEntry
+    {
+        StringRef name;
+        uint32_t firstBit;
+        uint32_t bitCnt;
+        uint32_t direction;
+        uint32_t reserved;
+    };
+
+    struct CellEntry
+    {
+        StringRef name;
+        StringRef type;
+        StringRef src;
+        uint32_t firstConnection;
+        uint32_t connectionCnt;
+    };
+
+    struct ConnectionEntry
+    {
+        portId_t net;
+        uint16_t portName;
+        uint8_t direction;
+        uint8_t reserved;
+    };
+
+    static_assert(sizeof(Header) % 8 == 0 && sizeof(ModuleEntry) % 8 == 0 && sizeof(CellEntry) % 8 == 0 && sizeof(ModulePortEntry) % 8 == 0);
+    static_assert(sizeof(ConnectionEntry) == 8 && sizeof(StringRef) == 8);
+
+    struct SourceKey
+    {
+        uint64_t size;
+        int64_t mtime;
+    };
+
+    SourceKey sourceKeyOf(const std::string& jsonFileName)
+    {
+        std::filesystem::path path(jsonFileName);
+        return { std::filesystem::file_size(path), static_cast<int64_t>(std::filesystem::last_write_time(path).time_since_epoch().count()) };
+    }
+
+    // FNV-1a
+    uint64_t contentHashOf(const std::string& jsonFileName)
+    {
+        MappedFile file(jsonFileName);
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (size_t i = 0; i < file.size(); ++i)
+        {
+            hash = (hash ^ static_cast<unsigned char>(file.data()[i])) * 0x100000001b3ull;
+        }
+        return hash;
+    }
+}
+
+std::string NetlistCache::cacheFileFor(const std::string& jsonFileName)
+{
+    return jsonFileName + ".fjcache";
+}
+
+bool NetlistCache::load(const std::string& jsonFileName, Design& design)
+{
+    PROFILE_SCOPE("cache load");
+    const std::string cacheFileName = cacheFileFor(jsonFileName);
+
+    std::error_code ec;
+    if (! std::filesystem::exists(cacheFileName, ec)) return false;
+
+    std::shared_ptr<MappedFile> mapping;
+    SourceKey sourceKey;
+    try
+    {
+        sourceKey = sourceKeyOf(jsonFileName);
+        mapping = std::make_shared<MappedFile>(cacheFileName);
+    }
+    catch (std::exception&)
+    {
+        return false;
+    }
+
+    if (mapping->size() < sizeof(Header)) return false;
+    const Header& header = *reinterpret_cast<const Header*>(mapping->data());
+    if (header.magic != MAGIC || header.version != VERSION || header.jsonSize != sourceKey.size) return false;
+    // a touched but unchanged file keeps its cache
+    if (header.jsonMtime != sourceKey.mtime && header.jsonHash != contentHashOf(jsonFileName)) return false;
+
+    const uint64_t expectedSize = sizeof(Header) + header.moduleCnt * sizeof(ModuleEntry) + header.cellCnt * sizeof(CellEntry)
+        + header.connectionCnt * sizeof(ConnectionEntry) + header.modulePortCnt * sizeof(ModulePortEntry)
+        + header.portNameCnt * sizeof(StringRef) + header.portBitCnt * sizeof(portId_t) + header.stringBytes;
+    if (mapping->size() != expectedSize) return false;
+    PROFILE_COUNT("bytes read", mapping->size());
+
+    const ModuleEntry* moduleEntries = reinterpret_cast<const ModuleEntry*>(mapping->data() + sizeof(Header));
+    const CellEntry* cellEntries = reinterpret_cast<const CellEntry*>(moduleEntries + header.moduleCnt);
+    const ConnectionEntry* connectionEntries = reinterpret_cast<const ConnectionEntry*>(cellEntries + header.cellCnt);
+    const ModulePortEntry* modulePortEntries = reinterpret_cast<const ModulePortEntry*>(connectionEntries + header.connectionCnt);
+    const StringRef* portNameRefs = reinterpret_cast<const StringRef*>(modulePortEntries + header.modulePortCnt);
+    const portId_t* portBits = reinterpret_cast<const portId_t*>(portNameRefs + header.portNameCnt);
+    const char* stringData = reinterpret_cast<const char*>(portBits + header.portBitCnt);
+
+    auto isValid = [&](const StringRef& ref) { return uint64_t(ref.offset) + ref.length <= header.stringBytes; };
+    auto view = [&](const StringRef& ref) { return std::string_view(stringData + ref.offset, ref.length); };
+
+    // validate everything first, so a corrupt file never leaves a half built design behind
+    for (uint64_t i = 0; i < header.moduleCnt; ++i)
+    {
+        const ModuleEntry& entry = moduleEntries[i];
+        if (! isValid(entry.name)) return false;
+        if (uint64_t(entry.firstCell) + entry.cellCnt > header.cellCnt) return false;
+        if (uint64_t(entry.firstPort) + entry.portCnt > header.modulePortCnt) return false;
+    }
+    for (uint64_t i = 0; i < header.modulePortCnt; ++i)
+    {
+        const ModulePortEntry& entry = modulePortEntries[i];
+        if (! isValid(entry.name) || entry.direction > 1 || uint64_t(entry.firstBit) + entry.bitCnt > header.portBitCnt) return false;
+    }
+    for (uint64_t i = 0; i < header.portNameCnt; ++i)
+    {
+        if (! isValid(portNameRefs[i])) return false;
+    }
+    for (uint64_t i = 0; i < header.cellCnt; ++i)
+    {
+        const CellEntry& entry = cellEntries[i];
+        if (! isValid(entry.name) || ! isValid(entry.type) || ! isValid(entry.src)) return false;
+        if (uint64_t(entry.firstConnection) + entry.connectionCnt > header.connectionCnt) return false;
+    }
+    for (uint64_t i = 0; i < header.connectionCnt; ++i)
+    {
+        if (connectionEntries[i].portName >= header.portNameCnt || connectionEntries[i].direction > 1) return false;
+    }
+
+    std::vector<std::string> portNames;
+    portNames.reserve(header.portNameCnt);
+    for (uint64_t i = 0; i < header.portNameCnt; ++i)
+    {
+        portNames.emplace_back(view(portNameRefs[i]));
+    }
+
+    for (uint64_t m = 0; m < header.moduleCnt; ++m)
+    {
+        const ModuleEntry& moduleEntry = moduleEntries[m];
+        Netlist& netlist = design.addModule(std::string(view(moduleEntry.name)));
+        netlist.isTop = moduleEntry.flags & ModuleEntry::FLAG_TOP;
+        netlist.isBlackbox = moduleEntry.flags & ModuleEntry::FLAG_BLACKBOX;
+
+        for (uint32_t p = moduleEntry.firstPort; p < moduleEntry.firstPort + moduleEntry.portCnt; ++p)
+        {
+            const ModulePortEntry& portEntry = modulePortEntries[p];
+            ModulePort& port = netlist.ports.emplace_back();
+            port.name = view(portEntry.name);
+            port.direction = portEntry.direction == 0 ? Port::Type::INPUT : Port::Type::OUTPUT;
+            port.bits.assign(portBits + portEntry.firstBit, portBits + portEntry.firstBit + portEntry.bitCnt);
+        }
+
+        for (uint32_t i = moduleEntry.firstCell; i < moduleEntry.firstCell + moduleEntry.cellCnt; ++i)
+        {
+            const CellEntry& entry = cellEntries[i];
+            Cell& cell = netlist.addCell(view(entry.name), view(entry.type), view(entry.src));
+
+            for (uint32_t c = entry.firstConnection; c < entry.firstConnection + entry.connectionCnt; ++c)
+            {
+                const ConnectionEntry& connection = connectionEntries[c];
+                netlist.connect(cell, portNames[connection.portName], connection.direction == 0 ? Port::Type::INPUT : Port::Type::OUTPUT, connection.net);
+            }
+        }
+
+        netlist.mappings.push_back(mapping);
+    }
+
+    design.resolveHierarchy();
+    return true;
+}
+
+void NetlistCache::save(const std::string& jsonFileName, const Design& design)
+{
+    PROFILE_SCOPE("cache save");
+    const SourceKey sourceKey = sourceKeyOf(jsonFileName);
+
+    std::string stringData;
+    auto addString = [&](std::string_view str) {
+        if (stringData.size() + str.size() > std::numeric_limits<uint32_t>::max())
+            throw std::runtime_error("Design too large for the cache format");
+        StringRef ref { static_cast<uint32_t>(stringData.size()), static_cast<uint32_t>(str.size()) };
+        stringData.append(str);
+        return ref;
+    };
+
+    std::vector<ModuleEntry> moduleEntries;
+    std::vector<CellEntry> cellEntries;
+    std::vector<ConnectionEntry> connectionEntries;
+    std::vector<ModulePortEntry> modulePortEntries;
+    std::vector<StringRef> portNameRefs;
+    std::vector<portId_t> portBits;
+    std::unordered_map<std::string_view, uint16_t> portNameIds;
+
+    auto portNameId = [&](std::string_view name) {
+        auto it = portNameIds.find(name);
+        if (it == portNameIds.end())
+        {
+            if (portNameRefs.size() > std::numeric_limits<uint16_t>::max())
+                throw std::runtime_error("Too many distinct port names for the cache format");
+            it = portNameIds.emplace(name, portNameRefs.size()).first;
+            portNameRefs.push_back(addString(name));
+        }
+        return it->second;
+    };
+
+    auto addPorts = [&](const std::pmr::map<std::string_view, Port>& ports, uint8_t direction) {
+        for (const auto& portPair : ports)
+        {
+            uint16_t nameId = portNameId(portPair.first);
+            for (const Link& link : portPair.second.links)
+            {
+                connectionEntries.push_back({ link.id, nameId, direction, 0 });
+            }
+        }
+    };
+
+    for (const auto& modulePair : design.modules)
+    {
+        const Netlist& netlist = *modulePair.second;
+        ModuleEntry& moduleEntry = moduleEntries.emplace_back();
+        moduleEntry.name = addString(modulePair.first);
+        moduleEntry.flags = (netlist.isTop ? ModuleEntry::FLAG_TOP : 0) | (netlist.isBlackbox ? ModuleEntry::FLAG_BLACKBOX : 0);
+        moduleEntry.reserved = 0;
+
+        moduleEntry.firstPort = modulePortEntries.size();
+        for (const ModulePort& port : netlist.ports)
+        {
+            ModulePortEntry& portEntry = modulePortEntries.emplace_back();
+            portEntry.name = addString(port.name);
+            portEntry.firstBit = portBits.size();
+            portEntry.bitCnt = port.bits.size();
+            portEntry.direction = port.direction == Port::Type::INPUT ? 0 : 1;
+            portEntry.reserved = 0;
+            portBits.insert(portBits.end(), port.bits.begin(), port.bits.end());
+        }
+        moduleEntry.portCnt = modulePortEntries.size() - moduleEntry.firstPort;
+
+        moduleEntry.firstCell = cellEntries.size();
+        for (const Cell* cellPtr : netlist.cells)
+        {
+            const Cell& cell = *cellPtr;
+            CellEntry& entry = cellEntries.emplace_back();
+            entry.name = addString(cell.name);
+            entry.type = addString(cell.typeName);
+            entry.src = addString(cell.verilogSrc);
+            entry.firstConnection = connectionEntries.size();
+
+            auto unknownPortsIt = netlist.unknownCellPorts.find(cell.id);
+            if (unknownPortsIt != netlist.unknownCellPorts.end())
+            {
+                // keeps the unconnected bits, instances map their ports bit by bit
+                for (const auto& portPair : unknownPortsIt->second)
+                {
+                    uint16_t nameId = portNameId(portPair.first);
+                    uint8_t direction = portPair.second.type == Port::Type::INPUT ? 0 : 1;
+                    for (portId_t bit : portPair.second.bits)
+                    {
+                        connectionEntries.push_back({ bit, nameId, direction, 0 });
+                    }
+                }
+            }
+            else
+            {
+                addPorts(cell.inputs, 0);
+                addPorts(cell.outputs, 1);
+            }
+            entry.connectionCnt = connectionEntries.size() - entry.firstConnection;
+        }
+        moduleEntry.cellCnt = cellEntries.size() - moduleEntry.firstCell;
+    }
+
+    Header header {};
+    header.magic = MAGIC;
+    header.version = VERSION;
+    header.jsonSize = sourceKey.size;
+    header.jsonMtime = sourceKey.mtime;
+    header.jsonHash = contentHashOf(jsonFileName);
+    header.moduleCnt = moduleEntries.size();
+    header.cellCnt = cellEntries.size();
+    header.connectionCnt = connectionEntries.size();
+    header.modulePortCnt = modulePortEntries.size();
+    header.portNameCnt = portNameRefs.size();
+    header.portBitCnt = portBits.size();
+    header.stringBytes = stringData.size();
+
+    // write next to the final file and rename, so readers never see a partial cache
+    const std::string cacheFileName = cacheFileFor(jsonFileName);
+    const std::string tempFileName = cacheFileName + ".tmp";
+    {
+        std::ofstream file(tempFileName, std::ios::binary | std::ios::trunc);
+        if (! file)
+            throw std::runtime_error("Could not create cache file: " + tempFileName);
+
+        auto writeVector = [&](const auto& vec) {
+            file.write(reinterpret_cast<const char*>(vec.data()), vec.size() * sizeof(vec[0]));
+        };
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        writeVector(moduleEntries);
+        writeVector(cellEntries);
+        writeVector(connectionEntries);
+        writeVector(modulePortEntries);
+        writeVector(portNameRefs);
+        writeVector(portBits);
+        file.write(stringData.data(), stringData.size());
+        if (! file)
+            throw std::runtime_error("Could not write cache file: " + tempFileName);
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempFileName, cacheFileName, ec);
+    if (ec)
+    {
+        std::filesystem::remove(tempFileName, ec);
+        throw std::runtime_error("Could not replace cache file: " + cacheFileName);
+    }
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include <string>
+
+#include "Design.h"
+
+// Binary snapshot of a parsed design, stored next to the JSON file. It is keyed by the size, modification time
+// and content hash of the JSON file. Loading maps the cache file, cell names and sources point right into the
+// mapping.
+namespace NetlistCache
+{
+    std::string cacheFileFor(const std::string& jsonFileName);
+
+    // Returns false if there is no cache file or it does not belong to the current JSON file
+    bool load(const std::string& jsonFileName, Design& design);
+
+    // Throws std::runtime_error if the cache file cannot be written
+    void save(const std::string& jsonFileName, const Design& design);
+}
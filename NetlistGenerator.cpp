@@ -0,0 +1,208 @@
+#include "NetlistGenerator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "Port.h"
+
+namespace
+{
+    // Yosys numbers the nets from 2, 0 and 1 are the constants
+    constexpr portId_t CLOCK_NET = 2;
+    constexpr portId_t FIRST_NET = 3;
+    constexpr size_t RAM_DATA_BITS = 16;
+    constexpr size_t RAM_ADDR_BITS = 8;
+
+    class JsonWriter
+    {
+    public:
+        JsonWriter(std::ostream& os, std::mt19937_64& rng) : os(os), rng(rng) {}
+
+        struct PortSpec
+        {
+            const char* name;
+            bool isOutput;
+            std::vector<portId_t> bits;
+        };
+
+        void cell(const std::string& name, const char* type, const char* srcFile, const std::vector<PortSpec>& ports)
+        {
+            os << (firstCell ? "\n" : ",\n");
+            firstCell = false;
+
+            std::uniform_int_distribution<int> line(1, 400);
+            std::uniform_int_distribution<int> column(1, 60);
+            os << "        \"" << name << "\": {\n"
+                << "          \"hide_name\": 0,\n"
+                << "          \"type\": \"" << type << "\",\n"
+                << "          \"parameters\": {\n          },\n"
+                << "          \"attributes\": {\n"
+                << "            \"src\": \"" << srcFile << ':' << line(rng) << '.' << column(rng) << '-' << line(rng) << '.' << column(rng) << "\"\n"
+                << "          },\n"
+                << "          \"port_directions\": {\n";
+            for (size_t p = 0; p < ports.size(); ++p)
+            {
+                os << "            \"" << ports[p].name << "\": \"" << (ports[p].isOutput ? "output" : "input") << '"' << (p + 1 < ports.size() ? ",\n" : "\n");
+            }
+            os << "          },\n"
+                << "          \"connections\": {\n";
+            for (size_t p = 0; p < ports.size(); ++p)
+            {
+                os << "            \"" << ports[p].name << "\": [ ";
+                for (size_t b = 0; b < ports[p].bits.size(); ++b)
+                {
+                    if (b > 0) os << ", ";
+                    if (ports[p].bits[b] == Port::INVALID_ID) os << "\"0\"";
+                    else os << ports[p].bits[b];
+                }
+                os << " ]" << (p + 1 < ports.size() ? ",\n" : "\n");
+            }
+            os << "          }\n"
+                << "        }";
+        }
+
+    private:
+        std::ostream& os;
+        std::mt19937_64& rng;
+        bool firstCell = true;
+    };
+}
+
+NetlistGenerator::NetlistGenerator(const GeneratorParams& params)
+    : params(params)
+{
+    dffs = std::max<size_t>(1, static_cast<size_t>(params.cellCnt * params.dffRatio));
+    size_t fixedCells = dffs + params.carryChainCnt * params.carryChainLength + params.ramCnt;
+    if (params.depth == 0 || params.cellCnt < fixedCells + params.depth)
+        throw std::invalid_argument("Cell count " + std::to_string(params.cellCnt) + " is too small for the requested depth, registers, carries and RAMs");
+    luts = params.cellCnt - fixedCells;
+}
+
+void NetlistGenerator::write(std::ostream& os)
+{
+    std::mt19937_64 rng(params.seed);
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    portId_t nextNet = FIRST_NET;
+
+    // nets by logic level, level 0 are the outputs of the boundary cells
+    std::vector<std::vector<portId_t>> levelNets(params.depth + 1);
+    auto pick = [&](const std::vector<portId_t>& nets) {
+        size_t idx = static_cast<size_t>(nets.size() * std::pow(unit(rng), params.fanoutSkew));
+        return nets[std::min(idx, nets.size() - 1)];
+    };
+    auto pickLutOutput = [&]() {
+        std::uniform_int_distribution<size_t> level(1, params.depth);
+        return pick(levelNets[level(rng)]);
+    };
+
+    std::vector<portId_t> dffOutputs(dffs);
+    for (portId_t& net : dffOutputs) net = nextNet++;
+    levelNets[0] = dffOutputs;
+
+    std::vector<std::vector<portId_t>> ramOutputs(params.ramCnt);
+    for (auto& outputs : ramOutputs)
+    {
+        for (size_t b = 0; b < RAM_DATA_BITS; ++b)
+        {
+            outputs.push_back(nextNet++);
+            levelNets[0].push_back(outputs.back());
+        }
+    }
+
+    std::vector<std::vector<portId_t>> carryOutputs(params.carryChainCnt);
+    for (auto& outputs : carryOutputs)
+    {
+        for (size_t c = 0; c < params.carryChainLength; ++c)
+        {
+            outputs.push_back(nextNet++);
+            levelNets[0].push_back(outputs.back());
+        }
+    }
+
+    os << "{\n"
+        << "  \"creator\": \"fpga-json-bench netlist generator\",\n"
+        << "  \"modules\": {\n"
+        << "    \"top\": {\n"
+        << "      \"attributes\": {\n"
+        << "        \"top\": \"00000000000000000000000000000001\"\n"
+        << "      },\n"
+        << "      \"ports\": {\n"
+        << "        \"clk\": {\n"
+        << "          \"direction\": \"input\",\n"
+        << "          \"bits\": [ " << CLOCK_NET << " ]\n"
+        << "        }\n"
+        << "      },\n"
+        << "      \"cells\": {";
+
+    JsonWriter writer(os, rng);
+
+    // every level gets at least one LUT, so the full depth is reached
+    for (size_t i = 0; i < luts; ++i)
+    {
+        size_t level = i < params.depth ? i + 1 : 1 + (i * params.depth) / luts;
+        std::vector<portId_t> inputs { pick(levelNets[level - 1]) };
+        for (size_t k = 1; k < 4; ++k)
+        {
+            if (unit(rng) < 0.75)
+            {
+                std::uniform_int_distribution<size_t> lowerLevel(0, level - 1);
+                inputs.push_back(pick(levelNets[lowerLevel(rng)]));
+            }
+            else
+            {
+                inputs.push_back(Port::INVALID_ID);
+            }
+        }
+        portId_t output = nextNet++;
+        writer.cell("lut_" + std::to_string(i), "SB_LUT4", "logic.v", {
+            { "I0", false, { inputs[0] } }, { "I1", false, { inputs[1] } }, { "I2", false, { inputs[2] } }, { "I3", false, { inputs[3] } },
+            { "O", true, { output } } });
+        levelNets[level].push_back(output);
+    }
+
+    for (size_t i = 0; i < dffs; ++i)
+    {
+        if (i % 2 == 0)
+        {
+            writer.cell("dff_" + std::to_string(i), "SB_DFF", "regs.v", {
+                { "C", false, { CLOCK_NET } }, { "D", false, { pickLutOutput() } }, { "Q", true, { dffOutputs[i] } } });
+        }
+        else
+        {
+            writer.cell("dff_" + std::to_string(i), "SB_DFFE", "regs.v", {
+                { "C", false, { CLOCK_NET } }, { "D", false, { pickLutOutput() } }, { "E", false, { pickLutOutput() } }, { "Q", true, { dffOutputs[i] } } });
+        }
+    }
+
+    for (size_t chain = 0; chain < carryOutputs.size(); ++chain)
+    {
+        for (size_t c = 0; c < carryOutputs[chain].size(); ++c)
+        {
+            portId_t carryIn = c == 0 ? Port::INVALID_ID : carryOutputs[chain][c - 1];
+            writer.cell("carry_" + std::to_string(chain) + "_" + std::to_string(c), "SB_CARRY", "alu.v", {
+                { "CI", false, { carryIn } }, { "CO", true, { carryOutputs[chain][c] } },
+                { "I0", false, { pickLutOutput() } }, { "I1", false, { pickLutOutput() } } });
+        }
+    }
+
+    for (size_t r = 0; r < ramOutputs.size(); ++r)
+    {
+        std::vector<portId_t> readAddr, writeAddr, writeData;
+        for (size_t b = 0; b < RAM_ADDR_BITS; ++b) readAddr.push_back(pickLutOutput());
+        for (size_t b = 0; b < RAM_ADDR_BITS; ++b) writeAddr.push_back(pickLutOutput());
+        for (size_t b = 0; b < RAM_DATA_BITS; ++b) writeData.push_back(pickLutOutput());
+        writer.cell("ram_" + std::to_string(r), "SB_RAM40_4K", "mem.v", {
+            { "RADDR", false, readAddr }, { "RCLK", false, { CLOCK_NET } }, { "RDATA", true, ramOutputs[r] },
+            { "WADDR", false, writeAddr }, { "WCLK", false, { CLOCK_NET } }, { "WDATA", false, writeData }, { "WE", false, { pickLutOutput() } } });
+    }
+
+    os << "\n      },\n"
+        << "      \"netnames\": {\n      }\n"
+        << "    }\n"
+        << "  }\n"
+        << "}\n";
+}
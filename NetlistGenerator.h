@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Synthetic Yosys style iCE40 netlists for benchmarking. The LUTs are arranged in logic levels, so the longest
+// combinational path has exactly `depth` cells.
+struct GeneratorParams
+{
+    // Total number of cells, LUTs make up what is left after the registers, carries and RAMs
+    size_t cellCnt = 10000;
+    size_t depth = 20;
+    // 1 picks the drivers of LUT inputs uniformly, higher values concentrate the fanout on fewer nets
+    double fanoutSkew = 2.0;
+    size_t carryChainCnt = 4;
+    size_t carryChainLength = 16;
+    size_t ramCnt = 2;
+    // DFFs per cell
+    double dffRatio = 0.15;
+    uint64_t seed = 1;
+};
+
+class NetlistGenerator
+{
+public:
+    explicit NetlistGenerator(const GeneratorParams& params);
+
+    // Throws std::invalid_argument if the cell count can not hold the requested structure
+    void write(std::ostream& os);
+
+    size_t lutCnt() const { return luts; }
+    size_t dffCnt() const { return dffs; }
+
+private:
+    const GeneratorParams params;
+    size_t luts;
+    size_t dffs;
+};
@@ -0,0 +1,193 @@
+#include "NetlistGraph.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <numeric>
+#include <stdexcept>
+#include <unordered_map>
+
+#include "Profiler.h"
+
+template <typename T>
+static size_t vectorBytes(const std::vector<T>& vec)
+{
+    return vec.capacity() * sizeof(T);
+}
+
+/*static*/ NetlistGraph NetlistGraph::build(const Netlist& netlist)
+{
+    PROFILE_SCOPE("graph build");
+    NetlistGraph graph;
+    const size_t cellCnt = netlist.cells.size();
+
+    graph.types.resize(cellCnt);
+    graph.cells.assign(netlist.cells.begin(), netlist.cells.end());
+    for (size_t cellIdx = 0; cellIdx < cellCnt; ++cellIdx)
+    {
+        graph.types[cellIdx] = netlist.cells[cellIdx]->type;
+    }
+
+    std::unordered_map<std::string_view, portNameId_t> portNameIds;
+    // the port names are interned by the netlist (once per loader chunk), so most lookups only need the address
+    std::unordered_map<const char*, portNameId_t> portNameIdsByAddress;
+    auto internPortName = [&](std::string_view name) {
+        auto addressIt = portNameIdsByAddress.find(name.data());
+        if (addressIt != portNameIdsByAddress.end() && graph.portNames[addressIt->second].size() == name.size()) return addressIt->second;
+
+        auto it = portNameIds.find(name);
+        if (it == portNameIds.end())
+        {
+            if (graph.portNames.size() > std::numeric_limits<portNameId_t>::max())
+                throw std::runtime_error("Too many distinct port names");
+            it = portNameIds.emplace(name, graph.portNames.size()).first;
+            graph.portNames.emplace_back(name);
+        }
+        portNameIdsByAddress[name.data()] = it->second;
+        return it->second;
+    };
+
+    graph.faninOffsets.reserve(cellCnt + 1);
+    graph.fanoutOffsets.reserve(cellCnt + 1);
+    // permutation of a cell's fanout range and the space to apply it, reused for all cells
+    std::vector<uint32_t> order;
+    std::vector<cellId_t> sortedCells;
+    std::vector<portNameId_t> sortedPorts;
+    std::vector<portId_t> sortedNets;
+
+    for (const Cell* cell : graph.cells)
+    {
+        graph.faninOffsets.push_back(graph.fanin.size());
+        for (const auto& input : cell->inputs)
+        {
+            portNameId_t portId = internPortName(input.first);
+            for (const Link& link : input.second.links)
+            {
+                if (link.input == nullptr) continue;
+                graph.fanin.push_back(link.input->cell.id);
+                graph.faninPort.push_back(portId);
+            }
+        }
+
+        const uint32_t fanoutBegin = graph.fanout.size();
+        graph.fanoutOffsets.push_back(fanoutBegin);
+        for (const auto& output : cell->outputs)
+        {
+            portNameId_t srcPortId = internPortName(output.first);
+            for (const Link& link : output.second.links)
+            {
+                for (const Port& port : link.outputs)
+                {
+                    graph.fanout.push_back(port.cell.id);
+                    graph.fanoutSrcPort.push_back(srcPortId);
+                    graph.fanoutDstPort.push_back(internPortName(port.name));
+                    graph.fanoutNet.push_back(link.id);
+                }
+            }
+        }
+
+        // sort this cell's fanout range by destination to allow binary search in hasLinkTo
+        const uint32_t fanoutCnt = graph.fanout.size() - fanoutBegin;
+        if (fanoutCnt > 1)
+        {
+            order.resize(fanoutCnt);
+            std::iota(order.begin(), order.end(), fanoutBegin);
+            // ties keep the port order, like a stable sort without its temporary buffer
+            std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+                return graph.fanout[a] != graph.fanout[b] ? graph.fanout[a] < graph.fanout[b] : a < b;
+            });
+
+            auto permute = [&](auto& vec, auto& sorted) {
+                sorted.clear();
+                for (uint32_t idx : order) sorted.push_back(vec[idx]);
+                std::copy(sorted.begin(), sorted.end(), vec.begin() + fanoutBegin);
+            };
+            permute(graph.fanout, sortedCells);
+            permute(graph.fanoutSrcPort, sortedPorts);
+            permute(graph.fanoutDstPort, sortedPorts);
+            permute(graph.fanoutNet, sortedNets);
+        }
+    }
+    graph.faninOffsets.push_back(graph.fanin.size());
+    graph.fanoutOffsets.push_back(graph.fanout.size());
+
+    graph.fanin.shrink_to_fit();
+    graph.faninPort.shrink_to_fit();
+    graph.fanout.shrink_to_fit();
+    graph.fanoutSrcPort.shrink_to_fit();
+    graph.fanoutDstPort.shrink_to_fit();
+    graph.fanoutNet.shrink_to_fit();
+
+    return graph;
+}
+
+bool NetlistGraph::hasLinkTo(cellId_t from, cellId_t to) const
+{
+    std::span<const cellId_t> nextCells = fanoutOf(from);
+    return std::binary_search(nextCells.begin(), nextCells.end(), to);
+}
+
+void NetlistGraph::crawlForward(cellId_t from, const bool stopOnCircular /* = true */, const size_t maxCellCnt /* = 0 */) const
+{
+    // A cell and the fanout entry of prevCell it was reached through, UINT32_MAX for the start cell
+    struct CrawlStep
+    {
+        cellId_t cellId;
+        cellId_t prevCell;
+        uint32_t fanoutIdx;
+    };
+
+    VisitMarks visitedCells(cellCnt());
+    size_t visitedCnt = 0;
+    std::vector<CrawlStep> stack;
+    depthFirst(stack, CrawlStep { from, Cell::INVALID_ID, UINT32_MAX }, [&](const CrawlStep& step) {
+        if (step.fanoutIdx != UINT32_MAX)
+        {
+            uint32_t idx = step.fanoutIdx;
+            std::cout << "\n Cell #" << std::setw(2) << step.prevCell << " (" << types[step.prevCell] << ") " << std::setw(2) << portNames[fanoutSrcPort[idx]] << " -> " << std::setw(2) << fanoutNet[idx] << " -> " << std::setw(2) << portNames[fanoutDstPort[idx]] << " ->";
+        }
+        std::cout << " Cell #" << std::setw(2) << step.cellId << " (" << types[step.cellId] << ")";
+
+        if (! visitedCells.visit(step.cellId))
+        {
+            std::cerr << "\nCircular network! Found node #" << step.cellId << " again!\n";
+            if (stopOnCircular)
+                throw std::runtime_error("Circular network");
+            else
+                return false;
+        }
+
+        if (maxCellCnt > 0 && ++visitedCnt >= maxCellCnt)
+        {
+            std::cout << "\nMax cell count reached, terminating crawl\n";
+            throw std::runtime_error("Max cell count reached");
+        }
+
+        if (fanoutOffsets[step.cellId] == fanoutOffsets[step.cellId + 1])
+        {
+            std::cout << "\nDead-end: #" << step.cellId << " (" << types[step.cellId] << ") (" << cells[step.cellId]->name << ")" << std::endl;
+            return false;
+        }
+        return true;
+    }, [&](const CrawlStep& step, auto push) {
+        for (uint32_t idx = fanoutOffsets[step.cellId]; idx < fanoutOffsets[step.cellId + 1]; ++idx)
+        {
+            push({ fanout[idx], step.cellId, idx });
+        }
+    });
+}
+
+size_t NetlistGraph::memoryBytes() const
+{
+    size_t bytes = sizeof(*this)
+        + vectorBytes(types) + vectorBytes(cells)
+        + vectorBytes(faninOffsets) + vectorBytes(fanin) + vectorBytes(faninPort)
+        + vectorBytes(fanoutOffsets) + vectorBytes(fanout) + vectorBytes(fanoutSrcPort) + vectorBytes(fanoutDstPort) + vectorBytes(fanoutNet)
+        + vectorBytes(portNames);
+    for (const std::string& name : portNames)
+    {
+        if (name.capacity() > 15) bytes += name.capacity() + 1;
+    }
+    return bytes;
+}
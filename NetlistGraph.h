@@ -0,0 +1,74 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string>
+#include <vector>
+
+#include "Cell.h"
+#include "Netlist.h"
+
+typedef uint16_t portNameId_t;
+
+// Immutable compressed sparse row view of a netlist. Cell ids are the dense ids assigned by the loader,
+// fanin and fanout of every cell are contiguous ranges in shared arrays and port names are interned.
+struct NetlistGraph
+{
+    std::vector<Cell::Type> types;
+    // Original cells, for names and sources only
+    std::vector<const Cell*> cells;
+
+    // faninOffsets[id] .. faninOffsets[id + 1] index fanin / faninPort, in input port order
+    std::vector<uint32_t> faninOffsets;
+    std::vector<cellId_t> fanin;
+    std::vector<portNameId_t> faninPort;
+
+    // fanoutOffsets[id] .. fanoutOffsets[id + 1] index the fanout arrays, sorted by destination cell id
+    std::vector<uint32_t> fanoutOffsets;
+    std::vector<cellId_t> fanout;
+    std::vector<portNameId_t> fanoutSrcPort;
+    std::vector<portNameId_t> fanoutDstPort;
+    std::vector<portId_t> fanoutNet;
+
+    std::vector<std::string> portNames;
+
+    size_t cellCnt() const { return types.size(); }
+
+    std::span<const cellId_t> faninOf(cellId_t cellId) const
+    {
+        return { fanin.data() + faninOffsets[cellId], fanin.data() + faninOffsets[cellId + 1] };
+    }
+
+    std::span<const cellId_t> fanoutOf(cellId_t cellId) const
+    {
+        return { fanout.data() + fanoutOffsets[cellId], fanout.data() + fanoutOffsets[cellId + 1] };
+    }
+
+    template <typename Func>
+    void doForAllInputCells(cellId_t cellId, Func func) const
+    {
+        for (cellId_t prevCell : faninOf(cellId))
+        {
+            if (! func(prevCell)) return;
+        }
+    }
+
+    template <typename Func>
+    void doForAllOutputCells(cellId_t cellId, Func func) const
+    {
+        for (cellId_t nextCell : fanoutOf(cellId))
+        {
+            if (! func(nextCell)) return;
+        }
+    }
+
+    bool hasLinkTo(cellId_t from, cellId_t to) const;
+
+    // Same output as Cell::crawlForward, except that the fanout of a cell is followed in the order of the destination
+    // cell ids, which hasLinkTo relies on, instead of the order of its ports and links
+    void crawlForward(cellId_t from, const bool stopOnCircular = true, const size_t maxCellCnt = 0) const;
+
+    size_t memoryBytes() const;
+
+    static NetlistGraph build(const Netlist& netlist);
+};
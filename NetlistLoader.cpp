@@ -0,0 +1,782 @@
+#include "NetlistLoader.h"
+
+#include <algorithm>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <unordered_map>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+#include "CompressedInput.h"
+#include "JsonScanner.h"
+#include "MappedFile.h"
+#include "Profiler.h"
+#include "StringStore.h"
+#include "ThreadPool.h"
+
+using json = nlohmann::json;
+
+// Yosys writes boolean attributes as bit strings like "00000000000000000000000000000001"
+static bool isTruthyAttribute(const std::string& value)
+{
+    return value.find('1') != std::string::npos;
+}
+
+static Port::Type parsePortDirection(std::string_view direction, std::string_view portName, std::string_view cellName)
+{
+    if (direction == "input") return Port::Type::INPUT;
+    if (direction == "output") return Port::Type::OUTPUT;
+
+    throw std::runtime_error("Could not determine type of port " + std::string(portName) + " of cell " + std::string(cellName) + ": " + std::string(direction));
+}
+
+void loadDesign(const std::string& fileName, Design& design, LoaderKind loader /* = LoaderKind::Mapped */, ThreadPool* pool /* = nullptr */)
+{
+    PROFILE_SCOPE("json load");
+    PROFILE_COUNT("bytes read", [&]() {
+        std::error_code ec;
+        uintmax_t size = std::filesystem::file_size(fileName, ec);
+        return ec ? 0 : size;
+    }());
+
+    Compression compression = detectCompression(fileName);
+    if (compression != Compression::None)
+    {
+        // The mapped loader needs the whole text in place, compressed files are streamed through SAX instead
+        DecompressingStreamBuf buffer(fileName, compression);
+        std::istream input(&buffer);
+        if (loader == LoaderKind::DOM)
+            loadDesignDom(input, design);
+        else
+            loadDesignSax(input, design);
+    }
+    else if (loader == LoaderKind::Mapped)
+    {
+        loadDesignMapped(fileName, design, pool);
+    }
+    else
+    {
+        std::ifstream file(fileName);
+        if (! file)
+            throw std::runtime_error("Could not open file: " + fileName);
+
+        if (loader == LoaderKind::DOM)
+            loadDesignDom(file, design);
+        else
+            loadDesignSax(file, design);
+    }
+
+    design.resolveHierarchy();
+}
+
+static bool isTruthyAttribute(const json& value)
+{
+    if (value.is_string()) return isTruthyAttribute(value.get<std::string>());
+    if (value.is_number()) return value.get<long long>() != 0;
+    return value.is_boolean() && value.get<bool>();
+}
+
+static void loadModuleDom(const json& moduleData, Netlist& netlist)
+{
+    if (moduleData.contains("attributes"))
+    {
+        const auto& attributes = moduleData.at("attributes");
+        netlist.isTop = attributes.contains("top") && isTruthyAttribute(attributes.at("top"));
+        netlist.isBlackbox = attributes.contains("blackbox") && isTruthyAttribute(attributes.at("blackbox"));
+    }
+
+    if (moduleData.contains("ports"))
+    {
+        for (const auto& portData : moduleData.at("ports").items())
+        {
+            const std::string& direction = portData.value().at("direction");
+            if (direction != "input" && direction != "output") continue;
+
+            ModulePort& port = netlist.ports.emplace_back();
+            port.name = portData.key();
+            port.direction = direction == "input" ? Port::Type::INPUT : Port::Type::OUTPUT;
+            for (const auto& bit : portData.value().at("bits"))
+            {
+                port.bits.push_back(bit.is_number_integer() ? bit.get<portId_t>() : Port::INVALID_ID);
+            }
+        }
+    }
+
+    if (! moduleData.contains("cells")) return;
+
+    CellRecord record;
+    for (const auto& cellData : moduleData.at("cells").items())
+    {
+        record.clear();
+        record.name = cellData.key();
+        record.type = cellData.value().at("type");
+        record.verilogSrc = cellData.value().at("attributes").at("src");
+
+        const auto& portDirections = cellData.value().at("port_directions");
+        for (const auto& connectionList : cellData.value().at("connections").items())
+        {
+            const std::string& portName = connectionList.key();
+            CellRecord::Connection& connection = record.addConnection();
+            connection.portName = portName;
+            connection.type = parsePortDirection(portDirections.at(portName).get_ref<const std::string&>(), portName, record.name);
+
+            for (const auto& remotePort : connectionList.value())
+            {
+                switch (remotePort.type())
+                {
+                    case json::value_t::string:
+                        // not connected
+                        connection.bits.push_back(Port::INVALID_ID);
+                        break;
+                    case json::value_t::number_integer:
+                    case json::value_t::number_unsigned:
+                        connection.bits.push_back(remotePort);
+                        break;
+                    default:
+                        throw std::runtime_error("Invalid port connection in cell " + record.name + " port " + portName + ": " + remotePort.dump());
+                }
+            }
+        }
+
+        netlist.addCell(record);
+    }
+}
+
+void loadDesignDom(std::istream& input, Design& design)
+{
+    PROFILE_SCOPE("json parse (DOM)");
+    json data = json::parse(input);
+
+    for (const auto& moduleData : data.at("modules").items())
+    {
+        loadModuleDom(moduleData.value(), design.addModule(moduleData.key()));
+    }
+}
+
+namespace
+{
+    // Picks the module attributes, ports and cells out of the token stream. Everything else (parameters,
+    // netnames) is skipped without being stored, so memory use is bound by the largest cell.
+    class NetlistSaxHandler
+    {
+    public:
+        explicit NetlistSaxHandler(Design& design) : design(design) {}
+
+        bool null() { return scalar("null"); }
+        bool boolean(bool val)
+        {
+            if (context() == Context::ModuleAttributes) moduleAttribute(val);
+            return scalar("boolean");
+        }
+        bool number_integer(json::number_integer_t val) { return number(static_cast<long long>(val)); }
+        bool number_unsigned(json::number_unsigned_t val) { return number(static_cast<long long>(val)); }
+        bool number_float(json::number_float_t, const std::string& str) { return scalar(str); }
+        bool binary(json::binary_t&) { return scalar("binary"); }
+
+        bool string(std::string& val)
+        {
+            switch (context())
+            {
+                case Context::ModuleAttributes:
+                    moduleAttribute(isTruthyAttribute(val));
+                    break;
+                case Context::ModulePort:
+                    if (lastKey == "direction") portDirection = std::move(val);
+                    break;
+                case Context::ModulePortBits:
+                    port.bits.push_back(Port::INVALID_ID);
+                    break;
+                case Context::Cell:
+                    if (lastKey == "type") record.type = val;
+                    break;
+                case Context::Attributes:
+                    if (lastKey == "src")
+                    {
+                        record.verilogSrc = val;
+                        hasSrc = true;
+                    }
+                    break;
+                case Context::PortDirections:
+                    portDirections.emplace_back(lastKey, std::move(val));
+                    break;
+                case Context::ConnectionBits:
+                    // not connected
+                    record.connections.back().bits.push_back(Port::INVALID_ID);
+                    break;
+                default:
+                    break;
+            }
+            return true;
+        }
+
+        bool start_object(std::size_t)
+        {
+            Context next = Context::Skip;
+            switch (context())
+            {
+                case Context::None: next = Context::Root; break;
+                case Context::Root: if (lastKey == "modules") next = Context::Modules; break;
+                case Context::Modules:
+                    next = Context::Module;
+                    netlist = &design.addModule(lastKey);
+                    break;
+                case Context::Module:
+                    if (lastKey == "cells") next = Context::Cells;
+                    else if (lastKey == "attributes") next = Context::ModuleAttributes;
+                    else if (lastKey == "ports") next = Context::ModulePorts;
+                    break;
+                case Context::ModulePorts:
+                    next = Context::ModulePort;
+                    port = ModulePort();
+                    port.name = lastKey;
+                    portDirection.clear();
+                    break;
+                case Context::Cells:
+                    next = Context::Cell;
+                    record.clear();
+                    record.name = lastKey;
+                    portDirections.clear();
+                    hasSrc = false;
+                    break;
+                case Context::Cell:
+                    if (lastKey == "attributes") next = Context::Attributes;
+                    else if (lastKey == "port_directions") next = Context::PortDirections;
+                    else if (lastKey == "connections") next = Context::Connections;
+                    break;
+                default:
+                    break;
+            }
+            stack.push_back(next);
+            return true;
+        }
+
+        bool end_object()
+        {
+            Context finished = context();
+            stack.pop_back();
+            if (finished == Context::Cell) finishCell();
+            else if (finished == Context::ModulePort) finishPort();
+            else if (finished == Context::Root) finishDocument();
+            return true;
+        }
+
+        bool start_array(std::size_t)
+        {
+            if (context() == Context::ModulePort && lastKey == "bits")
+            {
+                stack.push_back(Context::ModulePortBits);
+            }
+            else if (context() == Context::Connections)
+            {
+                CellRecord::Connection& connection = record.addConnection();
+                connection.portName = lastKey;
+                stack.push_back(Context::ConnectionBits);
+            }
+            else
+            {
+                stack.push_back(Context::Skip);
+            }
+            return true;
+        }
+
+        bool end_array()
+        {
+            stack.pop_back();
+            return true;
+        }
+
+        bool key(std::string& val)
+        {
+            lastKey = val;
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception& ex)
+        {
+            throw std::runtime_error(std::string("JSON parse error: ") + ex.what());
+        }
+
+    private:
+        enum class Context
+        {
+            None, Root, Modules, Module, ModuleAttributes, ModulePorts, ModulePort, ModulePortBits,
+            Cells, Cell, Attributes, PortDirections, Connections, ConnectionBits, Skip
+        };
+
+        Context context() const
+        {
+            return stack.empty() ? Context::None : stack.back();
+        }
+
+        bool number(long long val)
+        {
+            switch (context())
+            {
+                case Context::ConnectionBits: record.connections.back().bits.push_back(static_cast<portId_t>(val)); break;
+                case Context::ModulePortBits: port.bits.push_back(static_cast<portId_t>(val)); break;
+                case Context::ModuleAttributes: moduleAttribute(val != 0); break;
+                default: break;
+            }
+            return true;
+        }
+
+        void moduleAttribute(bool value)
+        {
+            if (lastKey == "top") netlist->isTop = value;
+            else if (lastKey == "blackbox") netlist->isBlackbox = value;
+        }
+
+        bool scalar(const std::string& str)
+        {
+            if (context() == Context::ConnectionBits)
+                throw std::runtime_error("Invalid port connection in cell " + record.name + " port " + record.connections.back().portName + ": " + str);
+            return true;
+        }
+
+        void finishCell()
+        {
+            if (record.type.empty() || ! hasSrc)
+                throw std::out_of_range("Cell " + record.name + " has no type or src attribute");
+
+            for (auto& connection : record.connections)
+            {
+                auto it = std::find_if(portDirections.begin(), portDirections.end(), [&](const auto& dir) { return dir.first == connection.portName; });
+                if (it == portDirections.end())
+                    throw std::out_of_range("Port " + connection.portName + " of cell " + record.name + " has no direction");
+                connection.type = parsePortDirection(it->second, connection.portName, record.name);
+            }
+
+            netlist->addCell(record);
+        }
+
+        void finishPort()
+        {
+            if (portDirection != "input" && portDirection != "output") return;
+
+            port.direction = portDirection == "input" ? Port::Type::INPUT : Port::Type::OUTPUT;
+            netlist->ports.push_back(std::move(port));
+        }
+
+        void finishDocument()
+        {
+            if (design.modules.empty())
+                throw std::out_of_range("No modules found");
+        }
+
+        Design& design;
+        Netlist* netlist = nullptr;
+        std::vector<Context> stack;
+        std::string lastKey;
+
+        CellRecord record;
+        std::vector<std::pair<std::string, std::string>> portDirections;
+        bool hasSrc = false;
+
+        ModulePort port;
+        std::string portDirection;
+    };
+}
+
+void loadDesignSax(std::istream& input, Design& design)
+{
+    PROFILE_SCOPE("json parse (SAX)");
+    NetlistSaxHandler handler(design);
+    json::sax_parse(input, &handler);
+}
+
+namespace
+{
+    // Cells tokenized in place. The strings are views into the mapped document, only the ones with escape
+    // sequences are decoded into the store of the table's chunk.
+    class CellTable
+    {
+    public:
+        // Appends the cell object at the scanner position
+        void scanCell(JsonScanner& scanner, std::string_view rawName)
+        {
+            Entry& cell = cells.emplace_back(Entry { decode(rawName), {}, {}, connections.size(), 0, 0 });
+            bool hasSrc = false;
+            portDirections.clear();
+
+            scanner.forEachMember([&](std::string_view key) {
+                if (key == "type")
+                {
+                    cell.type = scanner.readString(chunk->strings);
+                }
+                else if (key == "attributes")
+                {
+                    scanner.forEachMember([&](std::string_view attribute) {
+                        if (attribute == "src" && scanner.peek() == '"')
+                        {
+                            cell.verilogSrc = scanner.readString(chunk->strings);
+                            hasSrc = true;
+                        }
+                        else
+                        {
+                            scanner.skipValue();
+                        }
+                    });
+                }
+                else if (key == "port_directions")
+                {
+                    scanner.forEachMember([&](std::string_view portName) {
+                        portDirections.emplace_back(decode(portName), scanner.readString(chunk->strings));
+                    });
+                }
+                else if (key == "connections")
+                {
+                    scanner.forEachMember([&](std::string_view portName) {
+                        Connection& connection = connections.emplace_back(Connection { decode(portName), Port::Type::INPUT, bits.size(), 0 });
+                        if (! scanner.readIntegerArray(bits, Port::INVALID_ID)) invalidBit(scanner, cell, connection);
+                        connection.bitCnt = bits.size() - connection.firstBit;
+                    });
+                }
+                else
+                {
+                    scanner.skipValue();
+                }
+            });
+
+            if (cell.type.empty() || ! hasSrc)
+                throw std::out_of_range("Cell " + std::string(cell.name) + " has no type or src attribute");
+
+            cell.connectionCnt = connections.size() - cell.firstConnection;
+            for (size_t connectionIdx = cell.firstConnection; connectionIdx < connections.size(); ++connectionIdx)
+            {
+                Connection& connection = connections[connectionIdx];
+                auto it = std::find_if(portDirections.begin(), portDirections.end(), [&](const auto& dir) { return dir.first == connection.portName; });
+                if (it == portDirections.end())
+                    throw std::out_of_range("Port " + std::string(connection.portName) + " of cell " + std::string(cell.name) + " has no direction");
+                connection.type = parsePortDirection(it->second, connection.portName, cell.name);
+            }
+        }
+
+        // Adds the cells in their document order, which creates the links of their nets. The views into the
+        // document are kept as they are, the netlist has to hold on to its mapping.
+        void addTo(Netlist& netlist, std::string_view document) const
+        {
+            auto owned = [&](std::string_view str) {
+                bool inDocument = ! std::less<const char*>()(str.data(), document.data()) && std::less<const char*>()(str.data(), document.data() + document.size());
+                return inDocument || str.empty() ? str : netlist.strings.store(str);
+            };
+
+            for (const Entry& entry : cells)
+            {
+                Cell& cell = netlist.addCell(owned(entry.name), entry.type, owned(entry.verilogSrc));
+                for (size_t connectionIdx = entry.firstConnection; connectionIdx < entry.firstConnection + entry.connectionCnt; ++connectionIdx)
+                {
+                    const Connection& connection = connections[connectionIdx];
+                    for (size_t bitIdx = connection.firstBit; bitIdx < connection.firstBit + connection.bitCnt; ++bitIdx)
+                    {
+                        netlist.connect(cell, connection.portName, connection.type, bits[bitIdx]);
+                    }
+                }
+            }
+        }
+
+        // Parallel loading, after scanning on the worker: the type names in the order of their first cell and the
+        // largest net id
+        void collectTypes()
+        {
+            std::unordered_map<std::string_view, size_t> typeIdxs;
+            for (Entry& entry : cells)
+            {
+                auto [it, added] = typeIdxs.try_emplace(entry.type, types.size());
+                if (added) types.push_back({ entry.type, 0, nullptr });
+                ++types[it->second].cnt;
+                entry.typeIdx = it->second;
+            }
+
+            for (portId_t bit : bits)
+            {
+                if (bit < Port::INVALID_ID) throw std::out_of_range("Invalid net id " + std::to_string(bit));
+                largestNetId = std::max(largestNetId, bit);
+            }
+        }
+
+        // Serially in document order, so the types are resolved like when adding the cells one by one
+        void resolveTypes(Netlist& netlist)
+        {
+            for (TypeUse& type : types)
+            {
+                type.resolved = &netlist.countCellType(type.name, type.cnt);
+            }
+        }
+
+        // On the worker: creates the cells with ids from firstId on in the chunk's arena, together with their side of the
+        // links. Only reads the netlist's link table, which has to reach maxNetId already.
+        void build(Netlist& netlist, cellId_t firstId)
+        {
+            std::pmr::memory_resource* resource = chunk->arena.resource();
+            builtCells.reserve(cells.size());
+            linkRefs.reserve(bits.size());
+
+            for (size_t entryIdx = 0; entryIdx < cells.size(); ++entryIdx)
+            {
+                const Entry& entry = cells[entryIdx];
+                const auto& typePair = *types[entry.typeIdx].resolved;
+                Cell& cell = *builtCells.emplace_back(std::pmr::polymorphic_allocator<Cell>(resource).new_object<Cell>(firstId + static_cast<cellId_t>(entryIdx), entry.name, typePair.second.type, resource));
+                cell.typeName = typePair.first;
+                cell.verilogSrc = entry.verilogSrc;
+                const bool recordBits = cell.type == Cell::Type::Unknown || cell.type == Cell::Type::Instance;
+
+                for (size_t connectionIdx = entry.firstConnection; connectionIdx < entry.firstConnection + entry.connectionCnt; ++connectionIdx)
+                {
+                    const Connection& connection = connections[connectionIdx];
+                    const std::string_view portName = chunk->interned.intern(connection.portName);
+                    PortBits* portBits = recordBits ? &unknownCellPorts[cell.id].try_emplace(portName, PortBits { connection.type, {} }).first->second : nullptr;
+
+                    for (size_t bitIdx = connection.firstBit; bitIdx < connection.firstBit + connection.bitCnt; ++bitIdx)
+                    {
+                        if (portBits) portBits->bits.push_back(bits[bitIdx]);
+                        if (bits[bitIdx] == Port::INVALID_ID) continue;
+
+                        Link& link = netlist.links[bits[bitIdx]];
+                        linkRefs.push_back({ &link, &cell.attachPort(portName, link, connection.type) });
+                    }
+                }
+            }
+        }
+
+        // Serially in document order: attaches the ports to the links and hands the cells over to the netlist
+        void attachTo(Netlist& netlist)
+        {
+            netlist.cells.insert(netlist.cells.end(), builtCells.begin(), builtCells.end());
+            netlist.unknownCellPorts.merge(unknownCellPorts);
+            for (const LinkRef& ref : linkRefs)
+            {
+                ref.link->attach(*ref.port);
+            }
+            netlist.cellChunks.push_back(std::move(chunk));
+        }
+
+        size_t cellCnt() const { return cells.size(); }
+        portId_t maxNetId() const { return largestNetId; }
+
+        void clear()
+        {
+            cells.clear();
+            connections.clear();
+            bits.clear();
+        }
+
+    private:
+        struct Entry
+        {
+            std::string_view name;
+            std::string_view type;
+            std::string_view verilogSrc;
+            size_t firstConnection;
+            size_t connectionCnt;
+            // into types, set by collectTypes
+            size_t typeIdx;
+        };
+
+        struct Connection
+        {
+            std::string_view portName;
+            Port::Type type;
+            size_t firstBit;
+            size_t bitCnt;
+        };
+
+        struct TypeUse
+        {
+            std::string_view name;
+            size_t cnt;
+            const std::pair<const std::string, CellTypeCount>* resolved;
+        };
+
+        struct LinkRef
+        {
+            Link* link;
+            Port* port;
+        };
+
+        std::string_view decode(std::string_view raw)
+        {
+            if (raw.find('\\') == std::string_view::npos) return raw;
+            return chunk->strings.store(JsonScanner::unescape(raw));
+        }
+
+        [[noreturn]] static void invalidBit(JsonScanner& scanner, const Entry& cell, const Connection& connection)
+        {
+            const char* valueBegin = scanner.position();
+            scanner.skipValue();
+            throw std::runtime_error("Invalid port connection in cell " + std::string(cell.name) + " port " + std::string(connection.portName) + ": "
+                + std::string(valueBegin, scanner.position()));
+        }
+
+        std::vector<Entry> cells;
+        std::vector<Connection> connections;
+        std::vector<portId_t> bits;
+        std::vector<std::pair<std::string_view, std::string_view>> portDirections;
+        std::unique_ptr<Netlist::CellChunk> chunk = std::make_unique<Netlist::CellChunk>();
+
+        std::vector<TypeUse> types;
+        portId_t largestNetId = Port::INVALID_ID;
+        std::vector<Cell*> builtCells;
+        std::vector<LinkRef> linkRefs;
+        std::map<cellId_t, std::map<std::string_view, PortBits>> unknownCellPorts;
+    };
+
+    // chunks below this size cost more in scheduling than they save
+    constexpr size_t MIN_CHUNK_BYTES = 256 * 1024;
+
+    struct CellSpan
+    {
+        std::string_view rawName;
+        const char* valueBegin;
+        const char* valueEnd;
+    };
+
+    // Tokenizes runs of cells on the pool into chunk local tables and builds their cells there as well. Only the
+    // type names and the link ends are merged serially, in document order.
+    void loadCellsParallel(const std::vector<CellSpan>& spans, Netlist& netlist, ThreadPool& pool, std::string_view document)
+    {
+        if (spans.empty()) return;
+
+        // several chunks per thread so a slow chunk doesn't leave the others idle
+        const size_t sectionBytes = spans.back().valueEnd - spans.front().rawName.data();
+        const size_t chunkBytes = std::max<size_t>(MIN_CHUNK_BYTES, sectionBytes / (pool.threadCnt() * 4) + 1);
+
+        std::vector<std::pair<size_t, size_t>> chunkSpans;
+        size_t chunkBegin = 0;
+        for (size_t spanIdx = 0; spanIdx < spans.size(); ++spanIdx)
+        {
+            if (size_t(spans[spanIdx].valueEnd - spans[chunkBegin].rawName.data()) >= chunkBytes || spanIdx + 1 == spans.size())
+            {
+                chunkSpans.emplace_back(chunkBegin, spanIdx + 1);
+                chunkBegin = spanIdx + 1;
+            }
+        }
+        PROFILE_COUNT("cell chunks", chunkSpans.size());
+
+        std::vector<CellTable> chunks(chunkSpans.size());
+        // errors are rethrown in chunk order so they match the serial loader
+        auto forEachChunk = [&](auto func) {
+            std::vector<std::exception_ptr> errors(chunks.size());
+            pool.parallelFor(chunks.size(), 1, [&](size_t begin, size_t end, size_t) {
+                for (size_t chunkIdx = begin; chunkIdx < end; ++chunkIdx)
+                {
+                    try
+                    {
+                        func(chunkIdx);
+                    }
+                    catch (...)
+                    {
+                        errors[chunkIdx] = std::current_exception();
+                    }
+                }
+            });
+            for (const std::exception_ptr& error : errors)
+            {
+                if (error) std::rethrow_exception(error);
+            }
+        };
+
+        {
+            PROFILE_SCOPE("cell chunk parse");
+            forEachChunk([&](size_t chunkIdx) {
+                JsonScanner scanner(document.data(), document.data() + document.size());
+                for (size_t spanIdx = chunkSpans[chunkIdx].first; spanIdx < chunkSpans[chunkIdx].second; ++spanIdx)
+                {
+                    scanner.seek(spans[spanIdx].valueBegin);
+                    chunks[chunkIdx].scanCell(scanner, spans[spanIdx].rawName);
+                }
+                chunks[chunkIdx].collectTypes();
+            });
+        }
+
+        std::vector<cellId_t> firstIds(chunks.size());
+        {
+            PROFILE_SCOPE("cell type resolution");
+            cellId_t nextId = netlist.cells.size();
+            portId_t maxNetId = Port::INVALID_ID;
+            for (size_t chunkIdx = 0; chunkIdx < chunks.size(); ++chunkIdx)
+            {
+                chunks[chunkIdx].resolveTypes(netlist);
+                firstIds[chunkIdx] = nextId;
+                nextId += chunks[chunkIdx].cellCnt();
+                maxNetId = std::max(maxNetId, chunks[chunkIdx].maxNetId());
+            }
+            if (maxNetId != Port::INVALID_ID) netlist.linkOf(maxNetId);
+            netlist.cells.reserve(nextId);
+        }
+
+        {
+            PROFILE_SCOPE("cell chunk build");
+            forEachChunk([&](size_t chunkIdx) { chunks[chunkIdx].build(netlist, firstIds[chunkIdx]); });
+        }
+
+        PROFILE_SCOPE("cell merge");
+        for (CellTable& chunk : chunks)
+        {
+            chunk.attachTo(netlist);
+        }
+    }
+}
+
+void loadDesignMapped(const std::string& fileName, Design& design, ThreadPool* pool /* = nullptr */)
+{
+    PROFILE_SCOPE("json parse (mmap)");
+    auto file = std::make_shared<const MappedFile>(fileName);
+    const std::string_view document = file->view();
+    const bool parallel = pool && pool->threadCnt() > 1;
+
+    JsonScanner scanner(document.data(), document.data() + document.size());
+    scanner.forEachMember([&](std::string_view rootKey) {
+        if (rootKey != "modules")
+        {
+            scanner.skipValue();
+            return;
+        }
+
+        scanner.forEachMember([&](std::string_view rawModuleName) {
+            Netlist& netlist = design.addModule(JsonScanner::unescape(rawModuleName));
+            netlist.mappings.push_back(file);
+            json moduleData = json::object();
+            std::vector<CellSpan> spans;
+            CellTable cell;
+
+            scanner.forEachMember([&](std::string_view moduleKey) {
+                const char* valueBegin = scanner.position();
+                if (moduleKey == "cells" && parallel)
+                {
+                    scanner.forEachMember([&](std::string_view rawCellName) {
+                        const char* cellBegin = scanner.position();
+                        scanner.skipValue();
+                        spans.push_back({ rawCellName, cellBegin, scanner.position() });
+                    });
+                }
+                else if (moduleKey == "cells")
+                {
+                    scanner.forEachMember([&](std::string_view rawCellName) {
+                        cell.clear();
+                        cell.scanCell(scanner, rawCellName);
+                        cell.addTo(netlist, document);
+                    });
+                }
+                else
+                {
+                    scanner.skipValue();
+                    if (moduleKey == "attributes" || moduleKey == "ports")
+                        moduleData[std::string(moduleKey)] = json::parse(valueBegin, scanner.position());
+                }
+            });
+
+            loadModuleDom(moduleData, netlist);
+            if (parallel) loadCellsParallel(spans, netlist, *pool, document);
+        });
+    });
+
+    if (scanner.peek() != 0)
+        scanner.fail("unexpected content after the document");
+    if (design.modules.empty())
+        throw std::out_of_range("No modules found");
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+
+#include "Design.h"
+
+class ThreadPool;
+
+enum class LoaderKind
+{
+    Mapped, SAX, DOM
+};
+
+// Reads all modules of a Yosys JSON netlist into the design and resolves its hierarchy.
+// Throws std::out_of_range on unexpected schema and std::runtime_error on invalid content.
+// The pool is only used by the mapped loader. gzip and zstd compressed files are decompressed on a thread of
+// their own while the SAX (or with LoaderKind::DOM the DOM) loader reads them.
+void loadDesign(const std::string& fileName, Design& design, LoaderKind loader = LoaderKind::Mapped, ThreadPool* pool = nullptr);
+
+// Builds the whole nlohmann::json DOM first, then walks it
+void loadDesignDom(std::istream& input, Design& design);
+
+// Streams the document through a SAX handler, only a single cell is held in memory at a time
+void loadDesignSax(std::istream& input, Design& design);
+
+// Maps the file and tokenizes it in place. Cell names, types, src attributes and port names stay views into the
+// mapping, which the netlists keep alive. With a pool of more than one thread each module's cells section is
+// split into chunks that are tokenized in parallel and then added in document order, giving the same netlist.
+void loadDesignMapped(const std::string& fileName, Design& design, ThreadPool* pool = nullptr);
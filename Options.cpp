@@ -0,0 +1,173 @@
+#include "Options.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+// Bytes with an optional K, M or G suffix for KiB, MiB or GiB
+static size_t parseByteSize(const std::string& value)
+{
+    size_t end = 0;
+    size_t bytes = std::stoull(value, &end);
+    std::string suffix = value.substr(end);
+    if (suffix == "K" || suffix == "k") return bytes << 10;
+    if (suffix == "M" || suffix == "m") return bytes << 20;
+    if (suffix == "G" || suffix == "g") return bytes << 30;
+    if (! suffix.empty()) throw std::invalid_argument("Invalid size: " + value);
+    return bytes;
+}
+
+/*static*/ Options Options::parse(int argc, char* argv[])
+{
+    Options options;
+    std::vector<std::string> positionals;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+        auto nextValue = [&]() -> std::string {
+            if (i + 1 >= argc) throw std::invalid_argument("Missing value for " + arg);
+            return argv[++i];
+        };
+
+        if (arg == "--loader")
+        {
+            std::string loader = nextValue();
+            if (loader == "mmap") options.loader = LoaderKind::Mapped;
+            else if (loader == "sax") options.loader = LoaderKind::SAX;
+            else if (loader == "dom") options.loader = LoaderKind::DOM;
+            else throw std::invalid_argument("Unknown loader: " + loader);
+        }
+        else if (arg == "--arch")
+        {
+            options.architecture = parseArchitecture(nextValue());
+        }
+        else if (arg == "--no-cache")
+        {
+            options.useCache = false;
+        }
+        else if (arg == "--mem-stats")
+        {
+            options.printMemoryStats = true;
+        }
+        else if (arg == "--threads")
+        {
+            options.threadCnt = std::stoul(nextValue());
+            if (options.threadCnt == 0) options.threadCnt = std::max(1u, std::thread::hardware_concurrency());
+        }
+        else if (arg == "--delay-model")
+        {
+            options.delayModelFile = nextValue();
+        }
+        else if (arg == "--state")
+        {
+            options.stateFile = nextValue();
+        }
+        else if (arg == "--top")
+        {
+            options.topCnt = std::stoul(nextValue());
+        }
+        else if (arg == "--paths-per-endpoint")
+        {
+            options.pathsPerEndpoint = std::stoul(nextValue());
+            if (options.pathsPerEndpoint == 0) throw std::invalid_argument("--paths-per-endpoint must be at least 1");
+        }
+        else if (arg == "--export")
+        {
+            options.exportFile = nextValue();
+        }
+        else if (arg == "--src-report")
+        {
+            options.srcReportCnt = std::stoul(nextValue());
+        }
+        else if (arg == "--clock-domains")
+        {
+            options.clockDomainPathCnt = std::stoul(nextValue());
+        }
+        else if (arg == "--pipeline-depth")
+        {
+            options.pipelineDepth = std::stoul(nextValue());
+            if (options.pipelineDepth == 0) throw std::invalid_argument("--pipeline-depth must be at least 1");
+        }
+        else if (arg == "--batch")
+        {
+            options.batch = true;
+        }
+        else if (arg == "--batch-memory")
+        {
+            options.batchMemoryBytes = parseByteSize(nextValue());
+        }
+        else if (arg == "--serve")
+        {
+            options.serve = true;
+        }
+        else if (arg == "--serve-socket")
+        {
+            options.serve = true;
+            options.serveSocket = nextValue();
+        }
+        else if (arg == "--profile")
+        {
+            options.profile = true;
+        }
+        else if (arg == "--profile-trace")
+        {
+            options.profile = true;
+            options.profileTraceFile = nextValue();
+        }
+        else if (arg.starts_with("--"))
+        {
+            throw std::invalid_argument("Unknown option: " + arg);
+        }
+        else
+        {
+            positionals.push_back(arg);
+        }
+    }
+
+    if (options.batch)
+    {
+        if (positionals.empty()) throw std::invalid_argument("No netlists for the batch");
+        options.batchPatterns = std::move(positionals);
+        return options;
+    }
+
+    if (positionals.empty() || positionals.size() > 2)
+        throw std::invalid_argument("Invalid number of arguments");
+
+    options.fileName = positionals[0];
+    if (positionals.size() >= 2)
+        options.histogramHeight = std::stol(positionals[1]);
+
+    return options;
+}
+
+/*static*/ void Options::printUsage(std::ostream& os, const char* programName)
+{
+    os << "Usage: " << programName << " [options] <netlist.json> [histogram height]\n"
+        << "       " << programName << " [options] --batch <netlist.json | glob | @listfile>...\n"
+        << "Options:\n"
+        << "  --loader mmap|sax|dom  JSON loader: in place on the mapped file (default), streaming SAX or full DOM\n"
+        << "  --arch NAME         Cell library: ice40, ecp5, generic (Yosys internal cells) or auto (default)\n"
+        << "  --no-cache          Neither read nor write the binary netlist cache next to the JSON file\n"
+        << "  --mem-stats         Print load allocations and compare the memory of the netlist and its CSR graph\n"
+        << "  --threads N         Worker threads for loading and the path analysis, 0 for all cores (default: 1)\n"
+        << "  --delay-model FILE  Rank paths by estimated delay using a timing table, \"ice40\" for the built-in one\n"
+        << "  --state FILE        Reuse the results of the previous run stored in FILE, only recompute what changed\n"
+        << "  --top K             Number of endpoints in the path report (default: 10)\n"
+        << "  --paths-per-endpoint N  Report the N longest distinct paths into each endpoint (default: 1)\n"
+        << "  --export FILE       Write the path of every endpoint as CSV (*.csv) or JSON Lines, \"-\" for stdout\n"
+        << "  --src-report N      Rank source lines and files by the longest paths through them, list N lines\n"
+        << "  --clock-domains N   Analyze every clock domain on its own, list its N longest paths and the paths into it\n"
+        << "                      from other domains\n"
+        << "  --pipeline-depth D  Suggest the fewest pipeline registers that bring all paths down to D levels of logic\n"
+        << "  --batch             Analyze several netlists concurrently on the --threads workers and compare them in\n"
+        << "                      one table, '*' and '?' match file names, @FILE lists one netlist per line\n"
+        << "  --batch-memory SIZE Estimated memory of the netlists loaded at once, suffix K, M or G (default: half\n"
+        << "                      of the physical memory)\n"
+        << "  --serve             Keep the netlist loaded and answer queries on stdin instead of printing the report\n"
+        << "  --serve-socket PATH Like --serve, on a Unix domain socket until a client sends \"shutdown\"\n"
+        << "  --profile           Print phase timings and counters at the end\n"
+        << "  --profile-trace F   Like --profile, also write a Chrome trace event file\n";
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <limits>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Architecture.h"
+#include "NetlistLoader.h"
+
+struct Options
+{
+    std::string fileName;
+    // Netlist paths, globs and @list files of a batch run, which replaces the single netlist report
+    bool batch = false;
+    std::vector<std::string> batchPatterns;
+    // Memory estimate of the netlists loaded at the same time in a batch, 0 for half of the physical memory
+    size_t batchMemoryBytes = 0;
+    size_t histogramHeight = std::numeric_limits<size_t>::max();
+    LoaderKind loader = LoaderKind::Mapped;
+    Architecture architecture = Architecture::Auto;
+    bool printMemoryStats = false;
+    bool useCache = true;
+    size_t threadCnt = 1;
+    // Timing table file, "ice40" for the built-in table, empty for hop count analysis only
+    std::string delayModelFile;
+    // Analysis state of the previous run, enables the incremental analysis if it exists and is rewritten after the run
+    std::string stateFile;
+    size_t topCnt = 10;
+    // Distinct paths per reported endpoint, the timing report always shows one
+    size_t pathsPerEndpoint = 1;
+    // Paths of all endpoints in the format given by the file extension, "-" for stdout
+    std::string exportFile;
+    // Source lines listed in the rollup of the longest paths by src location, 0 for none
+    size_t srcReportCnt = 0;
+    // Longest paths listed per clock domain in the report of the domains, 0 for no such report
+    size_t clockDomainPathCnt = 0;
+    // Logic depth to suggest pipeline registers for, 0 for no advice
+    size_t pipelineDepth = 0;
+    // Answer queries on stdin after the analysis instead of printing the report
+    bool serve = false;
+    // Unix domain socket to answer queries on instead of stdin
+    std::string serveSocket;
+    bool profile = false;
+    // Chrome trace event file written by --profile-trace, implies profile
+    std::string profileTraceFile;
+
+    // Throws std::invalid_argument on unknown or malformed arguments
+    static Options parse(int argc, char* argv[]);
+    static void printUsage(std::ostream& os, const char* programName);
+};
@@ -0,0 +1,383 @@
+#include "PathAnalysis.h"
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+
+#include "CombinationalLoops.h"
+#include "Profiler.h"
+#include "TopK.h"
+
+std::vector<cellId_t> PathAnalysis::pathTo(cellId_t endpoint) const
+{
+    std::vector<cellId_t> path;
+    path.reserve(depth[endpoint] + 1);
+    for (cellId_t cellId = endpoint; cellId != Cell::INVALID_ID; cellId = predecessor[cellId])
+    {
+        path.push_back(cellId);
+    }
+    return path;
+}
+
+std::vector<cellId_t> PathAnalysis::sortedEndpoints() const
+{
+    std::vector<cellId_t> sorted = endpoints;
+    std::sort(sorted.begin(), sorted.end(), [&](cellId_t a, cellId_t b) {
+        return depth[a] != depth[b] ? depth[a] > depth[b] : a < b;
+    });
+    return sorted;
+}
+
+std::vector<cellId_t> PathAnalysis::topEndpoints(size_t k) const
+{
+    return selectTop(endpoints, k, [&](cellId_t a, cellId_t b) {
+        return depth[a] != depth[b] ? depth[a] > depth[b] : a < b;
+    });
+}
+
+void PathAnalysis::indexLoops(const NetlistGraph& graph)
+{
+    loops.clear();
+    loopOf.clear();
+    std::vector<cellId_t> loopCells;
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(onLoop.size()); ++cellId)
+    {
+        if (onLoop[cellId]) loopCells.push_back(cellId);
+    }
+    loopCellCnt = loopCells.size();
+    if (loopCells.empty()) return;
+
+    // The loops are the components of the cells on loops on their own, as two loops connected both ways would
+    // be one
+    CellComponents components = findStronglyConnected(graph, loopCells);
+    loopOf.assign(onLoop.size(), NO_LOOP);
+    for (size_t loopIdx = 0; loopIdx < components.size(); ++loopIdx)
+    {
+        loops.emplace_back(components[loopIdx].begin(), components[loopIdx].end());
+        for (cellId_t cellId : loops.back()) loopOf[cellId] = static_cast<uint32_t>(loopIdx);
+    }
+}
+
+void resolveLoops(const NetlistGraph& graph, PathAnalysis& analysis, std::span<const cellId_t> unorderedCells)
+{
+    PROFILE_SCOPE("loops");
+    CellComponents components = findStronglyConnected(graph, unorderedCells);
+    std::vector<uint32_t> componentOf(graph.cellCnt(), UINT32_MAX);
+    for (uint32_t componentIdx = 0; componentIdx < components.size(); ++componentIdx)
+    {
+        for (cellId_t cellId : components[componentIdx]) componentOf[cellId] = componentIdx;
+    }
+
+    // Like a single cell, except that the fanins inside the component do not count
+    for (uint32_t componentIdx = 0; componentIdx < components.size(); ++componentIdx)
+    {
+        depth_t maxDepth = 0;
+        cellId_t longestPred = Cell::INVALID_ID;
+        for (cellId_t cellId : components[componentIdx])
+        {
+            for (cellId_t prevCell : graph.faninOf(cellId))
+            {
+                if (PathAnalysis::isBoundary(graph.types[prevCell]) || componentOf[prevCell] == componentIdx) continue;
+                if (longestPred == Cell::INVALID_ID || analysis.depth[prevCell] > maxDepth)
+                {
+                    maxDepth = analysis.depth[prevCell];
+                    longestPred = prevCell;
+                }
+            }
+        }
+
+        bool loop = isLoop(graph, components[componentIdx]);
+        for (cellId_t cellId : components[componentIdx])
+        {
+            analysis.depth[cellId] = maxDepth + 1;
+            analysis.predecessor[cellId] = longestPred;
+            analysis.onLoop[cellId] = loop;
+        }
+    }
+}
+
+std::vector<RankedPath> worstPathsTo(const NetlistGraph& graph, const PathAnalysis& analysis, cellId_t endpoint, size_t k)
+{
+    // Partial paths share their suffixes, every node extends the one of its parent by one fanin cell
+    struct Node
+    {
+        cellId_t cellId;
+        uint32_t parent;
+        // combinational cells between this cell and the endpoint
+        depth_t suffixDepth;
+    };
+    struct Entry
+    {
+        depth_t bound;
+        uint32_t node;
+    };
+
+    std::vector<Node> nodes { { endpoint, UINT32_MAX, 0 } };
+    // ties are popped newest first, so a path is followed to its start before its siblings are tried
+    auto lower = [&](const Entry& a, const Entry& b) { return a.bound != b.bound ? a.bound < b.bound : a.node < b.node; };
+    std::vector<Entry> queue;
+    std::vector<cellId_t> faninCells;
+
+    auto expand = [&](uint32_t nodeIdx) {
+        const Node node = nodes[nodeIdx];
+        depth_t suffixDepth = nodeIdx == 0 ? 0 : node.suffixDepth + 1;
+
+        // a path into a loop continues at the cells feeding the loop, in the order resolveLoops sees them
+        faninCells.clear();
+        bool onLoop = analysis.onLoop[node.cellId];
+        std::span<const cellId_t> cells = onLoop ? std::span<const cellId_t>(analysis.loops[analysis.loopOf[node.cellId]]) : std::span<const cellId_t>(&node.cellId, 1);
+        for (cellId_t cellId : cells)
+        {
+            for (cellId_t prevCell : graph.faninOf(cellId))
+            {
+                if (PathAnalysis::isBoundary(graph.types[prevCell]) || (onLoop && analysis.loopOf[prevCell] == analysis.loopOf[node.cellId])) continue;
+                if (std::find(faninCells.begin(), faninCells.end(), prevCell) == faninCells.end()) faninCells.push_back(prevCell);
+            }
+        }
+
+        // reversed, so the first longest fanin is popped first like the predecessor chosen by the analysis
+        for (auto it = faninCells.rbegin(); it != faninCells.rend(); ++it)
+        {
+            nodes.push_back({ *it, nodeIdx, suffixDepth });
+            queue.push_back({ suffixDepth + analysis.depth[*it], static_cast<uint32_t>(nodes.size() - 1) });
+            std::push_heap(queue.begin(), queue.end(), lower);
+        }
+        return ! faninCells.empty();
+    };
+
+    std::vector<RankedPath> paths;
+    if (k == 0) return paths;
+    if (! expand(0))
+    {
+        paths.push_back({ 0, { endpoint } });
+        return paths;
+    }
+
+    while (! queue.empty() && paths.size() < k)
+    {
+        std::pop_heap(queue.begin(), queue.end(), lower);
+        Entry entry = queue.back();
+        queue.pop_back();
+
+        if (expand(entry.node)) continue;
+
+        RankedPath& path = paths.emplace_back();
+        path.depth = entry.bound;
+        for (uint32_t nodeIdx = entry.node; nodeIdx != UINT32_MAX; nodeIdx = nodes[nodeIdx].parent)
+        {
+            path.cells.push_back(nodes[nodeIdx].cellId);
+        }
+        std::reverse(path.cells.begin(), path.cells.end());
+    }
+    return paths;
+}
+
+PathAnalysis analyzeLongestPaths(const NetlistGraph& graph)
+{
+    PROFILE_SCOPE("longest paths");
+    const size_t cellCnt = graph.cellCnt();
+
+    PathAnalysis result;
+    result.depth.assign(cellCnt, 0);
+    result.predecessor.assign(cellCnt, Cell::INVALID_ID);
+
+    // Kahn's algorithm over the combinational cells only, boundaries act as path starts
+    std::vector<uint32_t> pendingInputs(cellCnt, 0);
+    std::vector<cellId_t> ready;
+    size_t combinationalCnt = 0;
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+    {
+        if (PathAnalysis::isEndpoint(graph.types[cellId]))
+            result.endpoints.push_back(cellId);
+        if (PathAnalysis::isBoundary(graph.types[cellId])) continue;
+
+        ++combinationalCnt;
+        for (cellId_t prevCell : graph.faninOf(cellId))
+        {
+            if (! PathAnalysis::isBoundary(graph.types[prevCell])) ++pendingInputs[cellId];
+        }
+        if (pendingInputs[cellId] == 0) ready.push_back(cellId);
+    }
+
+    size_t edgeCnt = 0;
+    auto relax = [&](cellId_t cellId) {
+        depth_t maxDepth = 0;
+        cellId_t longestPred = Cell::INVALID_ID;
+        edgeCnt += graph.faninOf(cellId).size();
+        for (cellId_t prevCell : graph.faninOf(cellId))
+        {
+            if (PathAnalysis::isBoundary(graph.types[prevCell]) || pendingInputs[prevCell] != 0) continue;
+            if (longestPred == Cell::INVALID_ID || result.depth[prevCell] > maxDepth)
+            {
+                maxDepth = result.depth[prevCell];
+                longestPred = prevCell;
+            }
+        }
+        result.predecessor[cellId] = longestPred;
+        return maxDepth;
+    };
+
+    size_t orderedCnt = 0;
+    while (! ready.empty())
+    {
+        cellId_t cellId = ready.back();
+        ready.pop_back();
+        ++orderedCnt;
+
+        result.depth[cellId] = relax(cellId) + 1;
+
+        edgeCnt += graph.fanoutOf(cellId).size();
+        for (cellId_t nextCell : graph.fanoutOf(cellId))
+        {
+            if (! PathAnalysis::isBoundary(graph.types[nextCell]) && --pendingInputs[nextCell] == 0)
+                ready.push_back(nextCell);
+        }
+    }
+    result.onLoop.assign(cellCnt, false);
+    if (orderedCnt < combinationalCnt)
+    {
+        std::vector<cellId_t> unorderedCells;
+        for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+        {
+            if (pendingInputs[cellId] != 0) unorderedCells.push_back(cellId);
+        }
+        resolveLoops(graph, result, unorderedCells);
+        for (cellId_t cellId : unorderedCells) pendingInputs[cellId] = 0;
+        result.indexLoops(graph);
+    }
+
+    for (cellId_t endpoint : result.endpoints)
+    {
+        result.depth[endpoint] = relax(endpoint);
+    }
+
+    PROFILE_COUNT("cells visited", orderedCnt + result.endpoints.size());
+    PROFILE_COUNT("edges traversed", edgeCnt);
+    return result;
+}
+
+PathAnalysis analyzeLongestPaths(const NetlistGraph& graph, ThreadPool& pool)
+{
+    if (pool.threadCnt() == 1) return analyzeLongestPaths(graph);
+    PROFILE_SCOPE("longest paths (parallel)");
+
+    static constexpr size_t GRAIN_SIZE = 1024;
+    const size_t cellCnt = graph.cellCnt();
+    const size_t workerCnt = pool.threadCnt();
+
+    PathAnalysis result;
+    result.depth.assign(cellCnt, 0);
+    result.predecessor.assign(cellCnt, Cell::INVALID_ID);
+
+    std::unique_ptr<std::atomic<uint32_t>[]> pendingInputs(new std::atomic<uint32_t>[cellCnt]);
+    std::vector<std::vector<cellId_t>> workerFrontiers(workerCnt);
+    std::vector<size_t> workerCombinationalCnts(workerCnt, 0);
+
+    pool.parallelFor(cellCnt, GRAIN_SIZE, [&](size_t begin, size_t end, size_t workerIdx) {
+        for (cellId_t cellId = begin; cellId < static_cast<cellId_t>(end); ++cellId)
+        {
+            uint32_t pending = 0;
+            if (! PathAnalysis::isBoundary(graph.types[cellId]))
+            {
+                ++workerCombinationalCnts[workerIdx];
+                for (cellId_t prevCell : graph.faninOf(cellId))
+                {
+                    if (! PathAnalysis::isBoundary(graph.types[prevCell])) ++pending;
+                }
+                if (pending == 0) workerFrontiers[workerIdx].push_back(cellId);
+            }
+            pendingInputs[cellId].store(pending, std::memory_order_relaxed);
+        }
+    });
+
+    size_t combinationalCnt = 0;
+    for (size_t cnt : workerCombinationalCnts) combinationalCnt += cnt;
+
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+    {
+        if (PathAnalysis::isEndpoint(graph.types[cellId])) result.endpoints.push_back(cellId);
+    }
+
+    // Every cell of a level has all of its combinational inputs in earlier levels and at least one in the
+    // previous level, so its depth is the level number. The predecessor choice only depends on the depths
+    // of the inputs, which makes the result independent of the scheduling.
+    auto relax = [&](cellId_t cellId) {
+        depth_t maxDepth = 0;
+        cellId_t longestPred = Cell::INVALID_ID;
+        for (cellId_t prevCell : graph.faninOf(cellId))
+        {
+            if (PathAnalysis::isBoundary(graph.types[prevCell]) || pendingInputs[prevCell].load(std::memory_order_relaxed) != 0) continue;
+            if (longestPred == Cell::INVALID_ID || result.depth[prevCell] > maxDepth)
+            {
+                maxDepth = result.depth[prevCell];
+                longestPred = prevCell;
+            }
+        }
+        result.predecessor[cellId] = longestPred;
+        return maxDepth;
+    };
+
+    std::vector<cellId_t> frontier;
+    size_t orderedCnt = 0;
+    for (depth_t level = 1; ; ++level)
+    {
+        frontier.clear();
+        for (auto& workerFrontier : workerFrontiers)
+        {
+            frontier.insert(frontier.end(), workerFrontier.begin(), workerFrontier.end());
+            workerFrontier.clear();
+        }
+        if (frontier.empty()) break;
+        orderedCnt += frontier.size();
+
+        pool.parallelFor(frontier.size(), GRAIN_SIZE, [&](size_t begin, size_t end, size_t) {
+            size_t edgeCnt = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                relax(frontier[i]);
+                result.depth[frontier[i]] = level;
+                edgeCnt += graph.faninOf(frontier[i]).size();
+            }
+            PROFILE_COUNT("edges traversed", edgeCnt);
+        });
+
+        pool.parallelFor(frontier.size(), GRAIN_SIZE, [&](size_t begin, size_t end, size_t workerIdx) {
+            size_t edgeCnt = 0;
+            for (size_t i = begin; i < end; ++i)
+            {
+                edgeCnt += graph.fanoutOf(frontier[i]).size();
+                for (cellId_t nextCell : graph.fanoutOf(frontier[i]))
+                {
+                    if (! PathAnalysis::isBoundary(graph.types[nextCell]) && pendingInputs[nextCell].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                        workerFrontiers[workerIdx].push_back(nextCell);
+                }
+            }
+            PROFILE_COUNT("edges traversed", edgeCnt);
+        });
+    }
+    result.onLoop.assign(cellCnt, false);
+    if (orderedCnt < combinationalCnt)
+    {
+        std::vector<cellId_t> unorderedCells;
+        for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+        {
+            if (pendingInputs[cellId].load(std::memory_order_relaxed) != 0) unorderedCells.push_back(cellId);
+        }
+        resolveLoops(graph, result, unorderedCells);
+        for (cellId_t cellId : unorderedCells) pendingInputs[cellId].store(0, std::memory_order_relaxed);
+        result.indexLoops(graph);
+    }
+
+    pool.parallelFor(result.endpoints.size(), GRAIN_SIZE, [&](size_t begin, size_t end, size_t) {
+        size_t edgeCnt = 0;
+        for (size_t i = begin; i < end; ++i)
+        {
+            result.depth[result.endpoints[i]] = relax(result.endpoints[i]);
+            edgeCnt += graph.faninOf(result.endpoints[i]).size();
+        }
+        PROFILE_COUNT("edges traversed", edgeCnt);
+    });
+
+    PROFILE_COUNT("cells visited", orderedCnt + result.endpoints.size());
+    return result;
+}
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "Cell.h"
+#include "NetlistGraph.h"
+#include "ThreadPool.h"
+
+typedef uint32_t depth_t;
+
+// Longest combinational paths ending in each cell. DFF, RAM and Carry cells delimit the combinational cones,
+// DFF and RAM cells are the endpoints whose paths get reported.
+struct PathAnalysis
+{
+    // Number of combinational cells on the longest path ending in (for endpoints: feeding) the cell
+    std::vector<depth_t> depth;
+    // Previous cell on that path, Cell::INVALID_ID where the path starts
+    std::vector<cellId_t> predecessor;
+    std::vector<cellId_t> endpoints;
+    // Combinational loops are condensed: all cells of a loop get the depth of the deepest path into the loop
+    // plus one, and the cell that path comes from as predecessor. Cells behind loops are analyzed normally.
+    size_t loopCellCnt = 0;
+    std::vector<bool> onLoop;
+    // Cells of every loop, each loop once, and the index of the loop of each cell. Both empty without loops.
+    std::vector<std::vector<cellId_t>> loops;
+    std::vector<uint32_t> loopOf;
+    static constexpr uint32_t NO_LOOP = UINT32_MAX;
+
+    static bool isBoundary(Cell::Type type)
+    {
+        return type == Cell::Type::DFF || type == Cell::Type::RAM || type == Cell::Type::Carry;
+    }
+
+    static bool isEndpoint(Cell::Type type)
+    {
+        return type == Cell::Type::DFF || type == Cell::Type::RAM;
+    }
+
+    // Cells of the longest path into the endpoint, starting with the endpoint itself
+    std::vector<cellId_t> pathTo(cellId_t endpoint) const;
+
+    // Endpoints ordered by decreasing depth, ties by cell id
+    std::vector<cellId_t> sortedEndpoints() const;
+    // The first k of sortedEndpoints() without sorting all of them
+    std::vector<cellId_t> topEndpoints(size_t k) const;
+
+    // Fills loops, loopOf and loopCellCnt from onLoop
+    void indexLoops(const NetlistGraph& graph);
+};
+
+struct RankedPath
+{
+    depth_t depth;
+    // Starting with the endpoint, like PathAnalysis::pathTo
+    std::vector<cellId_t> cells;
+};
+
+// The k longest distinct paths into the endpoint, longest first. The first one is pathTo(endpoint).
+// Best-first search backwards from the endpoint: the depth labels are exact bounds of how a partial path can
+// continue, so complete paths come out in order and only O(k * path length * fanin) entries are created.
+std::vector<RankedPath> worstPathsTo(const NetlistGraph& graph, const PathAnalysis& analysis, cellId_t endpoint, size_t k);
+
+// Completes a topological pass that got stuck: gives the unordered cells, the ones on or behind loops, their
+// depth in topological order of the condensation and marks the cells on loops. The depths of all other cells
+// have to be final.
+void resolveLoops(const NetlistGraph& graph, PathAnalysis& analysis, std::span<const cellId_t> unorderedCells);
+
+// Single topological pass over the combinational cells, O(cells + connections)
+PathAnalysis analyzeLongestPaths(const NetlistGraph& graph);
+
+// Level synchronous variant of the same pass: every level of the topological order is split across the
+// pool's workers. Gives exactly the same result as the single threaded pass.
+PathAnalysis analyzeLongestPaths(const NetlistGraph& graph, ThreadPool& pool);
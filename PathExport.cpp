@@ -0,0 +1,125 @@
+#include "PathExport.h"
+
+#include "Profiler.h"
+
+PathExportFormat exportFormatFor(const std::string& fileName)
+{
+    return fileName.ends_with(".csv") ? PathExportFormat::Csv : PathExportFormat::JsonLines;
+}
+
+static void writeJsonLine(ReportWriter& writer, size_t rank, const NetlistGraph& graph, const PathAnalysis& analysis,
+    const std::vector<cellId_t>& path, const TimingAnalysis* timing)
+{
+    const Cell& endpoint = *graph.cells[path.front()];
+    writer << "{\"rank\":" << rank << ",\"endpoint\":";
+    writer.jsonString(endpoint.name) << ",\"src\":";
+    writer.jsonString(endpoint.verilogSrc) << ",\"depth\":" << analysis.depth[endpoint.id];
+    if (timing)
+    {
+        writer << ",\"delay\":";
+        writer.fixed(timing->endpointArrival(endpoint.id), 3);
+    }
+
+    writer << ",\"path\":[";
+    for (size_t i = 0; i < path.size(); ++i)
+    {
+        const Cell& cell = *graph.cells[path[i]];
+        writer << (i == 0 ? "{\"cell\":" : ",{\"cell\":");
+        writer.jsonString(cell.name) << ",\"type\":";
+        writer.jsonString(cell.typeName) << ",\"src\":";
+        writer.jsonString(cell.verilogSrc);
+        if (timing)
+        {
+            writer << ",\"arrival\":";
+            writer.fixed(i == 0 ? timing->endpointArrival(cell.id) : timing->arrival(cell.id), 3);
+        }
+        writer << '}';
+    }
+    writer << "]}\n";
+}
+
+static void writeCsvRows(ReportWriter& writer, size_t rank, const NetlistGraph& graph, const PathAnalysis& analysis,
+    const std::vector<cellId_t>& path, const TimingAnalysis* timing)
+{
+    const Cell& endpoint = *graph.cells[path.front()];
+    for (size_t i = 0; i < path.size(); ++i)
+    {
+        const Cell& cell = *graph.cells[path[i]];
+        writer << rank << ',';
+        writer.csvField(endpoint.name) << ',' << analysis.depth[endpoint.id] << ',';
+        if (timing) writer.fixed(timing->endpointArrival(endpoint.id), 3) << ',';
+        writer << i << ',';
+        writer.csvField(cell.name) << ',';
+        writer.csvField(cell.typeName) << ',';
+        writer.csvField(cell.verilogSrc);
+        if (timing)
+        {
+            writer << ',';
+            writer.fixed(i == 0 ? timing->endpointArrival(cell.id) : timing->arrival(cell.id), 3);
+        }
+        writer << '\n';
+    }
+}
+
+void exportPaths(ReportWriter& writer, PathExportFormat format, const NetlistGraph& graph, const PathAnalysis& analysis,
+    const std::vector<cellId_t>& sortedEndpoints, const TimingAnalysis* timing /* = nullptr */)
+{
+    PROFILE_SCOPE("path export");
+    if (format == PathExportFormat::Csv)
+    {
+        writer << (timing ? "rank,endpoint,depth,delay_ns,step,cell,type,src,arrival_ns\n" : "rank,endpoint,depth,step,cell,type,src\n");
+    }
+
+    for (size_t i = 0; i < sortedEndpoints.size(); ++i)
+    {
+        std::vector<cellId_t> path = timing ? timing->pathTo(sortedEndpoints[i]) : analysis.pathTo(sortedEndpoints[i]);
+        if (format == PathExportFormat::Csv)
+            writeCsvRows(writer, i + 1, graph, analysis, path, timing);
+        else
+            writeJsonLine(writer, i + 1, graph, analysis, path, timing);
+    }
+    PROFILE_COUNT("exported paths", sortedEndpoints.size());
+}
+
+void exportHierarchicalPaths(ReportWriter& writer, PathExportFormat format, const std::vector<HierarchyAnalysis::EndpointResult>& endpoints)
+{
+    PROFILE_SCOPE("path export");
+    if (format == PathExportFormat::Csv)
+    {
+        writer << "rank,endpoint,depth,step,cell,type,src\n";
+    }
+
+    for (size_t i = 0; i < endpoints.size(); ++i)
+    {
+        const HierarchyAnalysis::EndpointResult& endpoint = endpoints[i];
+        if (format == PathExportFormat::Csv)
+        {
+            auto writeRow = [&](size_t step, std::string_view name, std::string_view typeName, std::string_view src) {
+                writer << (i + 1) << ',';
+                writer.csvField(endpoint.name) << ',' << endpoint.depth << ',' << step << ',';
+                writer.csvField(name) << ',';
+                writer.csvField(typeName) << ',';
+                writer.csvField(src) << '\n';
+            };
+            for (size_t step = 0; step < endpoint.path.size(); ++step)
+            {
+                writeRow(step, endpoint.path[step]->name, endpoint.path[step]->typeName, endpoint.path[step]->verilogSrc);
+            }
+            continue;
+        }
+
+        writer << "{\"rank\":" << (i + 1) << ",\"endpoint\":";
+        writer.jsonString(endpoint.name) << ",\"src\":";
+        writer.jsonString(endpoint.verilogSrc) << ",\"depth\":" << endpoint.depth << ",\"path\":[";
+        for (size_t step = 0; step < endpoint.path.size(); ++step)
+        {
+            const Cell& cell = *endpoint.path[step];
+            writer << (step == 0 ? "{\"cell\":" : ",{\"cell\":");
+            writer.jsonString(cell.name) << ",\"type\":";
+            writer.jsonString(cell.typeName) << ",\"src\":";
+            writer.jsonString(cell.verilogSrc) << '}';
+        }
+        writer << "]}\n";
+    }
+    PROFILE_COUNT("exported paths", endpoints.size());
+}
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "HierarchyAnalysis.h"
+#include "NetlistGraph.h"
+#include "PathAnalysis.h"
+#include "ReportWriter.h"
+#include "TimingAnalysis.h"
+
+enum class PathExportFormat
+{
+    JsonLines, Csv
+};
+
+// JSON Lines unless the file name ends in .csv
+PathExportFormat exportFormatFor(const std::string& fileName);
+
+// Writes the path of every endpoint in the given order, for other tools to ingest.
+// JSON Lines: one object per endpoint with its rank, name, src, depth, delay (with timing) and path cells.
+// CSV: a header and one row per path cell, the endpoint columns are repeated on each row of its path.
+// Paths start with the endpoint. Without timing the delay and arrival columns are left out.
+void exportPaths(ReportWriter& writer, PathExportFormat format, const NetlistGraph& graph, const PathAnalysis& analysis,
+    const std::vector<cellId_t>& sortedEndpoints, const TimingAnalysis* timing = nullptr);
+
+// The same for the endpoints of a hierarchical design, without timing. The paths of endpoints inside instances
+// start with the instance cell.
+void exportHierarchicalPaths(ReportWriter& writer, PathExportFormat format, const std::vector<HierarchyAnalysis::EndpointResult>& endpoints);
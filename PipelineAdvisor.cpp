@@ -0,0 +1,655 @@
+#include "PipelineAdvisor.h"
+
+#include <algorithm>
+#include <functional>
+#include <numeric>
+#include <span>
+
+#include "GraphTraversal.h"
+#include "Profiler.h"
+
+namespace
+{
+
+constexpr uint32_t NONE = UINT32_MAX;
+
+// Max flow by Dinic's algorithm. Edges are stored in pairs, edge ^ 1 is the residual reverse of edge.
+class FlowNetwork
+{
+public:
+    static constexpr int32_t INFINITE = 1 << 30;
+
+    void reset(uint32_t nodeCnt)
+    {
+        firstEdge.assign(nodeCnt, NONE);
+        edgeTo.clear();
+        edgeNext.clear();
+        capacities.clear();
+    }
+
+    uint32_t addNode()
+    {
+        firstEdge.push_back(NONE);
+        return static_cast<uint32_t>(firstEdge.size() - 1);
+    }
+
+    void addEdge(uint32_t from, uint32_t to, int32_t capacity)
+    {
+        pushEdge(from, to, capacity);
+        pushEdge(to, from, 0);
+    }
+
+    uint32_t nodeCnt() const { return static_cast<uint32_t>(firstEdge.size()); }
+
+    // The nodes of the edges added from the node
+    template <typename Func>
+    void forEachTarget(uint32_t node, Func func) const
+    {
+        for (uint32_t edge = firstEdge[node]; edge != NONE; edge = edgeNext[edge])
+        {
+            if ((edge & 1) == 0) func(edgeTo[edge]);
+        }
+    }
+
+    int64_t maxFlow(uint32_t source, uint32_t sink)
+    {
+        int64_t flow = 0;
+        while (buildLevels(source, sink))
+        {
+            currentEdge = firstEdge;
+            while (int32_t pathFlow = augment(source, sink)) flow += pathFlow;
+        }
+        return flow;
+    }
+
+    // After maxFlow: reachable from the source in the residual network, the source side of a minimum cut
+    bool isSourceSide(uint32_t node) const { return levels[node] >= 0; }
+
+private:
+    void pushEdge(uint32_t from, uint32_t to, int32_t capacity)
+    {
+        edgeTo.push_back(to);
+        edgeNext.push_back(firstEdge[from]);
+        capacities.push_back(capacity);
+        firstEdge[from] = static_cast<uint32_t>(edgeTo.size() - 1);
+    }
+
+    bool buildLevels(uint32_t source, uint32_t sink)
+    {
+        levels.assign(firstEdge.size(), -1);
+        queue.clear();
+        levels[source] = 0;
+        queue.push_back(source);
+        for (size_t idx = 0; idx < queue.size(); ++idx)
+        {
+            uint32_t node = queue[idx];
+            for (uint32_t edge = firstEdge[node]; edge != NONE; edge = edgeNext[edge])
+            {
+                if (capacities[edge] > 0 && levels[edgeTo[edge]] < 0)
+                {
+                    levels[edgeTo[edge]] = levels[node] + 1;
+                    queue.push_back(edgeTo[edge]);
+                }
+            }
+        }
+        return levels[sink] >= 0;
+    }
+
+    // One augmenting path of the level graph, iteratively. Dead ends are taken out of the level graph.
+    int32_t augment(uint32_t source, uint32_t sink)
+    {
+        pathEdges.clear();
+        uint32_t node = source;
+        while (true)
+        {
+            if (node == sink)
+            {
+                int32_t flow = INFINITE;
+                for (uint32_t edge : pathEdges) flow = std::min(flow, capacities[edge]);
+                for (uint32_t edge : pathEdges)
+                {
+                    capacities[edge] -= flow;
+                    capacities[edge ^ 1] += flow;
+                }
+                return flow;
+            }
+
+            uint32_t& edge = currentEdge[node];
+            while (edge != NONE && (capacities[edge] == 0 || levels[edgeTo[edge]] != levels[node] + 1)) edge = edgeNext[edge];
+            if (edge != NONE)
+            {
+                pathEdges.push_back(edge);
+                node = edgeTo[edge];
+                continue;
+            }
+
+            levels[node] = -1;
+            if (pathEdges.empty()) return 0;
+            node = edgeTo[pathEdges.back() ^ 1];
+            pathEdges.pop_back();
+            currentEdge[node] = edgeNext[currentEdge[node]];
+        }
+    }
+
+    std::vector<uint32_t> firstEdge;
+    std::vector<uint32_t> edgeTo;
+    std::vector<uint32_t> edgeNext;
+    std::vector<int32_t> capacities;
+
+    std::vector<int32_t> levels;
+    std::vector<uint32_t> currentEdge;
+    std::vector<uint32_t> queue;
+    std::vector<uint32_t> pathEdges;
+};
+
+// Shared by all cones, read only while they are solved
+struct ConeContext
+{
+    const NetlistGraph& graph;
+    const PathAnalysis& analysis;
+    depth_t targetDepth;
+    // Cone of the combinational cells in the fanin of the endpoints over the target and of these endpoints,
+    // NONE for all other cells
+    std::vector<uint32_t> coneOf;
+    // Position in the cells of the cone
+    std::vector<uint32_t> localIdx;
+    // Combinational cells on the longest path from the cell to an endpoint over the target, counting the cell
+    std::vector<depth_t> height;
+
+    std::span<const cellId_t> loopCellsOf(const cellId_t& cellId) const
+    {
+        return analysis.loopOf.empty() || analysis.loopOf[cellId] == PathAnalysis::NO_LOOP
+            ? std::span<const cellId_t>(&cellId, 1) : std::span<const cellId_t>(analysis.loops[analysis.loopOf[cellId]]);
+    }
+
+    bool isConeCell(cellId_t cellId, uint32_t coneIdx) const
+    {
+        return coneOf[cellId] == coneIdx && ! PathAnalysis::isBoundary(graph.types[cellId]);
+    }
+
+    bool isSameLoop(cellId_t a, cellId_t b) const
+    {
+        return ! analysis.loopOf.empty() && analysis.loopOf[a] != PathAnalysis::NO_LOOP && analysis.loopOf[a] == analysis.loopOf[b];
+    }
+};
+
+// A net between the cells in front of a cut and the cells behind it
+struct NetKey
+{
+    cellId_t driver;
+    portId_t net;
+};
+
+struct NetNode
+{
+    cellId_t driver;
+    portNameId_t driverPort;
+    portId_t net;
+    // SOURCE if the driver is in front of the cut anyway
+    uint32_t driverNode;
+    // NONE if all readers have to be behind the cut and the driver in front of it, the net is cut anyway then
+    uint32_t node;
+    uint32_t freeReaderCnt;
+    uint32_t sinkReaderCnt;
+};
+
+// Scratch space of one worker, reused for all cones it solves
+struct ConeScratch
+{
+    FlowNetwork network;
+    // By position in the cells of the cone
+    std::vector<uint8_t> behind;
+    std::vector<uint8_t> ready;
+    std::vector<depth_t> depths;
+    std::vector<uint32_t> nodeOf;
+    // Cells behind the last level without inputs behind it, the band is reached from them
+    std::vector<uint32_t> frontier;
+    std::vector<uint8_t> inFrontier;
+    // Cells behind the last level up to the target depth since it, in the order of the analysis depth
+    std::vector<uint32_t> band;
+    std::vector<uint32_t> queue;
+    VisitMarks queued;
+    VisitMarks done;
+    VisitMarks inBand;
+
+    std::vector<NetNode> netNodes;
+    // Nets of the driver at hand, index into netNodes
+    std::vector<std::pair<portId_t, uint32_t>> driverNets;
+    std::vector<NetKey> starts;
+    std::vector<NetKey> nextStarts;
+
+    // By position in the cells of the cone, the register levels in front of the cell
+    std::vector<uint32_t> levels;
+    VisitMarks reached;
+    std::vector<cellId_t> affectedQueue;
+    std::vector<cellId_t> affectedRoots;
+};
+
+constexpr uint32_t SOURCE = 0;
+constexpr uint32_t SINK = 1;
+
+// Depths counted from the last register level, for the cells still behind it
+void computeDepths(const ConeContext& context, uint32_t coneIdx, std::span<const cellId_t> cells, ConeScratch& scratch)
+{
+    std::fill(scratch.ready.begin(), scratch.ready.end(), 0);
+    for (size_t idx = 0; idx < cells.size(); ++idx)
+    {
+        if (! scratch.behind[idx] || scratch.ready[idx]) continue;
+
+        // The cells are in the order of the analysis depth, a loop is computed as one when its first cell comes
+        std::span<const cellId_t> loopCells = context.loopCellsOf(cells[idx]);
+        depth_t maxInput = 0;
+        for (cellId_t loopCell : loopCells)
+        {
+            for (cellId_t prevCell : context.graph.faninOf(loopCell))
+            {
+                if (! context.isConeCell(prevCell, coneIdx)) continue;
+                uint32_t prevIdx = context.localIdx[prevCell];
+                if (scratch.behind[prevIdx] && scratch.ready[prevIdx]) maxInput = std::max(maxInput, scratch.depths[prevIdx]);
+            }
+        }
+        for (cellId_t loopCell : loopCells)
+        {
+            uint32_t loopIdx = context.localIdx[loopCell];
+            scratch.depths[loopIdx] = maxInput + 1;
+            scratch.ready[loopIdx] = 1;
+        }
+    }
+}
+
+// Collects the band forward from the frontier: a cell deeper than the target since the last level only has to be
+// looked at if one of its inputs is in the band, the ones behind it are deeper as well. Returns false if one of
+// them has more logic up to the endpoints than maxHeight, that cell would have to be in front of the level too.
+bool collectBand(const ConeContext& context, uint32_t coneIdx, std::span<const cellId_t> cells, size_t maxHeight, ConeScratch& scratch)
+{
+    const NetlistGraph& graph = context.graph;
+    scratch.band.clear();
+    scratch.queue.clear();
+    scratch.queued.clear();
+    scratch.done.clear();
+    scratch.inBand.clear();
+
+    // Smallest position first, the inputs of a cell come before it
+    auto push = [&](uint32_t idx) {
+        if (! scratch.queued.visit(idx)) return;
+        scratch.queue.push_back(idx);
+        std::push_heap(scratch.queue.begin(), scratch.queue.end(), std::greater<uint32_t>());
+    };
+    std::erase_if(scratch.frontier, [&](uint32_t idx) { return ! scratch.behind[idx]; });
+    for (uint32_t idx : scratch.frontier) push(idx);
+
+    while (! scratch.queue.empty())
+    {
+        std::pop_heap(scratch.queue.begin(), scratch.queue.end(), std::greater<uint32_t>());
+        uint32_t idx = scratch.queue.back();
+        scratch.queue.pop_back();
+        if (scratch.done.isVisited(idx)) continue;
+
+        std::span<const cellId_t> loopCells = context.loopCellsOf(cells[idx]);
+        depth_t maxInput = 0;
+        bool deeper = false;
+        for (cellId_t loopCell : loopCells)
+        {
+            scratch.done.visit(context.localIdx[loopCell]);
+            for (cellId_t prevCell : graph.faninOf(loopCell))
+            {
+                if (! context.isConeCell(prevCell, coneIdx) || context.isSameLoop(prevCell, loopCell)) continue;
+                uint32_t prevIdx = context.localIdx[prevCell];
+                if (! scratch.behind[prevIdx]) continue;
+                if (scratch.inBand.isVisited(prevIdx)) maxInput = std::max(maxInput, scratch.depths[prevIdx]);
+                else deeper = true;
+            }
+        }
+        if (deeper || maxInput + 1 > context.targetDepth)
+        {
+            if (context.height[cells[idx]] > maxHeight) return false;
+            continue;
+        }
+
+        for (cellId_t loopCell : loopCells)
+        {
+            uint32_t loopIdx = context.localIdx[loopCell];
+            scratch.depths[loopIdx] = maxInput + 1;
+            scratch.inBand.visit(loopIdx);
+            scratch.band.push_back(loopIdx);
+        }
+        for (cellId_t loopCell : loopCells)
+        {
+            for (cellId_t nextCell : graph.fanoutOf(loopCell))
+            {
+                if (context.isConeCell(nextCell, coneIdx) && scratch.behind[context.localIdx[nextCell]]) push(context.localIdx[nextCell]);
+            }
+        }
+    }
+    PROFILE_COUNT("pipeline band cells", scratch.band.size());
+    return true;
+}
+
+// Places stageCnt register levels one after the other. Returns false if a cell has to be in front of and
+// behind a level at the same time, more levels are needed then.
+bool solveCone(const ConeContext& context, uint32_t coneIdx, std::span<const cellId_t> cells, uint32_t stageCnt,
+    ConeScratch& scratch, PipelineCone& cone)
+{
+    const NetlistGraph& graph = context.graph;
+    const depth_t target = context.targetDepth;
+    cone.cuts.clear();
+    cone.stageCnt = stageCnt;
+    cone.depthAfter = 0;
+
+    scratch.behind.assign(cells.size(), 1);
+    scratch.levels.assign(cells.size(), stageCnt);
+    scratch.ready.resize(cells.size());
+    scratch.depths.resize(cells.size());
+    scratch.nodeOf.resize(cells.size());
+
+    // Every level only looks at the band of cells up to the target depth behind the previous one
+    scratch.frontier.clear();
+    scratch.inFrontier.assign(cells.size(), 0);
+    auto updateFrontier = [&](uint32_t idx) {
+        if (scratch.inFrontier[idx] || ! scratch.behind[idx]) return;
+        for (cellId_t prevCell : graph.faninOf(cells[idx]))
+        {
+            if (context.isConeCell(prevCell, coneIdx) && ! context.isSameLoop(prevCell, cells[idx]) && scratch.behind[context.localIdx[prevCell]]) return;
+        }
+        scratch.inFrontier[idx] = 1;
+        scratch.frontier.push_back(idx);
+    };
+    for (size_t idx = 0; idx < cells.size(); ++idx) updateFrontier(static_cast<uint32_t>(idx));
+
+    // The first level starts at the existing registers and carry cells in front of the cone
+    scratch.starts.clear();
+    auto addStarts = [&](cellId_t cellId) {
+        for (cellId_t prevCell : graph.faninOf(cellId))
+        {
+            if (PathAnalysis::isBoundary(graph.types[prevCell])) scratch.starts.push_back({ prevCell, Port::INVALID_ID });
+        }
+    };
+    for (cellId_t cellId : cells) addStarts(cellId);
+    for (cellId_t endpoint : cone.endpoints) addStarts(endpoint);
+    std::sort(scratch.starts.begin(), scratch.starts.end(), [](const NetKey& a, const NetKey& b) { return a.driver < b.driver; });
+    scratch.starts.erase(std::unique(scratch.starts.begin(), scratch.starts.end(), [](const NetKey& a, const NetKey& b) { return a.driver == b.driver; }),
+        scratch.starts.end());
+
+    for (uint32_t stage = 1; stage <= stageCnt; ++stage)
+    {
+        // Cells deeper than the target have to be behind the level, cells with more logic up to the endpoints
+        // than the remaining levels allow in front of it. Only the cells in between are nodes of the network.
+        const size_t maxHeight = static_cast<size_t>(stageCnt - stage + 1) * target;
+        if (! collectBand(context, coneIdx, cells, maxHeight, scratch)) return false;
+        scratch.network.reset(2);
+        for (uint32_t idx : scratch.band)
+            scratch.nodeOf[idx] = context.height[cells[idx]] > maxHeight ? NONE : scratch.network.addNode();
+
+        auto targetNode = [&](cellId_t cellId) -> uint32_t {
+            if (context.coneOf[cellId] != coneIdx) return NONE;
+            if (PathAnalysis::isEndpoint(graph.types[cellId])) return SINK;
+            uint32_t idx = context.localIdx[cellId];
+            if (! scratch.behind[idx]) return NONE;
+            return scratch.inBand.isVisited(idx) ? scratch.nodeOf[idx] : SINK;
+        };
+
+        // Every net into the cells behind the previous level costs one register if it is cut
+        scratch.netNodes.clear();
+        auto addNets = [&](cellId_t driver, uint32_t driverNode, portId_t onlyNet) {
+            const uint32_t edgeBegin = graph.fanoutOffsets[driver], edgeEnd = graph.fanoutOffsets[driver + 1];
+            auto netNodeOf = [&](portId_t net) {
+                return std::find_if(scratch.driverNets.begin(), scratch.driverNets.end(), [&](const auto& driverNet) { return driverNet.first == net; });
+            };
+            scratch.driverNets.clear();
+            for (uint32_t edgeIdx = edgeBegin; edgeIdx < edgeEnd; ++edgeIdx)
+            {
+                portId_t net = graph.fanoutNet[edgeIdx];
+                if (onlyNet != Port::INVALID_ID && net != onlyNet) continue;
+                uint32_t toNode = targetNode(graph.fanout[edgeIdx]);
+                if (toNode == NONE) continue;
+
+                auto netIt = netNodeOf(net);
+                if (netIt == scratch.driverNets.end())
+                {
+                    scratch.netNodes.push_back({ driver, graph.fanoutSrcPort[edgeIdx], net, driverNode, NONE, 0, 0 });
+                    scratch.driverNets.emplace_back(net, static_cast<uint32_t>(scratch.netNodes.size() - 1));
+                    netIt = scratch.driverNets.end() - 1;
+                }
+                NetNode& netNode = scratch.netNodes[netIt->second];
+                ++(toNode == SINK ? netNode.sinkReaderCnt : netNode.freeReaderCnt);
+            }
+
+            bool hasFreeReaders = false;
+            for (const auto& driverNet : scratch.driverNets)
+            {
+                NetNode& netNode = scratch.netNodes[driverNet.second];
+                if (driverNode == SOURCE && netNode.freeReaderCnt == 0) continue;
+                netNode.node = scratch.network.addNode();
+                scratch.network.addEdge(driverNode, netNode.node, 1);
+                if (netNode.sinkReaderCnt > 0) scratch.network.addEdge(netNode.node, SINK, FlowNetwork::INFINITE);
+                hasFreeReaders = hasFreeReaders || netNode.freeReaderCnt > 0;
+            }
+            if (! hasFreeReaders) return;
+
+            for (uint32_t edgeIdx = edgeBegin; edgeIdx < edgeEnd; ++edgeIdx)
+            {
+                portId_t net = graph.fanoutNet[edgeIdx];
+                if (onlyNet != Port::INVALID_ID && net != onlyNet) continue;
+                uint32_t toNode = targetNode(graph.fanout[edgeIdx]);
+                if (toNode == NONE || toNode == SINK) continue;
+                scratch.network.addEdge(scratch.netNodes[netNodeOf(net)->second].node, toNode, FlowNetwork::INFINITE);
+                // No path may cross the level backwards
+                if (driverNode != SOURCE) scratch.network.addEdge(toNode, driverNode, FlowNetwork::INFINITE);
+            }
+        };
+        for (const NetKey& start : scratch.starts) addNets(start.driver, SOURCE, start.net);
+        for (uint32_t idx : scratch.band) addNets(cells[idx], scratch.nodeOf[idx] == NONE ? SOURCE : scratch.nodeOf[idx], Port::INVALID_ID);
+
+        scratch.network.maxFlow(SOURCE, SINK);
+        PROFILE_COUNT("pipeline flow nodes", scratch.network.nodeCnt());
+
+        scratch.nextStarts.clear();
+        for (const NetNode& netNode : scratch.netNodes)
+        {
+            uint32_t readerCnt = netNode.sinkReaderCnt;
+            if (netNode.node != NONE)
+            {
+                if (! scratch.network.isSourceSide(netNode.driverNode) || scratch.network.isSourceSide(netNode.node)) continue;
+                scratch.network.forEachTarget(netNode.node, [&](uint32_t toNode) { readerCnt += toNode == SINK || scratch.network.isSourceSide(toNode) ? 0 : 1; });
+            }
+            cone.cuts.push_back({ netNode.driver, netNode.driverPort, netNode.net, stage, readerCnt });
+            scratch.nextStarts.push_back({ netNode.driver, netNode.net });
+        }
+        std::swap(scratch.starts, scratch.nextStarts);
+
+        for (uint32_t idx : scratch.band)
+        {
+            if (scratch.nodeOf[idx] != NONE && ! scratch.network.isSourceSide(scratch.nodeOf[idx])) continue;
+            scratch.behind[idx] = 0;
+            scratch.levels[idx] = stage - 1;
+            cone.depthAfter = std::max(cone.depthAfter, scratch.depths[idx]);
+        }
+        for (uint32_t idx : scratch.band)
+        {
+            if (scratch.behind[idx]) continue;
+            for (cellId_t nextCell : graph.fanoutOf(cells[idx]))
+            {
+                if (context.isConeCell(nextCell, coneIdx)) updateFrontier(context.localIdx[nextCell]);
+            }
+        }
+    }
+
+    computeDepths(context, coneIdx, cells, scratch);
+    for (size_t idx = 0; idx < cells.size(); ++idx)
+    {
+        if (scratch.behind[idx]) cone.depthAfter = std::max(cone.depthAfter, scratch.depths[idx]);
+    }
+    return true;
+}
+
+// The endpoints reached from the cells behind a level without passing through the cone. The cone's own endpoints
+// read the cone cells over cut nets only, those paths are balanced.
+void collectAffectedEndpoints(const ConeContext& context, uint32_t coneIdx, std::span<const cellId_t> cells, ConeScratch& scratch, PipelineCone& cone)
+{
+    const NetlistGraph& graph = context.graph;
+    scratch.affectedRoots.clear();
+    for (size_t idx = 0; idx < cells.size(); ++idx)
+    {
+        if (scratch.levels[idx] == 0) continue;
+        for (cellId_t nextCell : graph.fanoutOf(cells[idx]))
+        {
+            if (context.coneOf[nextCell] != coneIdx) scratch.affectedRoots.push_back(nextCell);
+        }
+    }
+
+    cone.affectedEndpoints.clear();
+    breadthFirst<cellId_t>(scratch.reached, scratch.affectedQueue, scratch.affectedRoots, [&](cellId_t cellId) { return graph.fanoutOf(cellId); },
+        [&](cellId_t cellId, size_t) {
+            if (PathAnalysis::isEndpoint(graph.types[cellId]))
+            {
+                cone.affectedEndpoints.push_back(cellId);
+                return false;
+            }
+            return ! context.isConeCell(cellId, coneIdx);
+        });
+    std::sort(cone.affectedEndpoints.begin(), cone.affectedEndpoints.end());
+}
+
+}
+
+size_t PipelineAdvice::registerCnt() const
+{
+    size_t cnt = 0;
+    for (const PipelineCone& cone : cones) cnt += cone.cuts.size();
+    return cnt;
+}
+
+PipelineAdvice advisePipelining(const NetlistGraph& graph, const PathAnalysis& analysis, depth_t targetDepth, ThreadPool& pool)
+{
+    PROFILE_SCOPE("pipeline advisor");
+    const size_t cellCnt = graph.cellCnt();
+    PipelineAdvice advice;
+    advice.targetDepth = targetDepth;
+    if (targetDepth == 0) return advice;
+
+    std::vector<cellId_t> violating;
+    for (cellId_t endpoint : analysis.endpoints)
+    {
+        if (analysis.depth[endpoint] > targetDepth) violating.push_back(endpoint);
+    }
+    if (violating.empty()) return advice;
+
+    // Fanin cones of the endpoints over the target, up to the registers and carry cells in front of them
+    VisitMarks marks(cellCnt);
+    std::vector<cellId_t> reached;
+    breadthFirst<cellId_t>(marks, reached, violating, [&](cellId_t cellId) { return graph.faninOf(cellId); },
+        [&](cellId_t cellId, size_t level) { return level == 0 || ! PathAnalysis::isBoundary(graph.types[cellId]); });
+
+    // Cones sharing combinational cells are one, found by union find over their connections
+    std::vector<cellId_t> parents(cellCnt);
+    auto findRoot = [&](cellId_t cellId) {
+        while (parents[cellId] != cellId)
+        {
+            parents[cellId] = parents[parents[cellId]];
+            cellId = parents[cellId];
+        }
+        return cellId;
+    };
+    std::vector<cellId_t> coneCells;
+    for (cellId_t cellId : reached)
+    {
+        if (! PathAnalysis::isBoundary(graph.types[cellId])) coneCells.push_back(cellId);
+    }
+    for (cellId_t cellId : coneCells) parents[cellId] = cellId;
+    for (cellId_t endpoint : violating) parents[endpoint] = endpoint;
+    auto unite = [&](cellId_t cellId) {
+        for (cellId_t prevCell : graph.faninOf(cellId))
+        {
+            if (PathAnalysis::isBoundary(graph.types[prevCell])) continue;
+            cellId_t a = findRoot(cellId), b = findRoot(prevCell);
+            if (a != b) parents[std::max(a, b)] = std::min(a, b);
+        }
+    };
+    for (cellId_t cellId : coneCells) unite(cellId);
+    for (cellId_t endpoint : violating) unite(endpoint);
+
+    ConeContext context { graph, analysis, targetDepth, std::vector<uint32_t>(cellCnt, NONE), std::vector<uint32_t>(cellCnt, NONE), std::vector<depth_t>(cellCnt, 0) };
+    std::vector<uint32_t> coneOfRoot(cellCnt, NONE);
+    for (cellId_t endpoint : violating)
+    {
+        cellId_t root = findRoot(endpoint);
+        if (coneOfRoot[root] == NONE)
+        {
+            coneOfRoot[root] = static_cast<uint32_t>(advice.cones.size());
+            advice.cones.emplace_back();
+        }
+        PipelineCone& cone = advice.cones[coneOfRoot[root]];
+        context.coneOf[endpoint] = coneOfRoot[root];
+        cone.endpoints.push_back(endpoint);
+        cone.depthBefore = std::max(cone.depthBefore, analysis.depth[endpoint]);
+    }
+
+    // Cells of every cone in the order of their depth, counting sort
+    depth_t maxDepth = 0;
+    for (cellId_t cellId : coneCells) maxDepth = std::max(maxDepth, analysis.depth[cellId]);
+    std::vector<uint32_t> depthOffsets(static_cast<size_t>(maxDepth) + 2, 0);
+    for (cellId_t cellId : coneCells) ++depthOffsets[analysis.depth[cellId] + 1];
+    std::partial_sum(depthOffsets.begin(), depthOffsets.end(), depthOffsets.begin());
+    std::vector<cellId_t> order(coneCells.size());
+    for (cellId_t cellId : coneCells) order[depthOffsets[analysis.depth[cellId]]++] = cellId;
+
+    const size_t coneCnt = advice.cones.size();
+    std::vector<std::vector<cellId_t>> cellsOfCone(coneCnt);
+    for (cellId_t cellId : order)
+    {
+        uint32_t coneIdx = coneOfRoot[findRoot(cellId)];
+        context.coneOf[cellId] = coneIdx;
+        context.localIdx[cellId] = static_cast<uint32_t>(cellsOfCone[coneIdx].size());
+        cellsOfCone[coneIdx].push_back(cellId);
+    }
+
+    // Heights in reverse order, loops as one
+    std::vector<uint8_t> heightReady(cellCnt, 0);
+    for (auto it = order.rbegin(); it != order.rend(); ++it)
+    {
+        if (heightReady[*it]) continue;
+        std::span<const cellId_t> loopCells = context.loopCellsOf(*it);
+        depth_t maxOutput = 0;
+        for (cellId_t loopCell : loopCells)
+        {
+            for (cellId_t nextCell : graph.fanoutOf(loopCell))
+            {
+                if (context.coneOf[nextCell] == NONE || (! heightReady[nextCell] && ! PathAnalysis::isEndpoint(graph.types[nextCell]))) continue;
+                maxOutput = std::max(maxOutput, PathAnalysis::isEndpoint(graph.types[nextCell]) ? depth_t(0) : context.height[nextCell]);
+            }
+        }
+        for (cellId_t loopCell : loopCells)
+        {
+            context.height[loopCell] = maxOutput + 1;
+            heightReady[loopCell] = 1;
+        }
+    }
+
+    std::vector<ConeScratch> scratches(pool.threadCnt());
+    pool.parallelFor(coneCnt, std::max<size_t>(1, coneCnt / (pool.threadCnt() * 16)), [&](size_t begin, size_t end, size_t workerIdx) {
+        for (size_t coneIdx = begin; coneIdx < end; ++coneIdx)
+        {
+            PipelineCone& cone = advice.cones[coneIdx];
+            std::span<const cellId_t> cells = cellsOfCone[coneIdx];
+            cone.cellCnt = cells.size();
+            std::stable_sort(cone.endpoints.begin(), cone.endpoints.end(), [&](cellId_t a, cellId_t b) { return analysis.depth[a] > analysis.depth[b]; });
+
+            // The fewest levels that could do it, more if a cell cannot be placed
+            uint32_t stageCnt = (cone.depthBefore + targetDepth - 1) / targetDepth - 1;
+            while (! solveCone(context, static_cast<uint32_t>(coneIdx), cells, stageCnt, scratches[workerIdx], cone))
+            {
+                if (++stageCnt >= cone.depthBefore)
+                {
+                    cone.cuts.clear();
+                    cone.stageCnt = 0;
+                    cone.depthAfter = cone.depthBefore;
+                    break;
+                }
+            }
+            if (cone.stageCnt > 0) collectAffectedEndpoints(context, static_cast<uint32_t>(coneIdx), cells, scratches[workerIdx], cone);
+        }
+    });
+
+    std::stable_sort(advice.cones.begin(), advice.cones.end(), [](const PipelineCone& a, const PipelineCone& b) { return a.depthBefore > b.depthBefore; });
+    return advice;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "NetlistGraph.h"
+#include "PathAnalysis.h"
+#include "ThreadPool.h"
+
+// A pipeline register to insert on a net, read by the cone cells behind it instead of the net
+struct PipelineCut
+{
+    cellId_t driver;
+    portNameId_t driverPort;
+    portId_t net;
+    // 1 for the register level next to the existing registers in front of the cone
+    uint32_t stage;
+    // Input ports of the cone behind the cut reading the net
+    uint32_t readerCnt;
+};
+
+// Endpoints over the target depth whose fanin cones share combinational cells
+struct PipelineCone
+{
+    // Deepest first
+    std::vector<cellId_t> endpoints;
+    // Combinational cells of the cone
+    size_t cellCnt = 0;
+    depth_t depthBefore = 0;
+    // Longest path between two registers once the cuts are registered, depthBefore if no cuts were found
+    depth_t depthAfter = 0;
+    // Register levels added to every path of the cone
+    uint32_t stageCnt = 0;
+    // By stage
+    std::vector<PipelineCut> cuts;
+    // Endpoints fed by cells behind a register level through logic outside the cone. Their paths gain the latency
+    // of those cells and are not balanced by the cuts.
+    std::vector<cellId_t> affectedEndpoints;
+};
+
+struct PipelineAdvice
+{
+    depth_t targetDepth = 0;
+    // Deepest first
+    std::vector<PipelineCone> cones;
+
+    size_t registerCnt() const;
+};
+
+// Pipeline registers that bring every path into the endpoints deeper than targetDepth down to it. Each cone gets
+// the fewest register levels that can do that, and each level is a minimum cut of the nets between the cells
+// before and after it: every path of the cone crosses it exactly once, so the latencies of its paths stay
+// balanced (the endpoints outside the cone that read cells behind a level are listed as affected), a cell
+// deeper than the target since the previous level has to be behind it and one with more levels of logic up to
+// its endpoint than the remaining levels allow has to be in front of it. The cut is found with Dinic's max flow
+// over the cells in between only, the cones are solved concurrently on the pool. Uses the depth labels of the
+// analysis, combinational loops stay on one side of every cut.
+PipelineAdvice advisePipelining(const NetlistGraph& graph, const PathAnalysis& analysis, depth_t targetDepth, ThreadPool& pool);
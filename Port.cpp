@@ -1,5 +1,6 @@
 #include "Port.h"
 
+#include <iostream>
 #include <sstream>
 
 #include "Cell.h"
@@ -7,12 +8,29 @@
 
 #define PRINT_PORT_DESTINATION_CELLS 1
 
-Port::Port(std::string name, Cell& cell, Link& link, Type type)
+Port::Port(std::string_view name, Cell& cell, Type type, std::pmr::memory_resource* resource)
     : name(name)
     , cell(cell)
     , type(type)
+    , links(resource)
 {}
 
+void Link::attach(Port& port)
+{
+    if (port.type == Port::Type::INPUT)
+    {
+        outputs.push_back(port);
+    }
+    else if (input == nullptr)
+    {
+        input = &port;
+    }
+    else
+    {
+        std::cerr << "WARNING: link#" << id << " already has a connected input port: " << input->name << ", cannot add port " << port.name << " as input" << std::endl;
+    }
+}
+
 std::ostream& operator<<(std::ostream& os, const Port& port)
 {
     std::string linksStr;
@@ -1,8 +1,9 @@
 #pragma once
 
-#include <string>
+#include <string_view>
 #include <list>
 #include <functional>
+#include <memory_resource>
 
 struct Cell;
 
@@ -16,13 +17,14 @@ struct Port
 
     enum class Type { INPUT, OUTPUT };
 
-    std::string name;
+    // Interned by the netlist
+    std::string_view name;
     Cell& cell;
     Type type;
-    std::list<std::reference_wrapper<Link>> links;
+    std::pmr::list<std::reference_wrapper<Link>> links;
 
     Port() = delete;
-    Port(std::string name, Cell& cell, Link& link, Type type);
+    Port(std::string_view name, Cell& cell, Type type, std::pmr::memory_resource* resource);
 };
 
 std::ostream& operator<<(std::ostream& os, const Port& port);
@@ -31,8 +33,11 @@ struct Link
 {
     portId_t id;
     Port* input;
-    std::list<std::reference_wrapper<Port>> outputs;
+    std::pmr::list<std::reference_wrapper<Port>> outputs;
+
+    // The link side of Cell::assignPort: an input port reads the link, an output port drives it
+    void attach(Port& port);
 
     Link() = delete;
-    Link(portId_t id) : id(id), input(nullptr) {}
+    Link(portId_t id, std::pmr::memory_resource* resource = std::pmr::get_default_resource()) : id(id), input(nullptr), outputs(resource) {}
 };
@@ -0,0 +1,206 @@
+#include "Profiler.h"
+
+#include <chrono>
+#include <algorithm>
+#include <deque>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+#include <nlohmann/json.hpp>
+
+namespace
+{
+    struct Event
+    {
+        const char* name;
+        uint32_t threadIdx;
+        uint32_t nesting;
+        int64_t startUs;
+        int64_t durationUs;
+        size_t allocations;
+    };
+
+    struct Recording
+    {
+        std::mutex mutex;
+        std::vector<Event> events;
+        // deque keeps the counters in place while new ones are added
+        std::deque<Profiler::Counter> counters;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    };
+
+    Recording& recording()
+    {
+        static Recording instance;
+        return instance;
+    }
+
+    int64_t nowUs()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - recording().start).count();
+    }
+
+    uint32_t threadIdx()
+    {
+        static std::atomic<uint32_t> nextIdx { 0 };
+        thread_local uint32_t idx = nextIdx.fetch_add(1);
+        return idx;
+    }
+
+    thread_local uint32_t nesting = 0;
+}
+
+Profiler::Counter& Profiler::counter(const char* name)
+{
+    Recording& rec = recording();
+    std::lock_guard<std::mutex> lock(rec.mutex);
+    for (Counter& existing : rec.counters)
+    {
+        if (std::string_view(existing.name) == name) return existing;
+    }
+    return rec.counters.emplace_back(name);
+}
+
+Profiler::Scope::Scope(const char* name)
+    : name(name)
+    , active(isEnabled())
+{
+    if (! active) return;
+    ++nesting;
+    allocationsBefore = SysUtils::allocationCnt();
+    startUs = nowUs();
+}
+
+Profiler::Scope::~Scope()
+{
+    if (! active) return;
+    int64_t endUs = nowUs();
+    --nesting;
+
+    Recording& rec = recording();
+    Event event { name, threadIdx(), nesting, startUs, endUs - startUs, SysUtils::allocationCnt() - allocationsBefore };
+    std::lock_guard<std::mutex> lock(rec.mutex);
+    rec.events.push_back(event);
+}
+
+Profiler::Session::Session(bool enable, std::string traceFileName, std::ostream& os)
+    : active(enable)
+    , traceFileName(std::move(traceFileName))
+    , os(os)
+{
+    if (! active) return;
+#ifndef FPGA_JSON_PROFILING
+    os << "WARNING: built without FPGA_JSON_PROFILING, the profile will be empty\n";
+#endif
+    recording().start = std::chrono::steady_clock::now();
+    enabled = true;
+}
+
+Profiler::Session::~Session()
+{
+    if (! active) return;
+    enabled = false;
+
+    printSummary(os);
+    if (! traceFileName.empty())
+    {
+        try
+        {
+            writeChromeTrace(traceFileName);
+            os << "Trace written to " << traceFileName << '\n';
+        }
+        catch (std::exception& ex)
+        {
+            std::cerr << "WARNING: " << ex.what() << std::endl;
+        }
+    }
+}
+
+void Profiler::printSummary(std::ostream& os)
+{
+    struct Row
+    {
+        std::string_view name;
+        uint32_t nesting;
+        int64_t firstStartUs;
+        size_t calls = 0;
+        int64_t totalUs = 0;
+        int64_t maxUs = 0;
+        size_t allocations = 0;
+    };
+
+    Recording& rec = recording();
+    std::lock_guard<std::mutex> lock(rec.mutex);
+
+    // scopes of the same name are merged, rows are listed in the order they were first entered
+    std::map<std::string_view, Row> rowsByName;
+    for (const Event& event : rec.events)
+    {
+        Row& row = rowsByName.try_emplace(event.name, Row { event.name, event.nesting, event.startUs }).first->second;
+        row.nesting = std::min(row.nesting, event.nesting);
+        row.firstStartUs = std::min(row.firstStartUs, event.startUs);
+        ++row.calls;
+        row.totalUs += event.durationUs;
+        row.maxUs = std::max(row.maxUs, event.durationUs);
+        row.allocations += event.allocations;
+    }
+    std::vector<Row> rows;
+    for (const auto& rowPair : rowsByName) rows.push_back(rowPair.second);
+    std::sort(rows.begin(), rows.end(), [](const Row& a, const Row& b) { return a.firstStartUs < b.firstStartUs; });
+
+    std::ios_base::fmtflags flags = os.flags();
+    std::streamsize precision = os.precision();
+
+    os << "\nProfile:\n\n"
+        << std::left << std::setw(36) << "  Phase" << std::right << std::setw(8) << "Calls" << std::setw(14) << "Total ms" << std::setw(12) << "Max ms" << std::setw(14) << "Allocations" << '\n'
+        << "  " << std::string(82, '-') << '\n';
+    os << std::fixed << std::setprecision(2);
+    for (const Row& row : rows)
+    {
+        std::string label = std::string(2 + 2 * row.nesting, ' ') + std::string(row.name);
+        os << std::left << std::setw(36) << label << std::right << std::setw(8) << row.calls << std::setw(14) << row.totalUs / 1000.0
+            << std::setw(12) << row.maxUs / 1000.0 << std::setw(14) << row.allocations << '\n';
+    }
+
+    if (! rec.counters.empty())
+    {
+        os << "\n" << std::left << std::setw(36) << "  Counter" << std::right << std::setw(20) << "Value" << '\n'
+            << "  " << std::string(54, '-') << '\n';
+        for (const Counter& counter : rec.counters)
+        {
+            os << std::left << std::setw(36) << ("  " + std::string(counter.name)) << std::right << std::setw(20) << counter.value.load() << '\n';
+        }
+    }
+
+    os.flags(flags);
+    os.precision(precision);
+}
+
+void Profiler::writeChromeTrace(const std::string& fileName)
+{
+    Recording& rec = recording();
+    std::lock_guard<std::mutex> lock(rec.mutex);
+
+    nlohmann::json events = nlohmann::json::array();
+    int64_t endUs = 0;
+    for (const Event& event : rec.events)
+    {
+        events.push_back({ { "name", event.name }, { "ph", "X" }, { "pid", 1 }, { "tid", event.threadIdx },
+            { "ts", event.startUs }, { "dur", event.durationUs }, { "args", { { "allocations", event.allocations } } } });
+        endUs = std::max(endUs, event.startUs + event.durationUs);
+    }
+    for (const Counter& counter : rec.counters)
+    {
+        events.push_back({ { "name", counter.name }, { "ph", "C" }, { "pid", 1 }, { "tid", 0 }, { "ts", endUs },
+            { "args", { { "value", counter.value.load() } } } });
+    }
+
+    std::ofstream os(fileName);
+    if (! os) throw std::runtime_error("Cannot write trace file " + fileName);
+    os << nlohmann::json { { "traceEvents", std::move(events) }, { "displayTimeUnit", "ms" } }.dump() << '\n';
+}
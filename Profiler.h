@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+#include "SysUtils.h"
+
+// Scoped phase timings and event counters, recorded only when enabled by --profile. Without FPGA_JSON_PROFILING
+// the macros expand to nothing, the counted expressions are not even evaluated.
+//
+//   PROFILE_SCOPE("path analysis");
+//   PROFILE_COUNT("cells visited", cellCnt);
+namespace Profiler
+{
+    inline std::atomic<bool> enabled { false };
+
+    inline bool isEnabled() { return enabled.load(std::memory_order_relaxed); }
+
+    class Counter
+    {
+    public:
+        explicit Counter(const char* name) : name(name) {}
+
+        void add(uint64_t amount) { value.fetch_add(amount, std::memory_order_relaxed); }
+
+        const char* const name;
+        std::atomic<uint64_t> value { 0 };
+    };
+
+    // Counters live until the end of the process, there is one per name
+    Counter& counter(const char* name);
+
+    // Times the enclosing block, these are meant for phases and chunks of work, not for single cells
+    class Scope
+    {
+    public:
+        explicit Scope(const char* name);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        const char* name;
+        bool active;
+        size_t allocationsBefore = 0;
+        int64_t startUs = 0;
+    };
+
+    // Enables recording for its lifetime, prints the summary table and writes the trace file when it ends
+    class Session
+    {
+    public:
+        // traceFileName may be empty
+        Session(bool enable, std::string traceFileName, std::ostream& os);
+        ~Session();
+
+        Session(const Session&) = delete;
+        Session& operator=(const Session&) = delete;
+
+    private:
+        bool active;
+        std::string traceFileName;
+        std::ostream& os;
+    };
+
+    void printSummary(std::ostream& os);
+    // Chrome trace event format, open with chrome://tracing or https://ui.perfetto.dev. Throws std::runtime_error
+    // if the file cannot be written.
+    void writeChromeTrace(const std::string& fileName);
+}
+
+#ifdef FPGA_JSON_PROFILING
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) Profiler::Scope PROFILE_CONCAT(profileScope, __LINE__)(name)
+#define PROFILE_COUNT(name, amount) \
+    do \
+    { \
+        if (Profiler::isEnabled()) \
+        { \
+            static Profiler::Counter& profileCounter = Profiler::counter(name); \
+            profileCounter.add(amount); \
+        } \
+    } while (false)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(name, amount) ((void)0)
+#endif
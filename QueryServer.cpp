@@ -0,0 +1,332 @@
+#include "QueryServer.h"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+#include "SysUtils.h"
+
+static std::vector<std::string_view> splitWords(std::string_view line)
+{
+    std::vector<std::string_view> words;
+    size_t pos = 0;
+    while (true)
+    {
+        pos = line.find_first_not_of(" \t\r", pos);
+        if (pos == std::string_view::npos) break;
+        size_t wordEnd = std::min(line.size(), line.find_first_of(" \t\r", pos));
+        words.push_back(line.substr(pos, wordEnd - pos));
+        pos = wordEnd;
+    }
+    return words;
+}
+
+static bool parseCount(std::string_view word, size_t& count)
+{
+    auto result = std::from_chars(word.data(), word.data() + word.size(), count);
+    return result.ec == std::errc() && result.ptr == word.data() + word.size();
+}
+
+QueryServer::QueryServer(const NetlistGraph& graph, const PathAnalysis& analysis)
+    : graph(graph), analysis(analysis), visitedCells(graph.cellCnt())
+{
+    cellsByName.reserve(graph.cellCnt());
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(graph.cellCnt()); ++cellId)
+    {
+        const Cell& cell = *graph.cells[cellId];
+        cellsByName.emplace(cell.name, cellId);
+
+        std::string_view src = cell.verilogSrc;
+        for (size_t begin = 0; begin <= src.size(); )
+        {
+            size_t end = std::min(src.size(), src.find('|', begin));
+            if (end > begin) srcIndex.emplace_back(src.substr(begin, end - begin), cellId);
+            begin = end + 1;
+        }
+    }
+    std::sort(srcIndex.begin(), srcIndex.end());
+}
+
+bool QueryServer::answer(std::string_view query, ReportWriter& out) const
+{
+    SysUtils::Stopwatch timer;
+    std::vector<std::string_view> words = splitWords(query);
+    if (words.empty()) return true;
+
+    std::string_view command = words[0];
+    size_t count = 0;
+    const cellId_t* cellId = nullptr;
+    if (command == "quit" || command == "exit")
+    {
+        return false;
+    }
+    else if (command == "path" && (words.size() == 2 || (words.size() == 3 && parseCount(words[2], count))))
+    {
+        if ((cellId = findCell(words[1], out))) queryPath(*cellId, words.size() == 3 ? count : 1, out);
+    }
+    else if ((command == "fanin" || command == "fanout") && (words.size() == 2 || (words.size() == 4 && words[2] == "depth" && parseCount(words[3], count))))
+    {
+        if ((cellId = findCell(words[1], out))) queryCone(*cellId, words.size() == 4 ? count : 1, command == "fanout", out);
+    }
+    else if (command == "src" && words.size() == 2)
+    {
+        querySrc(words[1], out);
+    }
+    else if (command == "top" && (words.size() == 1 || (words.size() == 2 && parseCount(words[1], count))))
+    {
+        queryTop(words.size() == 2 ? count : 10, out);
+    }
+    else if (command == "info" && words.size() == 2)
+    {
+        if ((cellId = findCell(words[1], out))) printCell(*cellId, out);
+    }
+    else
+    {
+        out << "error: unknown query, use one of\n"
+            << "path <cell> [K] | fanin <cell> [depth N] | fanout <cell> [depth N] | src <prefix> | top [K] | info <cell> | quit\n\n";
+        return true;
+    }
+
+    out << "# " << static_cast<size_t>(timer.elapsedMs() * 1000) << " us\n\n";
+    return true;
+}
+
+void QueryServer::serve(std::istream& input, std::ostream& output) const
+{
+    ReportWriter out(output);
+    std::string line;
+    while (std::getline(input, line))
+    {
+        bool goOn = answer(line, out);
+        out.flush();
+        if (! goOn) break;
+    }
+}
+
+const cellId_t* QueryServer::findCell(std::string_view name, ReportWriter& out) const
+{
+    auto it = cellsByName.find(name);
+    if (it != cellsByName.end()) return &it->second;
+
+    out << "error: no cell named " << name << '\n';
+    return nullptr;
+}
+
+// name, type, src and depth separated by tabs, "loop" in a fifth column for cells on combinational loops
+void QueryServer::printCell(cellId_t cellId, ReportWriter& out) const
+{
+    const Cell& cell = *graph.cells[cellId];
+    out << cell.name << '\t' << cell.typeName << '\t' << cell.verilogSrc << '\t' << analysis.depth[cellId];
+    out << (analysis.onLoop[cellId] ? "\tloop\n" : "\n");
+}
+
+void QueryServer::queryPath(cellId_t cellId, size_t pathCnt, ReportWriter& out) const
+{
+    std::vector<RankedPath> paths;
+    if (PathAnalysis::isEndpoint(graph.types[cellId]))
+    {
+        paths = worstPathsTo(graph, analysis, cellId, pathCnt);
+    }
+    else
+    {
+        paths.push_back({ analysis.depth[cellId], analysis.pathTo(cellId) });
+    }
+
+    for (const RankedPath& path : paths)
+    {
+        out << "len " << path.depth << '\n';
+        for (cellId_t pathCellId : path.cells)
+        {
+            out << '\t';
+            printCell(pathCellId, out);
+        }
+    }
+}
+
+// Breadth first, so every cell is listed with the lowest number of levels it is away. Registers and RAMs are
+// listed but not crossed.
+void QueryServer::queryCone(cellId_t cellId, size_t maxDepth, bool forward, ReportWriter& out) const
+{
+    size_t cellCnt = 0;
+    auto visit = [&](cellId_t otherCell, size_t level) {
+        if (level == 0) return true;
+        out << level << '\t';
+        printCell(otherCell, out);
+        ++cellCnt;
+        return ! PathAnalysis::isEndpoint(graph.types[otherCell]);
+    };
+
+    cellId_t roots[] = { cellId };
+    if (forward) breadthFirst<cellId_t>(visitedCells, workQueue, roots, [&](cellId_t id) { return graph.fanoutOf(id); }, visit, maxDepth);
+    else breadthFirst<cellId_t>(visitedCells, workQueue, roots, [&](cellId_t id) { return graph.faninOf(id); }, visit, maxDepth);
+    out << "# " << cellCnt << " cells\n";
+}
+
+void QueryServer::querySrc(std::string_view prefix, ReportWriter& out) const
+{
+    auto it = std::lower_bound(srcIndex.begin(), srcIndex.end(), prefix, [](const auto& entry, std::string_view str) { return entry.first < str; });
+    size_t cellCnt = 0;
+    for (; it != srcIndex.end() && it->first.starts_with(prefix); ++it)
+    {
+        printCell(it->second, out);
+        ++cellCnt;
+    }
+    out << "# " << cellCnt << " cells\n";
+}
+
+void QueryServer::queryTop(size_t cnt, ReportWriter& out) const
+{
+    for (cellId_t endpoint : analysis.topEndpoints(cnt))
+    {
+        printCell(endpoint, out);
+    }
+}
+
+#ifndef _WIN32
+namespace
+{
+    // Unbuffered output and a small read buffer over a connected socket
+    class SocketStreamBuf : public std::streambuf
+    {
+    public:
+        explicit SocketStreamBuf(int fd) : fd(fd)
+        {
+            setg(readBuffer, readBuffer, readBuffer);
+        }
+
+    protected:
+        int_type underflow() override
+        {
+            ssize_t readCnt = ::read(fd, readBuffer, sizeof(readBuffer));
+            if (readCnt <= 0) return traits_type::eof();
+            setg(readBuffer, readBuffer, readBuffer + readCnt);
+            return traits_type::to_int_type(*gptr());
+        }
+
+        std::streamsize xsputn(const char* data, std::streamsize size) override
+        {
+            std::streamsize written = 0;
+            while (written < size)
+            {
+#ifdef MSG_NOSIGNAL
+                ssize_t sent = ::send(fd, data + written, size - written, MSG_NOSIGNAL);
+#else
+                ssize_t sent = ::write(fd, data + written, size - written);
+#endif
+                if (sent <= 0) break;
+                written += sent;
+            }
+            return written;
+        }
+
+        int_type overflow(int_type c) override
+        {
+            if (traits_type::eq_int_type(c, traits_type::eof())) return traits_type::not_eof(c);
+            char ch = traits_type::to_char_type(c);
+            return xsputn(&ch, 1) == 1 ? c : traits_type::eof();
+        }
+
+    private:
+        int fd;
+        char readBuffer[4096];
+    };
+}
+
+void QueryServer::serveSocket(const std::string& socketPath) const
+{
+    sockaddr_un address {};
+    address.sun_family = AF_UNIX;
+    if (socketPath.size() >= sizeof(address.sun_path))
+        throw std::runtime_error("Socket path too long: " + socketPath);
+    std::copy(socketPath.begin(), socketPath.end(), address.sun_path);
+
+    // A socket left behind by an earlier run is replaced. One a server still listens on and anything else at the
+    // path are not touched.
+    struct stat status {};
+    if (::lstat(socketPath.c_str(), &status) == 0)
+    {
+        if (! S_ISSOCK(status.st_mode))
+            throw std::runtime_error("Not a socket, refusing to replace it: " + socketPath);
+
+        int probeFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+        if (probeFd < 0)
+            throw std::runtime_error("Could not create socket");
+        const bool connected = ::connect(probeFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+        const int probeError = errno;
+        ::close(probeFd);
+
+        if (connected)
+            throw std::runtime_error("Socket already in use: " + socketPath);
+        if (probeError != ECONNREFUSED)
+            throw std::runtime_error("Could not check socket " + socketPath + ": " + std::strerror(probeError));
+        ::unlink(socketPath.c_str());
+    }
+
+    int listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0)
+        throw std::runtime_error("Could not create socket");
+
+    if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listenFd, 4) != 0
+        || ::lstat(socketPath.c_str(), &status) != 0)
+    {
+        ::close(listenFd);
+        throw std::runtime_error("Could not listen on socket " + socketPath);
+    }
+
+    // only removes the path while it is still this server's socket
+    auto closeSocket = [&]() {
+        ::close(listenFd);
+        struct stat current {};
+        if (::lstat(socketPath.c_str(), &current) == 0 && current.st_dev == status.st_dev && current.st_ino == status.st_ino)
+            ::unlink(socketPath.c_str());
+    };
+
+    bool shutdown = false;
+    while (! shutdown)
+    {
+        int connectionFd = ::accept(listenFd, nullptr, nullptr);
+        if (connectionFd < 0)
+        {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            std::string error = std::strerror(errno);
+            closeSocket();
+            throw std::runtime_error("Could not accept a connection on " + socketPath + ": " + error);
+        }
+
+        SocketStreamBuf streamBuf(connectionFd);
+        std::iostream stream(&streamBuf);
+        ReportWriter out(stream);
+        std::string line;
+        while (std::getline(stream, line))
+        {
+            if (splitWords(line) == std::vector<std::string_view> { "shutdown" })
+            {
+                shutdown = true;
+                break;
+            }
+
+            bool goOn = answer(line, out);
+            out.flush();
+            if (! goOn) break;
+        }
+        out.flush();
+        ::close(connectionFd);
+    }
+
+    closeSocket();
+}
+#else
+void QueryServer::serveSocket(const std::string& socketPath) const
+{
+    throw std::runtime_error("Unix domain sockets are not supported on this platform: " + socketPath);
+}
+#endif
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "GraphTraversal.h"
+#include "NetlistGraph.h"
+#include "PathAnalysis.h"
+#include "ReportWriter.h"
+
+// Answers questions about one analyzed netlist, which stays loaded between them. The name and src indexes are
+// built once, so a query only costs the lookup and the size of its answer.
+//
+//   path <cell> [K]          longest path into the cell, the K longest distinct ones for endpoints
+//   fanin <cell> [depth N]   cells up to N levels before the cell (default 1), stopping at registers
+//   fanout <cell> [depth N]  cells up to N levels after the cell (default 1), stopping at registers
+//   src <prefix>             cells with a src location starting with prefix, e.g. "top.v:12."
+//   top [K]                  the K endpoints with the longest paths (default 10)
+//   info <cell>              type, src and depth of the cell
+//
+// Every answer ends with an empty line.
+class QueryServer
+{
+public:
+    QueryServer(const NetlistGraph& graph, const PathAnalysis& analysis);
+
+    // Returns false for "quit"
+    bool answer(std::string_view query, ReportWriter& out) const;
+
+    // Answers the queries read line by line until the end of the input or "quit"
+    void serve(std::istream& input, std::ostream& output) const;
+
+    // Listens on a Unix domain socket and serves one connection after the other, until a client sends
+    // "shutdown". Throws std::runtime_error if the socket cannot be set up or on platforms without them.
+    void serveSocket(const std::string& socketPath) const;
+
+private:
+    const NetlistGraph& graph;
+    const PathAnalysis& analysis;
+
+    std::unordered_map<std::string_view, cellId_t> cellsByName;
+    // One entry per location of every cell's src attribute ("a.v:1.2-3.4|b.v:5.6-7.8" has two), sorted
+    std::vector<std::pair<std::string_view, cellId_t>> srcIndex;
+
+    // Reused by the cone queries
+    mutable VisitMarks visitedCells;
+    mutable std::vector<cellId_t> workQueue;
+
+    const cellId_t* findCell(std::string_view name, ReportWriter& out) const;
+    void printCell(cellId_t cellId, ReportWriter& out) const;
+
+    void queryPath(cellId_t cellId, size_t pathCnt, ReportWriter& out) const;
+    void queryCone(cellId_t cellId, size_t maxDepth, bool forward, ReportWriter& out) const;
+    void querySrc(std::string_view prefix, ReportWriter& out) const;
+    void queryTop(size_t cnt, ReportWriter& out) const;
+};
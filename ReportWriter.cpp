@@ -0,0 +1,107 @@
+#include "ReportWriter.h"
+
+#include <cmath>
+
+ReportWriter::ReportWriter(std::ostream& os, size_t bufferSize /* = DEFAULT_BUFFER_SIZE */)
+    : os(os), capacity(bufferSize)
+{
+    buffer.reserve(capacity);
+}
+
+ReportWriter::~ReportWriter()
+{
+    flush();
+}
+
+ReportWriter& ReportWriter::operator<<(std::string_view str)
+{
+    makeRoom(str.size());
+    buffer.append(str);
+    return *this;
+}
+
+ReportWriter& ReportWriter::operator<<(char c)
+{
+    makeRoom(1);
+    buffer.push_back(c);
+    return *this;
+}
+
+ReportWriter& ReportWriter::repeat(char c, size_t cnt)
+{
+    makeRoom(cnt);
+    buffer.append(cnt, c);
+    return *this;
+}
+
+ReportWriter& ReportWriter::padded(std::string_view str, size_t width, Align align /* = Align::Right */)
+{
+    size_t fill = width > str.size() ? width - str.size() : 0;
+    makeRoom(str.size() + fill);
+    if (align == Align::Right) buffer.append(fill, ' ');
+    buffer.append(str);
+    if (align == Align::Left) buffer.append(fill, ' ');
+    return *this;
+}
+
+ReportWriter& ReportWriter::fixed(double value, int precision, size_t width /* = 0 */)
+{
+    if (! std::isfinite(value)) return padded(std::isnan(value) ? "nan" : (value < 0 ? "-inf" : "inf"), width);
+
+    // the integer part of a double has at most 309 digits
+    char digits[320 + 32];
+    auto result = std::to_chars(digits, digits + sizeof(digits), value, std::chars_format::fixed, precision);
+    return padded(std::string_view(digits, result.ptr - digits), width);
+}
+
+ReportWriter& ReportWriter::jsonString(std::string_view str)
+{
+    static const char* hexDigits = "0123456789abcdef";
+
+    makeRoom(str.size() + 2);
+    buffer.push_back('"');
+    for (char c : str)
+    {
+        switch (c)
+        {
+            case '"': *this << "\\\""; break;
+            case '\\': *this << "\\\\"; break;
+            case '\n': *this << "\\n"; break;
+            case '\r': *this << "\\r"; break;
+            case '\t': *this << "\\t"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    *this << "\\u00" << hexDigits[c >> 4] << hexDigits[c & 0xf];
+                }
+                else
+                {
+                    *this << c;
+                }
+                break;
+        }
+    }
+    return *this << '"';
+}
+
+ReportWriter& ReportWriter::csvField(std::string_view str)
+{
+    if (str.find_first_of(",\"\r\n") == std::string_view::npos) return *this << str;
+
+    *this << '"';
+    size_t begin = 0;
+    for (size_t quote = str.find('"'); quote != std::string_view::npos; quote = str.find('"', begin))
+    {
+        *this << str.substr(begin, quote + 1 - begin) << '"';
+        begin = quote + 1;
+    }
+    return *this << str.substr(begin) << '"';
+}
+
+void ReportWriter::flush()
+{
+    if (buffer.empty()) return;
+    os.write(buffer.data(), buffer.size());
+    os.flush();
+    buffer.clear();
+}
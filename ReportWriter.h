@@ -0,0 +1,74 @@
+#pragma once
+
+#include <charconv>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <type_traits>
+
+// Collects report output in a large buffer and hands it to the stream in few big writes, instead of a formatted
+// stream insertion per item. Flushes when the buffer is full and on destruction.
+class ReportWriter
+{
+public:
+    enum class Align
+    {
+        Left, Right
+    };
+
+    explicit ReportWriter(std::ostream& os, size_t bufferSize = DEFAULT_BUFFER_SIZE);
+    ~ReportWriter();
+
+    ReportWriter(const ReportWriter&) = delete;
+    ReportWriter& operator=(const ReportWriter&) = delete;
+
+    ReportWriter& operator<<(std::string_view str);
+    ReportWriter& operator<<(char c);
+    ReportWriter& repeat(char c, size_t cnt);
+
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T> && ! std::is_same_v<T, char> && ! std::is_same_v<T, bool>>>
+    ReportWriter& operator<<(T value)
+    {
+        char digits[24];
+        return *this << formatInteger(digits, value);
+    }
+
+    // Pads with spaces to at least width characters, like std::setw
+    ReportWriter& padded(std::string_view str, size_t width, Align align = Align::Right);
+
+    template <typename T, typename = std::enable_if_t<std::is_integral_v<T>>>
+    ReportWriter& padded(T value, size_t width, Align align = Align::Right)
+    {
+        char digits[24];
+        return padded(formatInteger(digits, value), width, align);
+    }
+
+    // Fixed notation like std::fixed with std::setprecision(precision)
+    ReportWriter& fixed(double value, int precision, size_t width = 0);
+
+    // Quoted and escaped JSON string
+    ReportWriter& jsonString(std::string_view str);
+    // CSV field, quoted if it contains a separator, quote or line break
+    ReportWriter& csvField(std::string_view str);
+
+    void flush();
+
+private:
+    static constexpr size_t DEFAULT_BUFFER_SIZE = 1 << 20;
+
+    template <typename T>
+    static std::string_view formatInteger(char (&digits)[24], T value)
+    {
+        auto result = std::to_chars(digits, digits + sizeof(digits), value);
+        return { digits, static_cast<size_t>(result.ptr - digits) };
+    }
+
+    void makeRoom(size_t size)
+    {
+        if (buffer.size() + size > capacity) flush();
+    }
+
+    std::ostream& os;
+    std::string buffer;
+    size_t capacity;
+};
@@ -0,0 +1,131 @@
+#include "SrcRollup.h"
+
+#include <algorithm>
+#include <charconv>
+#include <unordered_map>
+
+#include "Profiler.h"
+
+/*static*/ SrcIndex SrcIndex::build(const NetlistGraph& graph)
+{
+    PROFILE_SCOPE("src index");
+    SrcIndex index;
+    std::unordered_map<std::string_view, uint32_t> fileIds;
+    std::unordered_map<uint64_t, uint32_t> lineIds;
+
+    index.cellLineOffsets.reserve(graph.cellCnt() + 1);
+    index.cellLineOffsets.push_back(0);
+    for (const Cell* cell : graph.cells)
+    {
+        std::string_view src = cell->verilogSrc;
+        size_t cellBegin = index.cellLines.size();
+        for (size_t begin = 0; begin < src.size(); )
+        {
+            size_t end = std::min(src.size(), src.find('|', begin));
+            std::string_view location = src.substr(begin, end - begin);
+            begin = end + 1;
+            if (location.empty()) continue;
+
+            std::string_view file = location;
+            uint32_t line = 0;
+            size_t colon = location.rfind(':');
+            if (colon != std::string_view::npos)
+            {
+                const char* digits = location.data() + colon + 1;
+                if (std::from_chars(digits, location.data() + location.size(), line).ptr != digits)
+                    file = location.substr(0, colon);
+            }
+
+            auto fileIt = fileIds.try_emplace(file, static_cast<uint32_t>(index.files.size())).first;
+            if (fileIt->second == index.files.size()) index.files.push_back(file);
+
+            uint64_t lineKey = (static_cast<uint64_t>(fileIt->second) << 32) | line;
+            auto lineIt = lineIds.try_emplace(lineKey, static_cast<uint32_t>(index.lines.size())).first;
+            if (lineIt->second == index.lines.size()) index.lines.push_back({ fileIt->second, line });
+
+            if (std::find(index.cellLines.begin() + cellBegin, index.cellLines.end(), lineIt->second) == index.cellLines.end())
+                index.cellLines.push_back(lineIt->second);
+        }
+        index.cellLineOffsets.push_back(static_cast<uint32_t>(index.cellLines.size()));
+    }
+    return index;
+}
+
+SrcRollup rollupBySrc(const NetlistGraph& graph, const PathAnalysis& analysis, const SrcIndex& index)
+{
+    PROFILE_SCOPE("src rollup");
+    const size_t cellCnt = graph.cellCnt();
+    SrcRollup rollup;
+    rollup.perFile.resize(index.files.size());
+    rollup.perLine.resize(index.lines.size());
+
+    // The predecessor of a combinational cell is one level less deep, the one of an endpoint is as deep as the
+    // endpoint. Counting sort by decreasing depth, endpoints first, visits every cell before its predecessor.
+    auto orderKey = [&](cellId_t cellId) {
+        return static_cast<size_t>(analysis.depth[cellId]) * 2 + (PathAnalysis::isEndpoint(graph.types[cellId]) ? 1 : 0);
+    };
+    size_t maxKey = 0;
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+    {
+        maxKey = std::max(maxKey, orderKey(cellId));
+    }
+    std::vector<uint32_t> keyOffsets(maxKey + 2, 0);
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+    {
+        ++keyOffsets[maxKey - orderKey(cellId) + 1];
+    }
+    for (size_t key = 1; key < keyOffsets.size(); ++key) keyOffsets[key] += keyOffsets[key - 1];
+    std::vector<cellId_t> order(keyOffsets.back());
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+    {
+        order[keyOffsets[maxKey - orderKey(cellId)]++] = cellId;
+    }
+
+    // Files of a cell, usually one
+    std::vector<uint32_t> cellFiles, predFiles;
+    auto filesOf = [&](cellId_t cellId, std::vector<uint32_t>& files) {
+        files.clear();
+        for (uint32_t lineId : index.linesOf(cellId))
+        {
+            uint32_t fileId = index.lines[lineId].fileId;
+            if (std::find(files.begin(), files.end(), fileId) == files.end()) files.push_back(fileId);
+        }
+    };
+
+    std::vector<size_t> pathCnt(cellCnt, 0);
+    for (cellId_t cellId : order)
+    {
+        depth_t depth = analysis.depth[cellId];
+        if (PathAnalysis::isEndpoint(graph.types[cellId]) && depth > 0) pathCnt[cellId] = 1;
+
+        auto addCell = [&](SrcStats& stats) {
+            stats.pathCnt += pathCnt[cellId];
+            stats.maxDepth = std::max(stats.maxDepth, depth);
+            if (graph.types[cellId] == Cell::Type::LUT) ++stats.lutCnt;
+            ++stats.cellCnt;
+        };
+        std::span<const uint32_t> lines = index.linesOf(cellId);
+        for (uint32_t lineId : lines) addCell(rollup.perLine[lineId]);
+        filesOf(cellId, cellFiles);
+        for (uint32_t fileId : cellFiles) addCell(rollup.perFile[fileId]);
+
+        // The paths continue in the predecessor, where they are counted again unless they stay on the same line
+        cellId_t pred = analysis.predecessor[cellId];
+        if (pred == Cell::INVALID_ID || pathCnt[cellId] == 0) continue;
+        pathCnt[pred] += pathCnt[cellId];
+
+        std::span<const uint32_t> predLines = index.linesOf(pred);
+        for (uint32_t lineId : lines)
+        {
+            if (std::find(predLines.begin(), predLines.end(), lineId) != predLines.end())
+                rollup.perLine[lineId].pathCnt -= pathCnt[cellId];
+        }
+        filesOf(pred, predFiles);
+        for (uint32_t fileId : cellFiles)
+        {
+            if (std::find(predFiles.begin(), predFiles.end(), fileId) != predFiles.end())
+                rollup.perFile[fileId].pathCnt -= pathCnt[cellId];
+        }
+    }
+    return rollup;
+}
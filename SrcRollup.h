@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+
+#include "NetlistGraph.h"
+#include "PathAnalysis.h"
+
+// First line of a src location, "alu.v:12.3-14.9" is line 12 of alu.v
+struct SrcLine
+{
+    uint32_t fileId;
+    // 0 if the location has no line
+    uint32_t line;
+};
+
+// Parsed src attributes of all cells of a graph. Files and lines are interned, the lines of every cell are a
+// range in one shared array like the fanin of NetlistGraph. Cells merged by synthesis have several locations
+// joined by '|', they belong to all of their lines.
+struct SrcIndex
+{
+    // Views into the cells' src attributes
+    std::vector<std::string_view> files;
+    std::vector<SrcLine> lines;
+
+    // cellLineOffsets[id] .. cellLineOffsets[id + 1] index cellLines, distinct line ids of the cell
+    std::vector<uint32_t> cellLineOffsets;
+    std::vector<uint32_t> cellLines;
+
+    std::span<const uint32_t> linesOf(cellId_t cellId) const
+    {
+        return { cellLines.data() + cellLineOffsets[cellId], cellLines.data() + cellLineOffsets[cellId + 1] };
+    }
+
+    static SrcIndex build(const NetlistGraph& graph);
+};
+
+struct SrcStats
+{
+    // Longest paths of the endpoints running through the file or line. A path is counted once for every
+    // stretch of consecutive cells it has there, one that leaves and comes back later counts twice.
+    size_t pathCnt = 0;
+    depth_t maxDepth = 0;
+    size_t lutCnt = 0;
+    size_t cellCnt = 0;
+};
+
+struct SrcRollup
+{
+    // Indexed by the file and line ids of the SrcIndex
+    std::vector<SrcStats> perFile;
+    std::vector<SrcStats> perLine;
+};
+
+// Single pass over the cells from the endpoints towards the path starts. The longest paths form a forest along
+// PathAnalysis::predecessor, so the number of paths through a cell is the sum over the cells it is the predecessor
+// of, O(cells * locations per cell).
+SrcRollup rollupBySrc(const NetlistGraph& graph, const PathAnalysis& analysis, const SrcIndex& index);
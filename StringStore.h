@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <unordered_set>
+#include <vector>
+
+#include "Profiler.h"
+
+// Append-only character storage handing out stable string views. Strings are packed into large blocks
+// which are only released together with the store.
+class StringStore
+{
+public:
+    std::string_view store(std::string_view str)
+    {
+        if (str.empty()) return {};
+
+        if (str.size() > BLOCK_SIZE / 4)
+        {
+            // large strings get their own block, so they don't waste the rest of the current one
+            blocks.emplace_back(new char[str.size()]);
+            std::memcpy(blocks.back().get(), str.data(), str.size());
+            storedBytes += str.size();
+            return { blocks.back().get(), str.size() };
+        }
+
+        if (blocks.empty() || blockUsed + str.size() > BLOCK_SIZE)
+        {
+            blocks.emplace_back(new char[BLOCK_SIZE]);
+            currentBlock = blocks.back().get();
+            blockUsed = 0;
+        }
+
+        char* dest = currentBlock + blockUsed;
+        std::memcpy(dest, str.data(), str.size());
+        blockUsed += str.size();
+        storedBytes += str.size();
+        return { dest, str.size() };
+    }
+
+    size_t memoryBytes() const { return blocks.size() * sizeof(blocks[0]) + storedBytes; }
+
+private:
+    static constexpr size_t BLOCK_SIZE = 64 * 1024;
+
+    std::vector<std::unique_ptr<char[]>> blocks;
+    char* currentBlock = nullptr;
+    size_t blockUsed = 0;
+    size_t storedBytes = 0;
+};
+
+// Deduplicating front end of a StringStore, equal strings share a single stored copy
+class StringInterner
+{
+public:
+    explicit StringInterner(StringStore& store) : store(store) {}
+
+    std::string_view intern(std::string_view str)
+    {
+        auto it = strings.find(str);
+        if (it != strings.end())
+        {
+            PROFILE_COUNT("interned string hits", 1);
+            return *it;
+        }
+        return *strings.insert(store.store(str)).first;
+    }
+
+    size_t size() const { return strings.size(); }
+    // Excludes the characters, those are accounted by the store
+    size_t memoryBytes() const { return strings.bucket_count() * sizeof(void*) + strings.size() * (sizeof(std::string_view) + 2 * sizeof(void*)); }
+
+private:
+    StringStore& store;
+    std::unordered_set<std::string_view> strings;
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <string>
+
+namespace SysUtils
+{
+    // Peak resident set size of the current process in bytes, 0 if unavailable
+    size_t peakRssBytes();
+
+    // Installed physical memory in bytes, 0 if unavailable
+    size_t physicalMemoryBytes();
+
+    std::string formatBytes(size_t bytes);
+
+    // Number of global operator new calls so far
+    size_t allocationCnt();
+
+    class Stopwatch
+    {
+    public:
+        Stopwatch() : start(std::chrono::steady_clock::now()) {}
+
+        double elapsedMs() const
+        {
+            return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        }
+
+        void restart() { start = std::chrono::steady_clock::now(); }
+
+    private:
+        std::chrono::steady_clock::time_point start;
+    };
+}
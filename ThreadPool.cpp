@@ -0,0 +1,89 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threadCnt)
+{
+    if (threadCnt == 0) threadCnt = 1;
+
+    for (size_t i = 0; i < threadCnt; ++i)
+    {
+        workers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 1; i < threadCnt; ++i)
+    {
+        threads.emplace_back(&ThreadPool::workerLoop, this, i);
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        stopping = true;
+    }
+    sleepCondition.notify_all();
+    for (std::thread& thread : threads)
+    {
+        thread.join();
+    }
+}
+
+void ThreadPool::push(size_t workerIdx, Task task)
+{
+    Worker& worker = *workers[workerIdx];
+    std::lock_guard<std::mutex> lock(worker.mutex);
+    worker.tasks.push_back(std::move(task));
+    queuedTasks.fetch_add(1, std::memory_order_release);
+}
+
+void ThreadPool::wakeWorkers()
+{
+    {
+        // pairs with the predicate check of the sleeping workers, so no wakeup gets lost
+        std::lock_guard<std::mutex> lock(sleepMutex);
+    }
+    sleepCondition.notify_all();
+}
+
+bool ThreadPool::runOneTask(size_t workerIdx)
+{
+    Task task;
+
+    {
+        Worker& own = *workers[workerIdx];
+        std::lock_guard<std::mutex> lock(own.mutex);
+        if (! own.tasks.empty())
+        {
+            task = std::move(own.tasks.back());
+            own.tasks.pop_back();
+        }
+    }
+
+    for (size_t offset = 1; ! task && offset < workers.size(); ++offset)
+    {
+        Worker& victim = *workers[(workerIdx + offset) % workers.size()];
+        std::lock_guard<std::mutex> lock(victim.mutex);
+        if (! victim.tasks.empty())
+        {
+            task = std::move(victim.tasks.front());
+            victim.tasks.pop_front();
+        }
+    }
+
+    if (! task) return false;
+
+    queuedTasks.fetch_sub(1, std::memory_order_acq_rel);
+    task(workerIdx);
+    return true;
+}
+
+void ThreadPool::workerLoop(size_t workerIdx)
+{
+    while (true)
+    {
+        if (runOneTask(workerIdx)) continue;
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        sleepCondition.wait(lock, [&]() { return stopping || queuedTasks.load(std::memory_order_acquire) > 0; });
+        if (stopping) return;
+    }
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed size pool with one task deque per worker. Workers pop their own deque from the back and steal from
+// the front of the others when they run dry. The thread calling parallelFor acts as worker 0.
+class ThreadPool
+{
+public:
+    typedef std::function<void(size_t workerIdx)> Task;
+
+    explicit ThreadPool(size_t threadCnt);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t threadCnt() const { return workers.size(); }
+
+    // Calls func(begin, end, workerIdx) for chunks of at most grainSize items of [0, count), returns when all are done
+    template <typename Func>
+    void parallelFor(size_t count, size_t grainSize, Func func)
+    {
+        if (count == 0) return;
+        if (grainSize == 0) grainSize = 1;
+        if (threadCnt() == 1 || count <= grainSize)
+        {
+            func(size_t(0), count, size_t(0));
+            return;
+        }
+
+        std::atomic<size_t> remaining = (count + grainSize - 1) / grainSize;
+        size_t workerIdx = 0;
+        for (size_t begin = 0; begin < count; begin += grainSize)
+        {
+            size_t end = std::min(count, begin + grainSize);
+            push(workerIdx, [&func, &remaining, begin, end](size_t executingWorker) {
+                func(begin, end, executingWorker);
+                remaining.fetch_sub(1, std::memory_order_acq_rel);
+            });
+            workerIdx = (workerIdx + 1) % threadCnt();
+        }
+        wakeWorkers();
+
+        while (remaining.load(std::memory_order_acquire) > 0)
+        {
+            if (! runOneTask(0)) std::this_thread::yield();
+        }
+    }
+
+private:
+    struct Worker
+    {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void push(size_t workerIdx, Task task);
+    void wakeWorkers();
+    bool runOneTask(size_t workerIdx);
+    void workerLoop(size_t workerIdx);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    std::vector<std::thread> threads;
+
+    std::mutex sleepMutex;
+    std::condition_variable sleepCondition;
+    std::atomic<size_t> queuedTasks = 0;
+    bool stopping = false;
+};
@@ -0,0 +1,273 @@
+#include "TimingAnalysis.h"
+
+#include <algorithm>
+#include <functional>
+#include <queue>
+
+#include "CombinationalLoops.h"
+#include "Profiler.h"
+#include "TopK.h"
+
+TimingAnalysis::TimingAnalysis(const NetlistGraph& graph, const DelayModel& model)
+    : graph(graph)
+    , model(model)
+{
+    portId_t maxNet = -1;
+    for (portId_t net : graph.fanoutNet) maxNet = std::max(maxNet, net);
+    netSinkCnts.assign(static_cast<size_t>(maxNet + 1), 0);
+    for (portId_t net : graph.fanoutNet) ++netSinkCnts[net];
+}
+
+double TimingAnalysis::netDelay(cellId_t from, cellId_t to) const
+{
+    if (graph.types[from] == Cell::Type::Carry && graph.types[to] == Cell::Type::Carry)
+        return model.carryNet;
+
+    // The fanout is sorted by destination, the slowest net if several connect the two cells
+    std::span<const cellId_t> nextCells = graph.fanoutOf(from);
+    auto [first, last] = std::equal_range(nextCells.begin(), nextCells.end(), to);
+    uint32_t sinkCnt = 0;
+    for (uint32_t edgeIdx = graph.fanoutOffsets[from] + (first - nextCells.begin()); edgeIdx < graph.fanoutOffsets[from] + (last - nextCells.begin()); ++edgeIdx)
+    {
+        sinkCnt = std::max(sinkCnt, netSinkCnts[graph.fanoutNet[edgeIdx]]);
+    }
+    return model.netDelay(sinkCnt);
+}
+
+bool TimingAnalysis::relax(cellId_t cellId)
+{
+    uint32_t loopIdx = loopOf.empty() ? NO_LOOP : loopOf[cellId];
+    std::span<const cellId_t> cells = loopIdx == NO_LOOP ? std::span<const cellId_t>(&cellId, 1) : std::span<const cellId_t>(loops[loopIdx]);
+
+    double maxArrival = 0.0;
+    cellId_t latestPred = Cell::INVALID_ID;
+    for (cellId_t loopCell : cells)
+    {
+        for (cellId_t prevCell : graph.faninOf(loopCell))
+        {
+            if (loopIdx != NO_LOOP && loopOf[prevCell] == loopIdx) continue;
+
+            double inputArrival = arrivals[prevCell] + netDelay(prevCell, loopCell);
+            if (latestPred == Cell::INVALID_ID || inputArrival > maxArrival)
+            {
+                maxArrival = inputArrival;
+                latestPred = prevCell;
+            }
+        }
+    }
+
+    bool changed = false;
+    for (cellId_t loopCell : cells)
+    {
+        double newArrival = maxArrival + model.cellDelay(graph.types[loopCell]);
+        changed |= newArrival != arrivals[loopCell] || latestPred != predecessors[loopCell];
+        arrivals[loopCell] = newArrival;
+        predecessors[loopCell] = latestPred;
+    }
+    return changed;
+}
+
+void TimingAnalysis::relaxEndpoint(cellId_t endpoint)
+{
+    double maxArrival = 0.0;
+    cellId_t latestPred = Cell::INVALID_ID;
+    for (cellId_t prevCell : graph.faninOf(endpoint))
+    {
+        double inputArrival = arrivals[prevCell] + netDelay(prevCell, endpoint);
+        if (latestPred == Cell::INVALID_ID || inputArrival > maxArrival)
+        {
+            maxArrival = inputArrival;
+            latestPred = prevCell;
+        }
+    }
+
+    endpointArrivals[endpoint] = latestPred == Cell::INVALID_ID ? 0.0 : maxArrival + model.setupTime(graph.types[endpoint]);
+    endpointPredecessors[endpoint] = latestPred;
+}
+
+void TimingAnalysis::run()
+{
+    PROFILE_SCOPE("timing analysis");
+    const size_t cellCnt = graph.cellCnt();
+    arrivals.assign(cellCnt, 0.0);
+    predecessors.assign(cellCnt, Cell::INVALID_ID);
+    endpointArrivals.assign(cellCnt, 0.0);
+    endpointPredecessors.assign(cellCnt, Cell::INVALID_ID);
+    topoIndex.assign(cellCnt, UNORDERED);
+    endpointIds.clear();
+
+    std::vector<uint32_t> pendingInputs(cellCnt, 0);
+    std::vector<cellId_t> ready;
+    size_t combinationalCnt = 0;
+    for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+    {
+        if (isSequential(graph.types[cellId]))
+        {
+            arrivals[cellId] = model.clockToOutDelay(graph.types[cellId]);
+            endpointIds.push_back(cellId);
+            continue;
+        }
+
+        ++combinationalCnt;
+        for (cellId_t prevCell : graph.faninOf(cellId))
+        {
+            if (! isSequential(graph.types[prevCell])) ++pendingInputs[cellId];
+        }
+        if (pendingInputs[cellId] == 0) ready.push_back(cellId);
+    }
+
+    uint32_t orderedCnt = 0;
+    while (! ready.empty())
+    {
+        cellId_t cellId = ready.back();
+        ready.pop_back();
+        topoIndex[cellId] = orderedCnt++;
+
+        relax(cellId);
+
+        for (cellId_t nextCell : graph.fanoutOf(cellId))
+        {
+            if (! isSequential(graph.types[nextCell]) && --pendingInputs[nextCell] == 0)
+                ready.push_back(nextCell);
+        }
+    }
+
+    // The cells on and behind loops follow in topological order of the condensation
+    loopOf.clear();
+    loops.clear();
+    loopCells = 0;
+    if (orderedCnt < combinationalCnt)
+    {
+        std::vector<cellId_t> unorderedCells;
+        for (cellId_t cellId = 0; cellId < static_cast<cellId_t>(cellCnt); ++cellId)
+        {
+            if (! isSequential(graph.types[cellId]) && topoIndex[cellId] == UNORDERED) unorderedCells.push_back(cellId);
+        }
+
+        CellComponents components = findStronglyConnected(graph, unorderedCells);
+        loopOf.assign(cellCnt, NO_LOOP);
+        for (size_t componentIdx = 0; componentIdx < components.size(); ++componentIdx)
+        {
+            std::span<const cellId_t> component = components[componentIdx];
+            if (isLoop(graph, component))
+            {
+                for (cellId_t cellId : component) loopOf[cellId] = static_cast<uint32_t>(loops.size());
+                loops.emplace_back(component.begin(), component.end());
+                loopCells += component.size();
+            }
+            for (cellId_t cellId : component) topoIndex[cellId] = orderedCnt++;
+            relax(component[0]);
+        }
+    }
+
+    for (cellId_t endpoint : endpointIds)
+    {
+        relaxEndpoint(endpoint);
+    }
+    PROFILE_COUNT("cells visited", orderedCnt + endpointIds.size());
+}
+
+void TimingAnalysis::update(std::span<const cellId_t> changedCells)
+{
+    PROFILE_SCOPE("timing update");
+    // min-heap on the topological index, so every cell is relaxed after all of its changed inputs
+    typedef std::pair<uint32_t, cellId_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>, std::greater<QueueEntry>> queue;
+    std::vector<cellId_t> dirtyEndpoints;
+    std::vector<bool> queued(graph.cellCnt(), false);
+
+    auto propagateFrom = [&](cellId_t cellId) {
+        for (cellId_t nextCell : graph.fanoutOf(cellId))
+        {
+            if (isSequential(graph.types[nextCell]))
+            {
+                dirtyEndpoints.push_back(nextCell);
+            }
+            else if (topoIndex[nextCell] != UNORDERED && ! queued[nextCell])
+            {
+                queued[nextCell] = true;
+                queue.emplace(topoIndex[nextCell], nextCell);
+            }
+        }
+    };
+
+    for (cellId_t cellId : changedCells)
+    {
+        if (isSequential(graph.types[cellId]))
+        {
+            arrivals[cellId] = model.clockToOutDelay(graph.types[cellId]);
+            dirtyEndpoints.push_back(cellId);
+            propagateFrom(cellId);
+        }
+        else if (topoIndex[cellId] != UNORDERED && ! queued[cellId])
+        {
+            queued[cellId] = true;
+            queue.emplace(topoIndex[cellId], cellId);
+        }
+    }
+
+    while (! queue.empty())
+    {
+        cellId_t cellId = queue.top().second;
+        queue.pop();
+        queued[cellId] = false;
+
+        if (! relax(cellId)) continue;
+        if (loopOf.empty() || loopOf[cellId] == NO_LOOP)
+        {
+            propagateFrom(cellId);
+        }
+        else
+        {
+            for (cellId_t loopCell : loops[loopOf[cellId]]) propagateFrom(loopCell);
+        }
+    }
+
+    for (cellId_t endpoint : dirtyEndpoints)
+    {
+        relaxEndpoint(endpoint);
+    }
+}
+
+std::vector<cellId_t> TimingAnalysis::sortedEndpoints() const
+{
+    std::vector<cellId_t> sorted = endpointIds;
+    std::sort(sorted.begin(), sorted.end(), [&](cellId_t a, cellId_t b) {
+        return endpointArrivals[a] != endpointArrivals[b] ? endpointArrivals[a] > endpointArrivals[b] : a < b;
+    });
+    return sorted;
+}
+
+std::vector<cellId_t> TimingAnalysis::topEndpoints(size_t k) const
+{
+    return selectTop(endpointIds, k, [&](cellId_t a, cellId_t b) {
+        return endpointArrivals[a] != endpointArrivals[b] ? endpointArrivals[a] > endpointArrivals[b] : a < b;
+    });
+}
+
+std::vector<cellId_t> TimingAnalysis::pathTo(cellId_t endpoint) const
+{
+    std::vector<cellId_t> path { endpoint };
+    for (cellId_t cellId = endpointPredecessors[endpoint]; cellId != Cell::INVALID_ID; cellId = predecessors[cellId])
+    {
+        path.push_back(cellId);
+        if (isSequential(graph.types[cellId])) break;
+    }
+    return path;
+}
+
+double TimingAnalysis::criticalDelay() const
+{
+    double maxArrival = 0.0;
+    for (cellId_t endpoint : endpointIds)
+    {
+        maxArrival = std::max(maxArrival, endpointArrivals[endpoint]);
+    }
+    return maxArrival;
+}
+
+double TimingAnalysis::fmaxMHz() const
+{
+    double delay = criticalDelay();
+    return delay > 0.0 ? 1000.0 / delay : 0.0;
+}
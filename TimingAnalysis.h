@@ -0,0 +1,87 @@
+#pragma once
+
+#include <limits>
+#include <span>
+#include <vector>
+
+#include "DelayModel.h"
+#include "NetlistGraph.h"
+
+// Arrival time propagation with a DelayModel. Paths start at the outputs of DFF and RAM cells and end at their
+// inputs, carry cells are part of the combinational network here. Combinational loops are condensed like in
+// PathAnalysis: the latest arrival at the inputs of a loop counts for all of its cells.
+class TimingAnalysis
+{
+public:
+    TimingAnalysis(const NetlistGraph& graph, const DelayModel& model);
+
+    // Full propagation in topological order, O(cells + connections)
+    void run();
+
+    // Re-propagates after the delays of the given cells changed. Only the fanout cones whose arrival times
+    // actually move get revisited.
+    void update(std::span<const cellId_t> changedCells);
+
+    static bool isSequential(Cell::Type type)
+    {
+        return type == Cell::Type::DFF || type == Cell::Type::RAM;
+    }
+
+    // Arrival time at the cell's output
+    double arrival(cellId_t cellId) const { return arrivals[cellId]; }
+    // Arrival time at a DFF / RAM input, including its setup time
+    double endpointArrival(cellId_t endpoint) const { return endpointArrivals[endpoint]; }
+
+    const std::vector<cellId_t>& endpoints() const { return endpointIds; }
+    // Endpoints ordered by decreasing arrival time, ties by cell id
+    std::vector<cellId_t> sortedEndpoints() const;
+    // The first k of sortedEndpoints() without sorting all of them
+    std::vector<cellId_t> topEndpoints(size_t k) const;
+
+    // Cells of the critical path into the endpoint, starting with the endpoint and ending with the launching cell
+    std::vector<cellId_t> pathTo(cellId_t endpoint) const;
+
+    double criticalDelay() const;
+    double fmaxMHz() const;
+
+    // Combinational cells on loops
+    size_t loopCellCnt() const { return loopCells; }
+
+    // For passes over parts of the network in the same order: the position of a combinational cell in the
+    // topological order of the condensation and the cells of its loop, or just the cell itself
+    uint32_t topologicalIndex(cellId_t cellId) const { return topoIndex[cellId]; }
+    std::span<const cellId_t> loopCellsOf(const cellId_t& cellId) const
+    {
+        return loopOf.empty() || loopOf[cellId] == NO_LOOP ? std::span<const cellId_t>(&cellId, 1) : std::span<const cellId_t>(loops[loopOf[cellId]]);
+    }
+
+    const DelayModel& delayModel() const { return model; }
+    // Charged by the sinks of the net on the connection
+    double netDelay(cellId_t from, cellId_t to) const;
+
+private:
+    // Recomputes arrival and predecessor of a combinational cell, of all cells of its loop if it is on one.
+    // Returns true if an arrival changed.
+    bool relax(cellId_t cellId);
+    void relaxEndpoint(cellId_t endpoint);
+
+    const NetlistGraph& graph;
+    const DelayModel& model;
+    // By net id
+    std::vector<uint32_t> netSinkCnts;
+
+    std::vector<double> arrivals;
+    std::vector<cellId_t> predecessors;
+    std::vector<double> endpointArrivals;
+    std::vector<cellId_t> endpointPredecessors;
+    // Position in the topological order of the condensation, UNORDERED for sequential cells
+    std::vector<uint32_t> topoIndex;
+    std::vector<cellId_t> endpointIds;
+    // Index into loops for the cells on loops, NO_LOOP for the others. Both empty without loops.
+    std::vector<uint32_t> loopOf;
+    std::vector<std::vector<cellId_t>> loops;
+    size_t loopCells = 0;
+
+    static constexpr uint32_t NO_LOOP = std::numeric_limits<uint32_t>::max();
+    static constexpr uint32_t UNORDERED = std::numeric_limits<uint32_t>::max();
+};
@@ -0,0 +1,32 @@
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+// The first k items in the order given by before(a, b), sorted by it. Keeps a heap of at most k items whose
+// front is the last one selected so far, O(items * log k) time and O(k) memory.
+template <typename T, typename Before>
+std::vector<T> selectTop(const std::vector<T>& items, size_t k, Before before)
+{
+    std::vector<T> heap;
+    if (k == 0) return heap;
+    heap.reserve(std::min(k, items.size()));
+
+    for (const T& item : items)
+    {
+        if (heap.size() < k)
+        {
+            heap.push_back(item);
+            std::push_heap(heap.begin(), heap.end(), before);
+        }
+        else if (before(item, heap.front()))
+        {
+            std::pop_heap(heap.begin(), heap.end(), before);
+            heap.back() = item;
+            std::push_heap(heap.begin(), heap.end(), before);
+        }
+    }
+
+    std::sort_heap(heap.begin(), heap.end(), before);
+    return heap;
+}
@@ -0,0 +1,177 @@
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#include <nlohmann/json.hpp>
+
+#include "BenchOptions.h"
+#include "NetlistGenerator.h"
+#include "Design.h"
+#include "NetlistLoader.h"
+#include "NetlistGraph.h"
+#include "LogicCell.h"
+#include "PathAnalysis.h"
+#include "ThreadPool.h"
+#include "SysUtils.h"
+
+#ifndef FPGA_JSON_VERSION
+#define FPGA_JSON_VERSION "unknown"
+#endif
+
+using ordered_json = nlohmann::ordered_json;
+
+// Wall time, allocations and the peak RSS so far of one phase of a run
+class PhaseRecorder
+{
+public:
+    PhaseRecorder(ordered_json& phases, size_t cellCnt) : phases(phases), cellCnt(cellCnt) {}
+
+    template <typename Func>
+    auto run(const char* name, Func func)
+    {
+        size_t allocationsBefore = SysUtils::allocationCnt();
+        SysUtils::Stopwatch timer;
+        auto result = func();
+        double ms = timer.elapsedMs();
+
+        ordered_json& phase = phases[name];
+        phase["ms"] = ms;
+        phase["cellsPerSec"] = ms > 0.0 ? cellCnt / (ms / 1000.0) : 0.0;
+        phase["allocations"] = SysUtils::allocationCnt() - allocationsBefore;
+        phase["peakRssBytes"] = SysUtils::peakRssBytes();
+        return result;
+    }
+
+private:
+    ordered_json& phases;
+    const size_t cellCnt;
+};
+
+static ordered_json runCase(const BenchOptions& options, size_t cellCnt, size_t runIdx, ThreadPool& pool)
+{
+    GeneratorParams params = options.generator;
+    params.cellCnt = cellCnt;
+    NetlistGenerator generator(params);
+
+    std::filesystem::path workDir = options.workDir.empty() ? std::filesystem::temp_directory_path() : std::filesystem::path(options.workDir);
+    std::filesystem::create_directories(workDir);
+    std::filesystem::path netlistFile = workDir / ("fpga-json-bench-" + std::to_string(cellCnt) + "-" + std::to_string(params.seed) + ".json");
+    // declared before the design, which maps the file until the end of the case
+    struct NetlistFileRemover
+    {
+        const std::filesystem::path& path;
+        bool keep;
+        ~NetlistFileRemover()
+        {
+            std::error_code ec;
+            if (! keep) std::filesystem::remove(path, ec);
+        }
+    } netlistFileRemover { netlistFile, options.keepNetlists };
+
+    ordered_json result;
+    result["tool"] = "fpga-json-bench";
+    result["version"] = FPGA_JSON_VERSION;
+    result["cells"] = cellCnt;
+    result["run"] = runIdx;
+    result["threads"] = pool.threadCnt();
+    result["params"] = {
+        { "depth", params.depth }, { "fanoutSkew", params.fanoutSkew }, { "carryChains", params.carryChainCnt },
+        { "carryLength", params.carryChainLength }, { "rams", params.ramCnt }, { "dffRatio", params.dffRatio }, { "seed", params.seed },
+        { "luts", generator.lutCnt() }, { "dffs", generator.dffCnt() }
+    };
+
+    ordered_json phases = ordered_json::object();
+    PhaseRecorder recorder(phases, cellCnt);
+
+    recorder.run("generate", [&]() {
+        std::ofstream os(netlistFile, std::ios::binary);
+        if (! os) throw std::runtime_error("Cannot write " + netlistFile.string());
+        generator.write(os);
+        return true;
+    });
+    result["fileBytes"] = std::filesystem::file_size(netlistFile);
+
+    Design design;
+    recorder.run("parse", [&]() {
+        loadDesign(netlistFile.string(), design, LoaderKind::Mapped, &pool);
+        return true;
+    });
+
+    const Netlist& netlist = design.topModule();
+    NetlistGraph graph = recorder.run("graph", [&]() { return NetlistGraph::build(netlist); });
+
+    LogicCellPacking packing = recorder.run("packing", [&]() {
+        LogicCellPacking packing(graph);
+        parseLogicCellsFromLUTs(graph, packing);
+        parseLogicCellsFromDFFs(graph, packing);
+        return packing;
+    });
+
+    PathAnalysis analysis = recorder.run("paths", [&]() { return analyzeLongestPaths(graph, pool); });
+
+    depth_t maxDepth = 0;
+    for (cellId_t endpoint : analysis.endpoints)
+    {
+        maxDepth = std::max(maxDepth, analysis.depth[endpoint]);
+    }
+
+    result["phases"] = std::move(phases);
+    result["netlistBytes"] = netlist.memoryBytes();
+    result["graphBytes"] = graph.memoryBytes();
+    result["logicCells"] = packing.logicCells.size();
+    result["endpoints"] = analysis.endpoints.size();
+    result["maxDepth"] = maxDepth;
+    return result;
+}
+
+int main(int argc, char* argv[])
+{
+    BenchOptions options;
+    try
+    {
+        options = BenchOptions::parse(argc, argv);
+    }
+    catch (std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        BenchOptions::printUsage(std::cerr, argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    if (options.showHelp)
+    {
+        BenchOptions::printUsage(std::cout, argv[0]);
+        return EXIT_SUCCESS;
+    }
+
+    std::ofstream outputFile;
+    if (! options.outputFile.empty())
+    {
+        outputFile.open(options.outputFile, std::ios::app);
+        if (! outputFile)
+        {
+            std::cerr << "Cannot open " << options.outputFile << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+    std::ostream& out = options.outputFile.empty() ? std::cout : outputFile;
+
+    ThreadPool pool(options.threadCnt);
+    for (size_t cellCnt : options.cellCnts)
+    {
+        for (size_t run = 0; run < options.repeatCnt; ++run)
+        {
+            try
+            {
+                out << runCase(options, cellCnt, run, pool).dump() << std::endl;
+            }
+            catch (std::exception& ex)
+            {
+                std::cerr << "Benchmark with " << cellCnt << " cells failed: " << ex.what() << std::endl;
+                return EXIT_FAILURE;
+            }
+        }
+    }
+
+    return EXIT_SUCCESS;
+}
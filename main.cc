@@ -1,249 +1,564 @@
 #include <iostream>
 #include <ostream>
-#include <fstream>
 #include <map>
 #include <list>
 #include <set>
+#include <unordered_map>
 #include <algorithm>
 #include <limits>
+#include <iomanip>
+#include <optional>
+#include <filesystem>
+#include <fstream>
 
 #include "Cell.h"
 #include "Port.h"
 #include "LogicCell.h"
 #include "StringUtils.h"
-
-#include <nlohmann/json.hpp>
-
-using json = nlohmann::json;
+#include "Netlist.h"
+#include "NetlistLoader.h"
+#include "NetlistCache.h"
+#include "Options.h"
+#include "SysUtils.h"
+#include "PathAnalysis.h"
+#include "NetlistGraph.h"
+#include "ThreadPool.h"
+#include "DelayModel.h"
+#include "TimingAnalysis.h"
+#include "Design.h"
+#include "HierarchyAnalysis.h"
+#include "Profiler.h"
+#include "IncrementalAnalysis.h"
+#include "ReportWriter.h"
+#include "PathExport.h"
+#include "QueryServer.h"
+#include "SrcRollup.h"
+#include "ClockDomains.h"
+#include "BatchSweep.h"
+#include "CompressedInput.h"
+#include "PipelineAdvisor.h"
+#include "TopK.h"
 
 size_t histogramHeight = std::numeric_limits<size_t>::max();
 size_t histogramWidth = 30;
 
-std::list<LogicCell*> logicCells;
-
-enum class CellVisitState
-{
-    NOT_VISITED, IN_PROGRESS, VISITED
-};
-struct CellVisitData
+template<typename Mx>
+void printMatrix(const Mx& matrix, size_t invalidValue)
 {
-    CellVisitState state = CellVisitState::NOT_VISITED;
-    std::list<cellId_t> longestPath;
-};
+    for (const auto& row : matrix)
+        std::cout << StringUtils::join(row.begin(), row.end(), [&](auto& val){ return val == invalidValue ? "X" : std::to_string(val); }, std::string("\t")) << "\n";
+    std::cout << std::endl;
+}
 
-void parseLogicCellsFromLUTs(std::list<Cell>& cells)
+void printHistogram(ReportWriter& out, const std::map<size_t, size_t>& histogramData, size_t maxCnt, std::string_view title = "Route length histogram")
 {
-    for (Cell& cell : cells)
-    {
-        if (cell.type != Cell::Type::LUT) continue;
-        if (cell.parentLC != nullptr) continue;
+    PROFILE_SCOPE("histogram");
+    out << "\n" << title << " (distribution):\n\n";
 
-        LogicCell* lc = new LogicCell();
-        lc->id = logicCells.size();
-        lc->lut = &cell;
-        cell.parentLC = lc;
+    size_t height = std::min(histogramHeight, histogramData.size());
+    size_t lenCatSize = histogramData.size() / height;
 
-        cell.doForAllOutputCells([&](Cell& nextCell) {
-            if (nextCell.type != Cell::Type::DFF) return true;
+    size_t fromLen = histogramData.begin()->first;
+    size_t toLen = fromLen;
+    size_t accuCnt = 0;
+    size_t sumCnt = 0;
 
-            lc->dff = &nextCell;
-            nextCell.parentLC = lc;
+    out << "  Length | Count\n---------+--------------------------------------\n";
 
-            nextCell.doForAllOutputCells([&](Cell& nextNextCell) {
-                if (nextNextCell.type != Cell::Type::Carry) return true;
+    for (const auto& histogramDatum : histogramData)
+    {
+        if (fromLen == toLen) fromLen = histogramDatum.first;
+        sumCnt += histogramDatum.second;
+        ++accuCnt;
 
-                lc->carry = &nextNextCell;
-                nextNextCell.parentLC = lc;
-                return false;
-            });
-            return false;
-        });
+        if (accuCnt % lenCatSize == 0 || histogramDatum == *(--histogramData.end()))
+        {
+            toLen = histogramDatum.first;
+            size_t barWidth = (sumCnt * histogramWidth) / maxCnt;
 
-        logicCells.push_back(lc);
+            out << " ";
+            out.padded(fromLen, 3) << "-";
+            out.padded(toLen, 3, ReportWriter::Align::Left) << " | ";
+            out.padded(sumCnt, 3, ReportWriter::Align::Left) << " ";
+            out.repeat('*', barWidth) << '\n';
+
+            fromLen = toLen;
+
+            accuCnt = 0;
+            sumCnt = 0;
+        }
     }
 }
 
-void parseLogicCellsFromDFFs(std::list<Cell>& cells)
+// The source lines with the longest paths, then all files the same way
+void printSrcRollup(ReportWriter& out, const SrcIndex& index, const SrcRollup& rollup, size_t lineCnt)
 {
-    for (Cell& cell : cells)
+    PROFILE_SCOPE("src report");
+    auto before = [](const SrcStats& a, const SrcStats& b) {
+        return a.maxDepth != b.maxDepth ? a.maxDepth > b.maxDepth : a.pathCnt > b.pathCnt;
+    };
+    auto printStats = [&](const SrcStats& stats) -> ReportWriter& {
+        out.padded(stats.maxDepth, 7);
+        out.padded(stats.pathCnt, 11);
+        return out.padded(stats.lutCnt, 7) << "  ";
+    };
+
+    std::vector<uint32_t> lineIds(index.lines.size());
+    for (uint32_t lineId = 0; lineId < lineIds.size(); ++lineId) lineIds[lineId] = lineId;
+    lineIds = selectTop(lineIds, lineCnt, [&](uint32_t a, uint32_t b) {
+        return before(rollup.perLine[a], rollup.perLine[b]) || (! before(rollup.perLine[b], rollup.perLine[a]) && a < b);
+    });
+
+    out << "\nSource lines on the longest paths (" << lineIds.size() << " of " << index.lines.size() << "):\n\n";
+    out << "  depth      paths   LUTs  line\n";
+    for (uint32_t lineId : lineIds)
     {
-        if (cell.type != Cell::Type::DFF) continue;
-        if (cell.parentLC != nullptr) continue;
+        const SrcLine& line = index.lines[lineId];
+        printStats(rollup.perLine[lineId]) << index.files[line.fileId] << ':' << line.line << '\n';
+    }
 
-        LogicCell* lc = new LogicCell();
-        lc->id = logicCells.size();
-        lc->dff = &cell;
-        cell.parentLC = lc;
+    std::vector<uint32_t> fileIds(index.files.size());
+    for (uint32_t fileId = 0; fileId < fileIds.size(); ++fileId) fileIds[fileId] = fileId;
+    std::stable_sort(fileIds.begin(), fileIds.end(), [&](uint32_t a, uint32_t b) { return before(rollup.perFile[a], rollup.perFile[b]); });
 
-        cell.doForAllInputCells([&](Cell& prevCell) {
-            if (prevCell.type != Cell::Type::LUT) return true;
+    out << "\nSource files:\n\n";
+    out << "  depth      paths   LUTs  file\n";
+    for (uint32_t fileId : fileIds)
+    {
+        printStats(rollup.perFile[fileId]) << index.files[fileId] << '\n';
+    }
+}
 
-            lc->lut = &prevCell;
-            prevCell.parentLC = lc;
-            return false;
-        });
-        cell.doForAllOutputCells([&](Cell& nextCell) {
-            if (nextCell.type != Cell::Type::Carry) return true;
+// Per clock domain: its registers, longest paths, depth histogram and the paths coming in from other domains
+void printClockDomains(ReportWriter& out, const NetlistGraph& graph, const ClockDomains& domains, const std::vector<DomainAnalysis>& results, bool withTiming)
+{
+    PROFILE_SCOPE("clock domain report");
+    out << "\nClock domains: " << domains.domains.size() << '\n';
+    for (size_t domainIdx = 0; domainIdx < domains.domains.size(); ++domainIdx)
+    {
+        const ClockDomain& domain = domains.domains[domainIdx];
+        const DomainAnalysis& result = results[domainIdx];
+        out << "\nDomain #" << (domainIdx + 1) << ": " << domain.name << (domain.negEdge ? ", falling edge" : "") << ", "
+            << domain.captureCells.size() << " capturing and " << domain.launchCells.size() << " launching cells, "
+            << domain.enableCnt << " with enable, " << domain.resetCnt << " with set / reset, fanin cone of " << result.coneCellCnt << " cells\n";
+        if (withTiming)
+        {
+            out << "Estimated critical path delay: ";
+            out.fixed(result.criticalDelay, 2) << " ns, fmax: ";
+            out.fixed(result.fmaxMHz(), 2) << " MHz\n";
+        }
 
-            lc->carry = &nextCell;
-            nextCell.parentLC = lc;
-            return false;
-        });
+        for (size_t i = 0; i < result.criticalPaths.size(); ++i)
+        {
+            const Cell& cell = *graph.cells[result.criticalPaths[i].front()];
+            out << "#";
+            out.padded(i + 1, 2) << ".: len: ";
+            out.padded(result.criticalPaths[i].size() - 1, 3) << ", name: ";
+            out.padded(cell.name, 50) << ", src: " << cell.verilogSrc << '\n';
+            for (cellId_t pathCellId : result.criticalPaths[i])
+            {
+                const Cell& pathCell = *graph.cells[pathCellId];
+                out << '\t' << pathCell.name << " (" << pathCell.verilogSrc << ")\n";
+            }
+        }
+
+        std::map<size_t, size_t> histogramData;
+        size_t maxCnt = 0;
+        for (depth_t depth : result.endpointDepths)
+        {
+            if (depth > 0) maxCnt = std::max(maxCnt, ++histogramData[depth]);
+        }
+        if (! histogramData.empty()) printHistogram(out, histogramData, maxCnt, "Route length histogram of " + domain.name);
 
-        logicCells.push_back(lc);
+        for (const DomainCrossing& crossing : result.crossings)
+        {
+            out << "\nPaths from " << domains.domains[crossing.fromDomain].name << (domains.domains[crossing.fromDomain].negEdge ? " (falling edge)" : "")
+                << " into " << crossing.endpointCnt << " cells, for example:\n";
+            for (cellId_t pathCellId : crossing.examplePath)
+            {
+                const Cell& pathCell = *graph.cells[pathCellId];
+                out << '\t' << pathCell.name << " (" << pathCell.verilogSrc << ")\n";
+            }
+        }
     }
 }
 
-template<typename Mx>
-void printMatrix(const Mx& matrix, size_t invalidValue)
+// Several netlists side by side instead of the report of a single one
+bool runBatchReport(const Options& options)
 {
-    for (const auto& row : matrix)
-        std::cout << StringUtils::join(row.begin(), row.end(), [&](auto& val){ return val == invalidValue ? "X" : std::to_string(val); }, std::string("\t")) << "\n";
-    std::cout << std::endl;
+    std::vector<std::string> files;
+    try
+    {
+        files = expandNetlistPatterns(options.batchPatterns);
+    }
+    catch (std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return false;
+    }
+
+    size_t memoryBudget = options.batchMemoryBytes > 0 ? options.batchMemoryBytes : SysUtils::physicalMemoryBytes() / 2;
+    ThreadPool pool(std::min(options.threadCnt, files.size()));
+    std::cout << "Batch of " << files.size() << " netlists on " << pool.threadCnt() << " thread(s), memory budget "
+        << (memoryBudget > 0 ? SysUtils::formatBytes(memoryBudget) : "unknown") << std::endl;
+
+    SysUtils::Stopwatch batchTimer;
+    std::vector<BatchResult> results = runBatch(files, options, pool, memoryBudget > 0 ? memoryBudget : std::numeric_limits<size_t>::max());
+    std::cout << "Batch time: " << batchTimer.elapsedMs() << " ms, peak RSS: " << SysUtils::formatBytes(SysUtils::peakRssBytes()) << '\n';
+
+    ReportWriter out(std::cout);
+    printBatchReport(out, results, options.topCnt, ! options.delayModelFile.empty());
+    out << "\nDone\n";
+    return std::all_of(results.begin(), results.end(), [](const BatchResult& result) { return result.error.empty(); });
 }
 
-std::list<cellId_t> crawlBackward(const Cell& cell, std::map<cellId_t, CellVisitData>& data, std::list<cellId_t> currentPath)
+// Registers to insert per cone of the endpoints over the target depth, for the deepest topListSize cones the
+// topListSize registers of every level with the most readers are listed
+void printPipelineAdvice(ReportWriter& out, const NetlistGraph& graph, const PipelineAdvice& advice, size_t topListSize)
 {
-    if (! data.contains(cell.id))
+    PROFILE_SCOPE("pipeline report");
+    size_t endpointCnt = 0;
+    size_t affectedCnt = 0;
+    depth_t depthAfter = 0;
+    for (const PipelineCone& cone : advice.cones)
     {
-        data[cell.id] = CellVisitData();
+        endpointCnt += cone.endpoints.size();
+        affectedCnt += cone.affectedEndpoints.size();
+        depthAfter = std::max(depthAfter, cone.depthAfter);
     }
-    CellVisitData& cellData = data.at(cell.id);
-    currentPath.push_back(cell.id);
 
-    if (cellData.state == CellVisitState::NOT_VISITED)
+    out << "\nPipeline registers for a max depth of " << advice.targetDepth << ": ";
+    if (advice.cones.empty())
     {
-        cellData.state = CellVisitState::IN_PROGRESS;
+        out << "all paths are within it\n";
+        return;
+    }
+    out << endpointCnt << " endpoints over it in " << advice.cones.size() << " cones, " << advice.registerCnt() << " registers\n";
+    out << "Estimated max depth of the cones with them: " << depthAfter << '\n';
+    if (affectedCnt > 0)
+        out << "Endpoints outside the cones that gain latency, their paths are not balanced: " << affectedCnt << '\n';
 
-        size_t maxDepth = 0;
-        std::list<cellId_t> longestPath;
-        cell.doForAllInputCells([&](const Cell& prevCell) {
-            if (prevCell.type == Cell::Type::DFF || prevCell.type == Cell::Type::Carry) return true;
+    const size_t coneCnt = std::min(topListSize, advice.cones.size());
+    for (size_t i = 0; i < coneCnt; ++i)
+    {
+        const PipelineCone& cone = advice.cones[i];
+        const Cell& deepest = *graph.cells[cone.endpoints.front()];
+        out << "\nCone #" << (i + 1) << ": " << cone.endpoints.size() << " endpoints, " << cone.cellCnt << " cells, depth "
+            << cone.depthBefore << " -> " << cone.depthAfter;
+        if (cone.stageCnt == 0)
+        {
+            out << ", no cut found\n";
+            continue;
+        }
+        out << " with " << cone.stageCnt << " register levels, " << cone.cuts.size() << " registers\n";
+        out << "Deepest endpoint: " << deepest.name << " (" << deepest.verilogSrc << ")\n";
+        std::vector<const PipelineCut*> levelCuts;
+        for (size_t levelBegin = 0, levelEnd; levelBegin < cone.cuts.size(); levelBegin = levelEnd)
+        {
+            levelEnd = levelBegin;
+            while (levelEnd < cone.cuts.size() && cone.cuts[levelEnd].stage == cone.cuts[levelBegin].stage) ++levelEnd;
+            levelCuts.clear();
+            for (size_t cutIdx = levelBegin; cutIdx < levelEnd; ++cutIdx) levelCuts.push_back(&cone.cuts[cutIdx]);
+            const size_t listedCnt = std::min(levelCuts.size(), topListSize);
+            std::partial_sort(levelCuts.begin(), levelCuts.begin() + listedCnt, levelCuts.end(), [](const PipelineCut* a, const PipelineCut* b) {
+                return a->readerCnt != b->readerCnt ? a->readerCnt > b->readerCnt : a->driver != b->driver ? a->driver < b->driver : a->net < b->net;
+            });
 
-            std::list<cellId_t> pathOnward = crawlBackward(prevCell, data, currentPath);
-            size_t pathLengthOnward = pathOnward.size();
-            if (pathOnward.size() > longestPath.size())
+            out << "\tlevel " << cone.cuts[levelBegin].stage << ": " << levelCuts.size() << " registers\n";
+            for (size_t listIdx = 0; listIdx < listedCnt; ++listIdx)
             {
-                longestPath = std::move(pathOnward);
+                const PipelineCut& cut = *levelCuts[listIdx];
+                const Cell& driver = *graph.cells[cut.driver];
+                out << "\t\t" << driver.name << '.' << graph.portNames[cut.driverPort] << " (net " << cut.net << ") -> "
+                    << cut.readerCnt << (cut.readerCnt == 1 ? " input" : " inputs") << ", src: " << driver.verilogSrc << '\n';
             }
-            return true;
-        });
+            if (levelCuts.size() > listedCnt) out << "\t\t" << (levelCuts.size() - listedCnt) << " more\n";
+        }
+
+        if (! cone.affectedEndpoints.empty())
+        {
+            const size_t listedCnt = std::min(cone.affectedEndpoints.size(), topListSize);
+            out << "\tendpoints gaining latency outside the cone: " << cone.affectedEndpoints.size() << '\n';
+            for (size_t listIdx = 0; listIdx < listedCnt; ++listIdx)
+            {
+                const Cell& endpoint = *graph.cells[cone.affectedEndpoints[listIdx]];
+                out << "\t\t" << endpoint.name << " (" << endpoint.verilogSrc << ")\n";
+            }
+            if (cone.affectedEndpoints.size() > listedCnt) out << "\t\t" << (cone.affectedEndpoints.size() - listedCnt) << " more\n";
+        }
+    }
+    if (coneCnt < advice.cones.size())
+    {
+        out << "\n" << (advice.cones.size() - coneCnt) << " more cones not listed, see --top\n";
+    }
+}
+
+// Compares the longest paths with the ones of the previous run, the endpoints are matched by name
+void printCriticalPathChanges(ReportWriter& out, const NetlistGraph& graph, const PathAnalysis& analysis, const AnalysisState& previous, size_t topListSize)
+{
+    PROFILE_SCOPE("change report");
+    std::unordered_map<std::string_view, cellId_t> previousByName;
+    for (cellId_t oldId = 0; oldId < static_cast<cellId_t>(previous.cellCnt()); ++oldId)
+    {
+        previousByName.emplace(previous.nameOf(oldId), oldId);
+    }
+
+    auto pathNames = [](const auto& path, auto nameOf) {
+        std::vector<std::string_view> names;
+        for (cellId_t cellId : path) names.push_back(nameOf(cellId));
+        return names;
+    };
+
+    out << "Changes of the " << topListSize << " longest paths since the previous run:\n";
+    std::vector<cellId_t> topEndpoints = analysis.topEndpoints(topListSize);
+    std::set<std::string_view> currentTop;
+    size_t unchangedCnt = 0;
+    for (size_t i = 0; i < topListSize; ++i)
+    {
+        const Cell& cell = *graph.cells[topEndpoints[i]];
+        currentTop.insert(cell.name);
+
+        auto it = previousByName.find(cell.name);
+        if (it == previousByName.end())
+        {
+            out << "#";
+            out.padded(i + 1, 2) << ".: " << cell.name << ": new endpoint, len " << analysis.depth[cell.id] << '\n';
+            continue;
+        }
 
-        cellData.state = CellVisitState::VISITED;
-        cellData.longestPath = longestPath;
+        cellId_t oldId = it->second;
+        bool samePath = pathNames(analysis.pathTo(cell.id), [&](cellId_t id) { return graph.cells[id]->name; })
+            == pathNames(previous.pathTo(oldId), [&](cellId_t id) { return previous.nameOf(id); });
+        if (samePath && previous.depth[oldId] == analysis.depth[cell.id])
+        {
+            ++unchangedCnt;
+            continue;
+        }
+        out << "#";
+        out.padded(i + 1, 2) << ".: " << cell.name << ": len " << previous.depth[oldId] << " -> " << analysis.depth[cell.id]
+            << (samePath ? "" : ", path changed") << '\n';
+    }
 
-        return longestPath;
+    std::vector<cellId_t> previousSorted = previous.sortedEndpoints();
+    for (size_t i = 0; i < std::min(topListSize, previousSorted.size()); ++i)
+    {
+        std::string_view name = previous.nameOf(previousSorted[i]);
+        if (currentTop.contains(name)) continue;
+
+        out << "Dropped out: " << name << ", len " << previous.depth[previousSorted[i]];
+        auto cellIt = std::find_if(analysis.endpoints.begin(), analysis.endpoints.end(), [&](cellId_t id) { return graph.cells[id]->name == name; });
+        if (cellIt == analysis.endpoints.end()) out << " -> removed\n";
+        else out << " -> " << analysis.depth[*cellIt] << '\n';
     }
-    else if (cellData.state == CellVisitState::IN_PROGRESS)
+    out << unchangedCnt << " of them unchanged\n\n";
+}
+
+// Writes the paths to the export file, or to stdout for "-". Returns false after printing the error.
+template <typename Func>
+bool writeExport(const std::string& fileName, Func writePaths)
+{
+    std::ofstream exportFile;
+    if (fileName != "-")
     {
-        // circle!
-        std::cout << "Circle in LUT graph at cell #" << cell.id << '\n';
-        return {};
+        exportFile.open(fileName, std::ios::binary);
+        if (! exportFile)
+        {
+            std::cerr << "Could not open file: " << fileName << std::endl;
+            return false;
+        }
     }
-    else if (cellData.state == CellVisitState::VISITED)
+
+    ReportWriter exportWriter(fileName == "-" ? std::cout : exportFile);
+    writePaths(exportWriter);
+    exportWriter.flush();
+    if (exportFile.is_open() && ! exportFile)
     {
-        currentPath.emplace_back(cell.id);
-        return currentPath;
+        std::cerr << "Could not write file: " << fileName << std::endl;
+        return false;
     }
+    return true;
+}
 
-    std::cout << "Crawl found cell in unexpected state: " << (int)cellData.state << '\n';
-    throw std::runtime_error("");
+// The given options that need the flattened netlist graph
+std::vector<std::string_view> flatOnlyOptions(const Options& options)
+{
+    std::vector<std::string_view> names;
+    if (! options.delayModelFile.empty()) names.push_back("--delay-model");
+    if (! options.stateFile.empty()) names.push_back("--state");
+    if (options.serve) names.push_back(options.serveSocket.empty() ? "--serve" : "--serve-socket");
+    if (options.pathsPerEndpoint > 1) names.push_back("--paths-per-endpoint");
+    if (options.srcReportCnt > 0) names.push_back("--src-report");
+    if (options.clockDomainPathCnt > 0) names.push_back("--clock-domains");
+    if (options.pipelineDepth > 0) names.push_back("--pipeline-depth");
+    return names;
 }
 
-int main(int argc, char *argv[])
+// Longest paths of a design that was not flattened, every module definition is analyzed once
+bool printHierarchicalReport(const Design& design, const Options& options)
 {
-    if (argc < 2)
+    std::cout << "======================================================\n";
+    std::cout << "Hierarchical design, top module: " << design.topModuleName << ", " << design.modules.size() << " modules\n";
+
+    HierarchyAnalysis hierarchy(design);
+    std::vector<HierarchyAnalysis::EndpointResult> endpoints;
+    try
     {
-        std::cerr << "Invalid number of arguments" << std::endl;
-        return EXIT_FAILURE;
+        endpoints = hierarchy.analyzeTop();
+    }
+    catch (std::exception& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        return false;
+    }
+
+    std::cout << "Summarized " << hierarchy.summaryCnt() << " module definitions below " << design.topModuleName << '\n';
+
+    std::map<size_t, size_t> histogramData;
+    size_t maxCnt = 0;
+    for (const auto& endpoint : endpoints)
+    {
+        if (endpoint.depth > 0)
+        {
+            maxCnt = std::max(maxCnt, ++histogramData[endpoint.depth]);
+        }
     }
 
-    if (argc >= 3)
+    if (! options.exportFile.empty())
     {
-        histogramHeight = std::stol(argv[2]);
+        PathExportFormat format = exportFormatFor(options.exportFile);
+        if (! writeExport(options.exportFile, [&](ReportWriter& writer) { exportHierarchicalPaths(writer, format, endpoints); })) return false;
     }
 
-    std::cout << "Histogram height: " << (histogramHeight == std::numeric_limits<size_t>::max() ? "FULL" : std::to_string(histogramHeight)) << '\n';
+    size_t topListSize = std::min(options.topCnt, endpoints.size());
+    if (topListSize == 0 || histogramData.empty())
+    {
+        std::cout << "Found no routes?!\n";
+        return true;
+    }
 
-    std::string fileName = argv[1];
-    std::cout << "Opening file: " << fileName << std::endl;
-    std::ifstream file(fileName);
+    PROFILE_SCOPE("report");
+    ReportWriter out(std::cout);
+    out << "The " << topListSize << " longest paths:\n";
+    for (size_t i = 0; i < topListSize; ++i)
+    {
+        const auto& endpoint = endpoints[i];
+        out << "#";
+        out.padded(i + 1, 2) << ".: len: ";
+        out.padded(endpoint.depth, 3) << ", name: ";
+        out.padded(endpoint.name, 50) << ", src: " << endpoint.verilogSrc << '\n';
+        for (const Cell* pathCell : endpoint.path)
+        {
+            out << '\t' << pathCell->name << " (" << pathCell->verilogSrc << ")\n";
+        }
+        out << '\n';
+    }
 
-    std::cout << "Parsing JSON..." << std::endl;
-    json data = json::parse(file);
+    printHistogram(out, histogramData, maxCnt);
 
-    std::map<std::string, size_t> typeCnts;
-    std::map<cellId_t, Cell> cells;
-    std::map<portId_t, Link> links;
-    size_t cellCnt = 0;
+    out << "\nDone\n";
+    return true;
+}
 
+int main(int argc, char *argv[])
+{
+    Options options;
     try
     {
-        const auto& project = data.at("modules").at("top");
+        options = Options::parse(argc, argv);
+    }
+    catch (std::invalid_argument& ex)
+    {
+        std::cerr << ex.what() << std::endl;
+        Options::printUsage(std::cerr, argv[0]);
+        return EXIT_FAILURE;
+    }
 
-        for (const auto& cellData : project.at("cells").items())
-        {
-            std::string cellType = cellData.value().at("type");
-            std::map<std::string, Port::Type> portTypes;
+    histogramHeight = options.histogramHeight;
+    Profiler::Session profile(options.profile, options.profileTraceFile, std::cout);
 
-            if (typeCnts.count(cellType))
-                ++typeCnts[cellType];
-            else
-                typeCnts[cellType] = 1;
+    if (options.batch)
+    {
+        return runBatchReport(options) ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
 
-            //Cell& cell = cells.emplace(cellCnt, {cellCnt, cellData.key(), cellType}).first->second;
-            Cell& cell = cells.emplace(std::piecewise_construct, std::forward_as_tuple(cellCnt), std::forward_as_tuple(cellCnt, cellData.key(), cellType)).first->second;
+    std::cout << "Histogram height: " << (histogramHeight == std::numeric_limits<size_t>::max() ? "FULL" : std::to_string(histogramHeight)) << '\n';
+
+    std::cout << "Opening file: " << options.fileName << std::endl;
+
+    ThreadPool pool(options.threadCnt);
+    Design design;
+    design.architecture = options.architecture;
+    SysUtils::Stopwatch parseTimer;
+    size_t allocationsBeforeLoad = SysUtils::allocationCnt();
+
+    if (options.useCache && NetlistCache::load(options.fileName, design))
+    {
+        std::cout << "Loaded cached netlist " << NetlistCache::cacheFileFor(options.fileName) << '\n';
+    }
+    else
+    {
+        Compression compression = detectCompression(options.fileName);
+        std::cout << "Parsing JSON (" << (options.loader == LoaderKind::DOM ? "DOM" : options.loader == LoaderKind::SAX || compression != Compression::None ? "SAX" : "mmap");
+        if (compression != Compression::None) std::cout << ", " << compressionName(compression) << " decompressed on a separate thread";
+        else if (options.loader == LoaderKind::Mapped && pool.threadCnt() > 1) std::cout << ", " << pool.threadCnt() << " threads";
+        std::cout << ")..." << std::endl;
+        try
+        {
+            loadDesign(options.fileName, design, options.loader, &pool);
+        }
+        catch (std::out_of_range& ex)
+        {
+            std::cerr << "Unexpected JSON schema: " << ex.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        catch (std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            return EXIT_FAILURE;
+        }
 
-            cell.verilogSrc = cellData.value().at("attributes").at("src");
-            
-            for (const auto& connection : cellData.value().at("port_directions").items())
+        if (options.useCache)
+        {
+            try
             {
-                if (connection.value() == "input")
-                    portTypes.emplace(connection.key(), Port::Type::INPUT);
-                else if (connection.value() == "output")
-                    portTypes.emplace(connection.key(), Port::Type::OUTPUT);
-                else
-                    throw std::runtime_error("Could not determine type of port" + connection.key() + "of cell #" + std::to_string(cell.id) + ": " + std::string(connection.value()));
+                NetlistCache::save(options.fileName, design);
             }
-
-            for (const auto& connectionList : cellData.value().at("connections").items())
+            catch (std::exception& ex)
             {
-                std::string portId = connectionList.key();
-                for (const auto& remotePort : connectionList.value())
-                {
-                    switch (remotePort.type())
-                    {
-                        case json::value_t::string:
-                            // not connected
-                            break;
-                        case json::value_t::number_integer:
-                        case json::value_t::number_unsigned:
-                            {
-                                Link& link = links.try_emplace(remotePort, remotePort).first->second;
-                                cell.assignPort(portId, link, portTypes.at(portId));
-                            }
-                            break;
-                        default:
-                            throw std::runtime_error("Invalid port connection in node #" + std::to_string(cell.id) + " port " + portId + ": " + std::string(remotePort));
-                    }
-                }
+                std::cerr << "WARNING: " << ex.what() << std::endl;
             }
-
-            ++cellCnt;            
         }
-
     }
-    catch (std::out_of_range&)
+
+    std::cout << "Load time: " << parseTimer.elapsedMs() << " ms, peak RSS: " << SysUtils::formatBytes(SysUtils::peakRssBytes()) << '\n';
+    if (options.printMemoryStats)
     {
-        std::cerr << "Unexpected JSON schema" << std::endl;
-        return EXIT_FAILURE;
+        std::cout << "Heap allocations while loading: " << (SysUtils::allocationCnt() - allocationsBeforeLoad) << '\n';
     }
 
+    const Netlist& netlist = design.topModule();
+    const auto& cellTypes = netlist.cellTypes;
+    size_t cellCnt = netlist.cells.size();
+
     // Cell counts
     std::cout << "Parsed, found " << cellCnt << " cells of types:" << std::endl;
-    for (const auto& typeData : typeCnts)
+    for (const auto& typeData : cellTypes)
     {
-        std::cout << typeData.first << " : " << typeData.second << '\n';
+        std::cout << typeData.first << " : " << typeData.second.cnt << '\n';
+    }
+    std::cout << "Architecture: " << architectureName(netlist.architecture) << (options.architecture == Architecture::Auto ? " (detected)" : "") << '\n';
+
+    if (design.isHierarchical())
+    {
+        std::vector<std::string_view> unsupported = flatOnlyOptions(options);
+        if (! unsupported.empty())
+        {
+            std::cerr << "Not supported for hierarchical designs:";
+            for (std::string_view name : unsupported) std::cerr << ' ' << name;
+            std::cerr << "\nFlatten the design in Yosys (e.g. synth_ice40 -flatten) to use them" << std::endl;
+            return EXIT_FAILURE;
+        }
+        return printHierarchicalReport(design, options) ? EXIT_SUCCESS : EXIT_FAILURE;
     }
 
     /*
@@ -257,99 +572,221 @@ int main(int argc, char *argv[])
     */
 
     std::cout << "======================================================\n";
-    std::map<cellId_t, CellVisitData> cellVisitStates;
-    std::vector<std::pair<cellId_t, CellVisitData>> cellData;
-    std::map<size_t, size_t> histogramData;
-    size_t maxCnt = 0;
-    for (auto& cellPair : cells)
+    NetlistGraph graph = NetlistGraph::build(netlist);
+    if (options.printMemoryStats)
     {
-        Cell& cell = cellPair.second;
-        if (cell.type != Cell::Type::DFF && cell.type != Cell::Type::RAM) continue;
-        std::list<cellId_t> longestPath;
-        crawlBackward(cell, cellVisitStates, longestPath);
-        cellData.emplace_back(cell.id, cellVisitStates.at(cell.id));
+        std::cout << "Netlist memory (estimated): " << SysUtils::formatBytes(netlist.memoryBytes())
+            << ", CSR graph: " << SysUtils::formatBytes(graph.memoryBytes()) << '\n';
+    }
 
-        size_t pathLength = cellVisitStates.at(cell.id).longestPath.size();
-        if (pathLength > 0)
+    LogicCellPacking packing(graph);
+    parseLogicCellsFromLUTs(graph, packing);
+    parseLogicCellsFromDFFs(graph, packing);
+    std::cout << "Packed into " << packing.logicCells.size() << " logic cells\n";
+
+    std::optional<AnalysisState> previousState;
+    if (! options.stateFile.empty() && std::filesystem::exists(options.stateFile))
+    {
+        try
+        {
+            previousState = AnalysisState::load(options.stateFile);
+        }
+        catch (std::exception& ex)
+        {
+            std::cerr << "WARNING: " << ex.what() << ", running a full analysis" << std::endl;
+        }
+    }
+
+    SysUtils::Stopwatch analysisTimer;
+    PathAnalysis analysis;
+    if (previousState)
+    {
+        IncrementalAnalysis incremental = analyzeLongestPathsIncremental(graph, *previousState);
+        analysis = std::move(incremental.analysis);
+        std::cout << "Incremental path analysis: " << incremental.changedCellCnt << " changed and " << incremental.removedCellCnt << " removed cells, "
+            << incremental.recomputedCellCnt << " cells recomputed in " << analysisTimer.elapsedMs() << " ms\n";
+    }
+    else
+    {
+        analysis = analyzeLongestPaths(graph, pool);
+        std::cout << "Path analysis on " << pool.threadCnt() << " thread(s): " << analysisTimer.elapsedMs() << " ms\n";
+    }
+
+    if (! options.stateFile.empty())
+    {
+        try
+        {
+            AnalysisState::capture(graph, analysis).save(options.stateFile);
+        }
+        catch (std::exception& ex)
+        {
+            std::cerr << "WARNING: " << ex.what() << std::endl;
+        }
+    }
+    if (! analysis.loops.empty())
+    {
+        std::cout << "Combinational loops: " << analysis.loops.size() << " with " << analysis.loopCellCnt << " cells, each counts as one level of logic\n";
+        for (size_t loopIdx = 0; loopIdx < analysis.loops.size(); ++loopIdx)
+        {
+            std::cout << "Loop #" << (loopIdx + 1) << ", " << analysis.loops[loopIdx].size() << " cells:\n";
+            for (cellId_t cellId : analysis.loops[loopIdx])
+            {
+                std::cout << '\t' << graph.cells[cellId]->name << " (" << graph.cells[cellId]->verilogSrc << ")\n";
+            }
+        }
+    }
+
+    if (options.serve)
+    {
+        QueryServer server(graph, analysis);
+        try
         {
-            if (! histogramData.contains(pathLength))
+            if (options.serveSocket.empty())
             {
-                histogramData[pathLength] = 1;
+                std::cout << "Ready for queries" << std::endl;
+                server.serve(std::cin, std::cout);
             }
             else
             {
-                ++histogramData[pathLength];
+                std::cout << "Serving queries on " << options.serveSocket << std::endl;
+                server.serveSocket(options.serveSocket);
             }
-            maxCnt = std::max(maxCnt, histogramData[pathLength]);
         }
+        catch (std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+        return EXIT_SUCCESS;
     }
 
-    cellData.shrink_to_fit();
-
+    std::map<size_t, size_t> histogramData;
+    size_t maxCnt = 0;
+    for (cellId_t endpoint : analysis.endpoints)
+    {
+        size_t pathLength = analysis.depth[endpoint];
+        if (pathLength > 0)
+        {
+            maxCnt = std::max(maxCnt, ++histogramData[pathLength]);
+        }
+    }
 
-    std::sort(cellData.begin(), cellData.end(), [](auto& a, auto& b) { return a.second.longestPath.size() > b.second.longestPath.size(); });
+    std::vector<cellId_t> topEndpoints = analysis.topEndpoints(options.topCnt);
 
-    size_t topListSize = std::min((size_t)10, cellData.size());
-    if (topListSize == 0)
+    size_t topListSize = topEndpoints.size();
+    if (topListSize == 0 || histogramData.empty())
     {
         std::cout << "Found no routes?!\n";
         return EXIT_SUCCESS;
     }
 
-    std::cout << "The " << topListSize << " longest paths:\n";
-    for (size_t i = 0; i < topListSize; ++i)
+    std::optional<DelayModel> delayModel;
+    std::optional<TimingAnalysis> timing;
+    if (! options.delayModelFile.empty())
     {
-        const Cell& cell = cells.at(cellData[i].first);
-        std::cout << "#" << std::setw(2) << (i + 1) << ".: len: " << std::setw(3) << cellData[i].second.longestPath.size() << ", name: " << std::setw(50) << cell.name << ", src: " << cell.verilogSrc << '\n';
-        for (cellId_t pathCellId : cellData[i].second.longestPath)
+        try
         {
-            const Cell& pathCell = cells.at(pathCellId);
-            std::cout << '\t' << pathCell.name << " (" << pathCell.verilogSrc << ")\n";
+            delayModel = options.delayModelFile == "ice40" ? DelayModel::ice40() : DelayModel::load(options.delayModelFile);
+        }
+        catch (std::exception& ex)
+        {
+            std::cerr << ex.what() << std::endl;
+            return EXIT_FAILURE;
         }
-        std::cout << '\n';
-    }
-
-    // Histogram
-    std::cout << "\nRoute length histogram (distribution):\n\n";
 
-    histogramHeight = std::min(histogramHeight, histogramData.size());
-    size_t lenCatSize = histogramData.size() / histogramHeight;
+        timing.emplace(graph, *delayModel);
+        timing->run();
+        topEndpoints = timing->topEndpoints(options.topCnt);
+    }
 
-    size_t fromLen = histogramData.begin()->first;
-    size_t toLen = fromLen;
-    size_t accuCnt = 0;
-    size_t sumCnt = 0;
+    if (! options.exportFile.empty())
+    {
+        bool exported = writeExport(options.exportFile, [&](ReportWriter& writer) {
+            exportPaths(writer, exportFormatFor(options.exportFile), graph, analysis, timing ? timing->sortedEndpoints() : analysis.sortedEndpoints(), timing ? &*timing : nullptr);
+        });
+        if (! exported) return EXIT_FAILURE;
+    }
 
-    std::cout << "  Length | Count\n---------+--------------------------------------\n";
+    PROFILE_SCOPE("report");
+    ReportWriter out(std::cout);
+    if (timing)
+    {
+        out << "The " << topListSize << " slowest paths:\n";
+        for (size_t i = 0; i < topListSize; ++i)
+        {
+            const Cell& cell = *graph.cells[topEndpoints[i]];
+            out << "#";
+            out.padded(i + 1, 2) << ".: delay: ";
+            out.fixed(timing->endpointArrival(cell.id), 2, 6) << " ns, name: ";
+            out.padded(cell.name, 50) << ", src: " << cell.verilogSrc << '\n';
+            for (cellId_t pathCellId : timing->pathTo(cell.id))
+            {
+                const Cell& pathCell = *graph.cells[pathCellId];
+                double arrival = pathCellId == cell.id ? timing->endpointArrival(pathCellId) : timing->arrival(pathCellId);
+                out << '\t';
+                out.fixed(arrival, 2, 8) << " ns  " << pathCell.name << " (" << pathCell.verilogSrc << ")\n";
+            }
+            out << '\n';
+        }
+    }
+    else
+    {
+        out << "The " << topListSize << " longest paths:\n";
+        for (size_t i = 0; i < topListSize; ++i)
+        {
+            const Cell& cell = *graph.cells[topEndpoints[i]];
+            out << "#";
+            out.padded(i + 1, 2) << ".: len: ";
+            out.padded(analysis.depth[cell.id], 3) << ", name: ";
+            out.padded(cell.name, 50) << ", src: " << cell.verilogSrc << '\n';
+            std::vector<RankedPath> paths = worstPathsTo(graph, analysis, cell.id, options.pathsPerEndpoint);
+            for (size_t pathIdx = 0; pathIdx < paths.size(); ++pathIdx)
+            {
+                if (pathIdx > 0) out << "\t-- path " << (pathIdx + 1) << ", len: " << paths[pathIdx].depth << '\n';
+                for (cellId_t pathCellId : paths[pathIdx].cells)
+                {
+                    const Cell& pathCell = *graph.cells[pathCellId];
+                    out << '\t' << pathCell.name << " (" << pathCell.verilogSrc << ")\n";
+                }
+            }
+            out << '\n';
+        }
+    }
 
-    for (auto& histogramDatum : histogramData)
+    if (previousState)
     {
-        if (fromLen == toLen) fromLen = histogramDatum.first;
-        sumCnt += histogramDatum.second;
-        ++accuCnt;
+        printCriticalPathChanges(out, graph, analysis, *previousState, topListSize);
+    }
 
-        if (accuCnt % lenCatSize == 0 || histogramDatum == *(--histogramData.end()))
-        {
-            toLen = histogramDatum.first;
-            size_t barWidth = (sumCnt * histogramWidth) / maxCnt;
+    if (options.srcReportCnt > 0)
+    {
+        SrcIndex srcIndex = SrcIndex::build(graph);
+        printSrcRollup(out, srcIndex, rollupBySrc(graph, analysis, srcIndex), options.srcReportCnt);
+    }
 
-            std::cout << " " 
-                << std::setw(3) << std::right << fromLen 
-                << "-"
-                << std::setw(3) << std::left << toLen
-                << " | " 
-                << std::setw(3) << sumCnt 
-                << " ";
+    printHistogram(out, histogramData, maxCnt);
 
-            for (size_t i = 0; i < barWidth; ++i) std::cout << "*";
-            std::cout << '\n';
+    if (timing)
+    {
+        out << "\nEstimated critical path delay: ";
+        out.fixed(timing->criticalDelay(), 2) << " ns, fmax: ";
+        out.fixed(timing->fmaxMHz(), 2) << " MHz\n";
+    }
 
-            fromLen = toLen;
+    if (options.clockDomainPathCnt > 0)
+    {
+        ClockDomains domains = ClockDomains::extract(netlist, graph);
+        std::vector<DomainAnalysis> results = analyzeClockDomains(graph, analysis, domains, pool, options.clockDomainPathCnt, timing ? &*timing : nullptr);
+        printClockDomains(out, graph, domains, results, timing.has_value());
+    }
 
-            accuCnt = 0;
-            sumCnt = 0;
-        }
+    if (options.pipelineDepth > 0)
+    {
+        SysUtils::Stopwatch adviceTimer;
+        PipelineAdvice advice = advisePipelining(graph, analysis, static_cast<depth_t>(options.pipelineDepth), pool);
+        printPipelineAdvice(out, graph, advice, options.topCnt);
+        out << "Pipeline advice: " << static_cast<size_t>(adviceTimer.elapsedMs()) << " ms\n";
     }
 
-    std::cout << "\nDone\n";
+    out << "\nDone\n";
 }